@@ -0,0 +1,64 @@
+#pragma once
+#include "config.hpp"
+#include "runtime_config.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Chooses the next sampling interval from how close the streams are to
+// alerting. Proximity is the largest |z| / hysteresis threshold; below
+// ADAPTIVE_QUIET_RATIO the host is quiet and sampled every adaptive_max_ms,
+// and from there to 1 the interval shrinks geometrically to adaptive_min_ms
+// (it stays there while any stream is at or above its clearing threshold).
+// Shrinking takes effect at once; growing is limited to ADAPTIVE_RELAX per
+// sample. The scoring policies rescale ewma_alpha for the actual interval
+// (see RateNormalizer), so baselines are unaffected by the rate.
+//
+// Every stream counts, collector streams against hysteresis_threshold.
+// Collectors run at their own intervals, so each round's fresh z-scores are
+// folded in with observe() and next() takes the closest since the last
+// decision; a slow collector's stream is not missed for being off-beat.
+class AdaptiveSampler {
+  float interval_ms_{float(SAMPLE_MS)};
+  float proximity_{0.0f};
+
+public:
+  unsigned interval_ms() const { return unsigned(interval_ms_ + 0.5f); }
+
+  // Fold in the z-scores of the streams fresh this round (every one of the
+  // n if fresh is null)
+  void observe(const float* z, std::size_t n, const RuntimeConfig& cfg, const std::uint8_t* fresh = nullptr) {
+    float proximity = proximity_;
+    for (std::size_t i = 0; i < n; ++i) {
+      float h = i < N_METRICS ? cfg.hysteresis[i] : cfg.hysteresis_threshold;
+      float r = std::fabs(z[i]) / h;
+      r = (fresh && !fresh[i]) ? 0.0f : r;
+      proximity = r > proximity ? r : proximity;
+    }
+    proximity_ = proximity;
+  }
+
+  // Interval to wait before the next sample, from the streams observed
+  // since the last call
+  unsigned next(const RuntimeConfig& cfg) {
+    const float proximity = proximity_;
+    proximity_ = 0.0f;
+    float f = (proximity - ADAPTIVE_QUIET_RATIO) / (1.0f - ADAPTIVE_QUIET_RATIO);
+    f = f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+    const float lo = float(cfg.adaptive_min_ms);
+    const float hi = float(cfg.adaptive_max_ms);
+    float target = hi * std::pow(lo / hi, f);
+
+    float relaxed = interval_ms_ * ADAPTIVE_RELAX;
+    interval_ms_ = target < relaxed ? target : relaxed;
+    interval_ms_ = interval_ms_ < lo ? lo : (interval_ms_ > hi ? hi : interval_ms_);
+    return interval_ms();
+  }
+
+  // Back to the nominal interval (e.g. while warming up)
+  unsigned reset(const RuntimeConfig& cfg) {
+    interval_ms_ = float(cfg.sample_ms);
+    proximity_ = 0.0f;
+    return cfg.sample_ms;
+  }
+};
@@ -0,0 +1,345 @@
+#pragma once
+#include "config.hpp"
+#include "runtime_config.hpp"
+#include "bf16.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Alerting policies for BasicAnomalyDetector.
+//
+// An alerting policy turns z-scores into per-stream active flags:
+//
+//   bool update(const float* z, std::size_t n, std::int64_t now_ms,
+//               const std::uint8_t* fresh);
+//
+// advances the streams with fresh[i] set (the others keep their state) and
+// returns true if any stream is active afterwards, plus
+// apply(const RuntimeConfig&) to pick up reloaded tunables. State
+// transitions are written as boolean arithmetic so the loop has no
+// data-dependent branches.
+
+// Default per-metric trigger threshold (|z| above this raises an alert)
+inline float default_threshold(std::size_t metric_idx) {
+  switch (metric_idx) {
+    case 0: return CPU_THRESHOLD;      // CPU_UTIL
+    case 1: return RAM_THRESHOLD;      // RAM_USED
+    case 2: return DISK_THRESHOLD;     // DISK_IO_RATE
+    case 3: return HEAP_THRESHOLD;     // HEAP_FREE
+    case 4: return UPTIME_THRESHOLD;   // UPTIME_MS
+    default: return Z_THRESHOLD;
+  }
+}
+
+// Default per-metric clearing threshold (|z| below this counts as normal)
+inline float default_hysteresis_threshold(std::size_t metric_idx) {
+  switch (metric_idx) {
+    case 0: return CPU_HYSTERESIS;
+    case 1: return RAM_HYSTERESIS;
+    case 2: return DISK_HYSTERESIS;
+    case 3: return HEAP_HYSTERESIS;
+    case 4: return UPTIME_HYSTERESIS;
+    default: return HYSTERESIS_THRESHOLD;
+  }
+}
+
+// Per-stream thresholds shared by all alerting policies
+class AlertThresholds {
+protected:
+  std::vector<float> thresholds_;
+  std::vector<float> hysteresis_thresholds_;
+  float default_threshold_{Z_THRESHOLD};            // for streams past the host metrics
+  float default_hysteresis_{HYSTERESIS_THRESHOLD};
+
+  void resize_thresholds(std::size_t n) {
+    std::size_t old = thresholds_.size();
+    thresholds_.resize(n);
+    hysteresis_thresholds_.resize(n);
+    for (std::size_t i = old; i < n; ++i) {
+      thresholds_[i] = (i < N_METRICS) ? default_threshold(i) : default_threshold_;
+      hysteresis_thresholds_[i] =
+        (i < N_METRICS) ? default_hysteresis_threshold(i) : default_hysteresis_;
+    }
+  }
+
+  // Host metrics take the per-metric values; other streams keep theirs
+  void apply_thresholds(const RuntimeConfig& cfg) {
+    default_threshold_  = cfg.z_threshold;
+    default_hysteresis_ = cfg.hysteresis_threshold;
+    for (std::size_t i = 0; i < N_METRICS && i < thresholds_.size(); ++i) {
+      thresholds_[i] = cfg.thresholds[i];
+      hysteresis_thresholds_[i] = cfg.hysteresis[i];
+    }
+  }
+
+public:
+  float threshold(std::size_t i) const { return thresholds_[i]; }
+  float hysteresis_threshold(std::size_t i) const { return hysteresis_thresholds_[i]; }
+
+  void set_thresholds(std::size_t i, float threshold, float hysteresis) {
+    thresholds_[i] = threshold;
+    hysteresis_thresholds_[i] = hysteresis;
+  }
+};
+
+// Trigger above threshold once the quiet time (min_quiet_time_ms) has passed
+// since the last alert; clear after hysteresis_samples consecutive samples
+// below the hysteresis threshold.
+class HysteresisAlerting : public AlertThresholds {
+  std::vector<std::uint8_t> active_;
+  std::vector<std::uint32_t> normal_samples_;
+  std::vector<std::int64_t> last_alert_ms_;
+  std::int64_t quiet_ms_{MIN_QUIET_TIME_MS};
+  std::uint32_t clear_samples_{HYSTERESIS_SAMPLES};
+
+public:
+  explicit HysteresisAlerting(std::size_t n = N_METRICS, std::int64_t now_ms = 0) {
+    resize(n, now_ms);
+  }
+
+  void resize(std::size_t n, std::int64_t now_ms) {
+    resize_thresholds(n);
+    active_.resize(n, 0);
+    normal_samples_.resize(n, 0);
+    last_alert_ms_.resize(n, now_ms);
+  }
+
+  void reset(std::size_t i, std::int64_t now_ms) {
+    active_[i] = 0;
+    normal_samples_[i] = 0;
+    last_alert_ms_[i] = now_ms;
+  }
+
+  void apply(const RuntimeConfig& cfg) {
+    apply_thresholds(cfg);
+    quiet_ms_ = cfg.min_quiet_time_ms;
+    clear_samples_ = cfg.hysteresis_samples;
+  }
+
+  bool active(std::size_t i) const { return active_[i] != 0; }
+
+  bool update(const float* z, std::size_t n, std::int64_t now_ms,
+              const std::uint8_t* fresh) {
+    const float* thr  = thresholds_.data();
+    const float* hyst = hysteresis_thresholds_.data();
+    std::uint8_t* active = active_.data();
+    std::uint32_t* normal = normal_samples_.data();
+    std::int64_t* last = last_alert_ms_.data();
+    const std::int64_t quiet_ms = quiet_ms_;
+    const std::uint32_t clear_samples = clear_samples_;
+    unsigned any = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      float az = std::fabs(z[i]);
+      unsigned f = fresh[i];
+      unsigned was = active[i];
+      unsigned quiet = (now_ms - last[i]) >= quiet_ms;
+      unsigned trigger = (was ^ 1u) & unsigned(az > thr[i]) & quiet & f;
+
+      // Count consecutive normal samples only while active
+      std::uint32_t count = (normal[i] + 1u) * (was & unsigned(az < hyst[i]));
+      unsigned clear = was & unsigned(count >= clear_samples) & f;
+
+      unsigned now_active = (was | trigger) & (clear ^ 1u);
+      active[i] = std::uint8_t(now_active);
+      normal[i] = f ? count * (clear ^ 1u) : normal[i];
+      last[i]   = trigger ? now_ms : last[i];
+      any |= now_active;
+    }
+    return any != 0;
+  }
+};
+
+// Trigger above threshold once the quiet time has passed since the last
+// alert; clear as soon as |z| falls back to the threshold.
+class QuietTimeAlerting : public AlertThresholds {
+  std::vector<std::uint8_t> active_;
+  std::vector<std::int64_t> last_alert_ms_;
+  std::int64_t quiet_ms_{MIN_QUIET_TIME_MS};
+
+public:
+  explicit QuietTimeAlerting(std::size_t n = N_METRICS, std::int64_t now_ms = 0) {
+    resize(n, now_ms);
+  }
+
+  void resize(std::size_t n, std::int64_t now_ms) {
+    resize_thresholds(n);
+    active_.resize(n, 0);
+    last_alert_ms_.resize(n, now_ms);
+  }
+
+  void reset(std::size_t i, std::int64_t now_ms) {
+    active_[i] = 0;
+    last_alert_ms_[i] = now_ms;
+  }
+
+  void apply(const RuntimeConfig& cfg) {
+    apply_thresholds(cfg);
+    quiet_ms_ = cfg.min_quiet_time_ms;
+  }
+
+  bool active(std::size_t i) const { return active_[i] != 0; }
+
+  bool update(const float* z, std::size_t n, std::int64_t now_ms,
+              const std::uint8_t* fresh) {
+    const float* thr = thresholds_.data();
+    std::uint8_t* active = active_.data();
+    std::int64_t* last = last_alert_ms_.data();
+    const std::int64_t quiet_ms = quiet_ms_;
+    unsigned any = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      unsigned f = fresh[i];
+      unsigned above = std::fabs(z[i]) > thr[i];
+      unsigned was = active[i];
+      unsigned quiet = (now_ms - last[i]) >= quiet_ms;
+      unsigned trigger = (was ^ 1u) & above & quiet & f;
+      unsigned now_active = f ? (was | trigger) & above : was;
+      active[i] = std::uint8_t(now_active);
+      last[i]   = trigger ? now_ms : last[i];
+      any |= now_active;
+    }
+    return any != 0;
+  }
+};
+
+// Stateless: a stream is active exactly while |z| exceeds its threshold
+class ThresholdAlerting : public AlertThresholds {
+  std::vector<std::uint8_t> active_;
+
+public:
+  explicit ThresholdAlerting(std::size_t n = N_METRICS, std::int64_t now_ms = 0) {
+    resize(n, now_ms);
+  }
+
+  void resize(std::size_t n, std::int64_t /*now_ms*/) {
+    resize_thresholds(n);
+    active_.resize(n, 0);
+  }
+
+  void reset(std::size_t i, std::int64_t /*now_ms*/) { active_[i] = 0; }
+
+  void apply(const RuntimeConfig& cfg) { apply_thresholds(cfg); }
+
+  bool active(std::size_t i) const { return active_[i] != 0; }
+
+  bool update(const float* z, std::size_t n, std::int64_t /*now_ms*/,
+              const std::uint8_t* fresh) {
+    const float* thr = thresholds_.data();
+    std::uint8_t* active = active_.data();
+    unsigned any = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      unsigned above = std::fabs(z[i]) > thr[i];
+      unsigned now_active = fresh[i] ? above : unsigned(active[i]);
+      active[i] = std::uint8_t(now_active);
+      any |= now_active;
+    }
+    return any != 0;
+  }
+};
+
+// HysteresisAlerting with 9 bytes of state per stream: active flag and
+// normal-sample count share one byte, the last alert time is a 32-bit offset
+// in COMPACT_TICK_MS ticks from construction (wraps after ~497 days; intervals
+// are taken modulo 2^32), and thresholds are bfloat16.
+class CompactHysteresisAlerting {
+  static constexpr std::uint8_t ACTIVE_BIT = 0x80;
+  static constexpr std::uint8_t COUNT_MASK = 0x7F;
+
+  std::vector<std::uint8_t> state_;        // active bit | normal count
+  std::vector<std::uint32_t> last_alert_;  // ticks since epoch_ms_
+  std::vector<std::uint16_t> thresholds_;  // bfloat16
+  std::vector<std::uint16_t> hysteresis_thresholds_;
+  std::int64_t epoch_ms_{0};
+  std::uint32_t quiet_ticks_{MIN_QUIET_TIME_MS / COMPACT_TICK_MS};
+  std::uint32_t clear_samples_{HYSTERESIS_SAMPLES};
+  float default_threshold_{Z_THRESHOLD};
+  float default_hysteresis_{HYSTERESIS_THRESHOLD};
+
+  std::uint32_t to_ticks(std::int64_t now_ms) const {
+    return std::uint32_t((now_ms - epoch_ms_) / COMPACT_TICK_MS);
+  }
+
+public:
+  explicit CompactHysteresisAlerting(std::size_t n = N_METRICS, std::int64_t now_ms = 0)
+    : epoch_ms_(now_ms) {
+    resize(n, now_ms);
+  }
+
+  void resize(std::size_t n, std::int64_t now_ms) {
+    std::size_t old = thresholds_.size();
+    state_.resize(n, 0);
+    last_alert_.resize(n, to_ticks(now_ms));
+    thresholds_.resize(n);
+    hysteresis_thresholds_.resize(n);
+    for (std::size_t i = old; i < n; ++i) {
+      thresholds_[i] = bf16_from_float(i < N_METRICS ? default_threshold(i) : default_threshold_);
+      hysteresis_thresholds_[i] = bf16_from_float(
+        i < N_METRICS ? default_hysteresis_threshold(i) : default_hysteresis_);
+    }
+  }
+
+  void reset(std::size_t i, std::int64_t now_ms) {
+    state_[i] = 0;
+    last_alert_[i] = to_ticks(now_ms);
+  }
+
+  void apply(const RuntimeConfig& cfg) {
+    default_threshold_  = cfg.z_threshold;
+    default_hysteresis_ = cfg.hysteresis_threshold;
+    for (std::size_t i = 0; i < N_METRICS && i < thresholds_.size(); ++i) {
+      thresholds_[i] = bf16_from_float(cfg.thresholds[i]);
+      hysteresis_thresholds_[i] = bf16_from_float(cfg.hysteresis[i]);
+    }
+    quiet_ticks_ = cfg.min_quiet_time_ms / COMPACT_TICK_MS;
+    // The count field holds at most COUNT_MASK
+    clear_samples_ = cfg.hysteresis_samples < COUNT_MASK ? cfg.hysteresis_samples : COUNT_MASK;
+  }
+
+  float threshold(std::size_t i) const { return bf16_to_float(thresholds_[i]); }
+  float hysteresis_threshold(std::size_t i) const {
+    return bf16_to_float(hysteresis_thresholds_[i]);
+  }
+
+  void set_thresholds(std::size_t i, float threshold, float hysteresis) {
+    thresholds_[i] = bf16_from_float(threshold);
+    hysteresis_thresholds_[i] = bf16_from_float(hysteresis);
+  }
+
+  bool active(std::size_t i) const { return (state_[i] & ACTIVE_BIT) != 0; }
+
+  std::size_t state_bytes_per_stream() const {
+    return sizeof(std::uint8_t) + sizeof(std::uint32_t) + 2 * sizeof(std::uint16_t);
+  }
+
+  bool update(const float* z, std::size_t n, std::int64_t now_ms,
+              const std::uint8_t* fresh) {
+    const std::uint16_t* thr  = thresholds_.data();
+    const std::uint16_t* hyst = hysteresis_thresholds_.data();
+    std::uint8_t* state = state_.data();
+    std::uint32_t* last = last_alert_.data();
+    const std::uint32_t now = to_ticks(now_ms);
+    const std::uint32_t quiet_ticks = quiet_ticks_;
+    const std::uint32_t clear_samples = clear_samples_;
+    unsigned any = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      float az = std::fabs(z[i]);
+      unsigned f = fresh[i];
+      unsigned st = state[i];
+      unsigned was = st >> 7;
+      unsigned quiet = (now - last[i]) >= quiet_ticks;
+      unsigned trigger = (was ^ 1u) & unsigned(az > bf16_to_float(thr[i])) & quiet & f;
+
+      unsigned count = ((st & COUNT_MASK) + 1u) * (was & unsigned(az < bf16_to_float(hyst[i])));
+      unsigned clear = was & unsigned(count >= clear_samples) & f;
+
+      unsigned now_active = (was | trigger) & (clear ^ 1u);
+      count = count * (clear ^ 1u);
+      count = count > COUNT_MASK ? COUNT_MASK : count;
+      std::uint8_t next = std::uint8_t((now_active << 7) | count);
+      state[i] = f ? next : state[i];
+      last[i]  = trigger ? now : last[i];
+      any |= now_active;
+    }
+    return any != 0;
+  }
+};
@@ -0,0 +1,152 @@
+#pragma once
+#include "config.hpp"
+#include "timeline_export.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Segment file layout: header page, sparse index, then fixed-size records.
+// A record is complete once `count` covers it, so a process killed mid-append
+// leaves at most one uncommitted record behind.
+struct JournalSegmentHeader {
+  char magic[8];                // "ANOMJRN1"
+  std::uint32_t record_size;    // sizeof(TimelineRecord)
+  std::uint32_t index_stride;   // records per index entry
+  std::uint64_t capacity;       // records
+  std::uint64_t count;          // committed records
+  std::int64_t first_ms;
+  std::int64_t last_ms;
+  std::uint64_t reserved[2];
+};
+static_assert(sizeof(JournalSegmentHeader) == 64, "journal header layout");
+
+// One per index_stride records
+struct JournalIndexEntry {
+  std::int64_t first_ms;        // timestamp of the block's first record
+  std::uint64_t metric_mask;    // bit m: metric m occurs in the block (63: any index >= 63)
+};
+
+// Append-only anomaly journal in preallocated, memory-mapped segment files.
+// Timestamps within a segment are non-decreasing (a wall clock stepping
+// back by up to JOURNAL_CLOCK_STEP_MS is recorded at the segment's latest
+// time; a larger step starts a new segment), so each
+// segment's index can be binary searched: a time-range query costs O(log n)
+// per segment plus the matching records, and blocks without the requested
+// metric are skipped whole.
+// Without a directory (or on platforms without mmap) segments live on the
+// heap and nothing survives the process.
+class AnomalyJournal {
+public:
+  static constexpr std::uint32_t ANY_METRIC = 0xFFFFFFFFu;
+
+  AnomalyJournal() = default;
+  ~AnomalyJournal();
+  AnomalyJournal(const AnomalyJournal&) = delete;
+  AnomalyJournal& operator=(const AnomalyJournal&) = delete;
+
+  // Map existing segments in `dir` (created if missing) and append after
+  // them; an empty `dir` keeps the journal in memory
+  bool open(const std::string& dir, std::string& error);
+  void close();
+
+  bool persistent() const { return !dir_.empty(); }
+  const std::string& directory() const { return dir_; }
+
+  // Plain stores into the current segment; opens a new segment (and drops
+  // the oldest past JOURNAL_MAX_SEGMENTS) when it is full or unix_ms is
+  // more than JOURNAL_CLOCK_STEP_MS before its last record. Returns false
+  // only if a new segment could not be created.
+  bool append(std::int64_t unix_ms, std::uint32_t metric_index, float value, float z_score,
+              std::uint32_t incident = 0);
+
+  // Records currently retained; at(0) is the oldest
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const TimelineRecord& at(std::size_t i) const;
+
+  // Delete every record and segment file
+  void clear();
+
+  // Sequence numbers count records since open(); at(i) is first_seq() + i
+  std::uint64_t first_seq() const { return first_seq_; }
+
+  // While pinned, segments dropped past JOURNAL_MAX_SEGMENTS stay mapped
+  // (their files are still deleted), so read() keeps finding records a
+  // reader started on
+  void pin() { ++pins_; }
+  void unpin();
+
+  // Copy up to `max` records from sequence number `seq` on into `out`;
+  // returns how many (0 once `seq` is gone or past the end)
+  std::size_t read(std::uint64_t seq, TimelineRecord* out, std::size_t max) const;
+
+  // Call f(record) for records with from_ms <= unix_ms <= to_ms in the order
+  // they were appended (oldest first unless the clock stepped back)
+  template <class F>
+  void for_each(std::int64_t from_ms, std::int64_t to_ms, std::uint32_t metric, F&& f) const {
+    const std::uint64_t bit = metric_bit(metric);
+    for (const Segment& seg : segments_) {
+      const JournalSegmentHeader& h = *seg.header;
+      if (h.count == 0 || h.last_ms < from_ms || h.first_ms > to_ms) continue;
+
+      // Last block starting before from_ms: records at from_ms may end the
+      // block before the first one starting at it
+      std::size_t lo = 0, hi = (h.count + h.index_stride - 1) / h.index_stride;
+      while (hi - lo > 1) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (seg.index[mid].first_ms < from_ms) lo = mid; else hi = mid;
+      }
+
+      bool past = false;
+      for (std::size_t b = lo; !past && b * h.index_stride < h.count; ++b) {
+        if (seg.index[b].first_ms > to_ms) break;
+        if (metric != ANY_METRIC && (seg.index[b].metric_mask & bit) == 0) continue;
+        std::size_t end = (b + 1) * h.index_stride;
+        if (end > h.count) end = h.count;
+        for (std::size_t r = b * h.index_stride; r < end; ++r) {
+          const TimelineRecord& rec = seg.records[r];
+          if (rec.unix_ms < from_ms) continue;
+          if (rec.unix_ms > to_ms) {
+            past = true;
+            break;
+          }
+          if (metric == ANY_METRIC || rec.metric_index == metric) f(rec);
+        }
+      }
+    }
+  }
+
+  template <class F>
+  void for_each(F&& f) const {
+    for_each(INT64_MIN, INT64_MAX, ANY_METRIC, f);
+  }
+
+private:
+  struct Segment {
+    JournalSegmentHeader* header{nullptr};
+    JournalIndexEntry* index{nullptr};
+    TimelineRecord* records{nullptr};
+    void* base{nullptr};
+    std::size_t bytes{0};
+    std::uint64_t number{0};
+    std::uint64_t first_seq{0};
+  };
+
+  static std::uint64_t metric_bit(std::uint32_t metric) {
+    return std::uint64_t(1) << (metric < 63 ? metric : 63);
+  }
+
+  std::string segment_path(std::uint64_t number) const;
+  bool map_segment(std::uint64_t number, bool create, Segment& out, std::string& error);
+  void unmap_segment(Segment& seg);
+  bool add_segment(std::string& error);
+
+  std::vector<Segment> segments_;
+  std::vector<Segment> retired_;      // dropped while pinned
+  unsigned pins_{0};
+  std::size_t size_{0};
+  std::uint64_t first_seq_{0};
+  std::string dir_;
+  std::uint64_t next_number_{1};
+};
@@ -0,0 +1,221 @@
+#pragma once
+#include "config.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Streaming quantile estimate in O(1) memory and time per sample: the P²
+// algorithm (Jain & Chlamtac, CACM 1985) keeps five markers whose heights
+// track the min, p/2, p, (1+p)/2 and max quantiles and moves them with a
+// piecewise-parabolic fit as samples arrive. Exact for the first five
+// samples.
+class P2Quantile {
+  double p_{0.5};
+  std::uint64_t count_{0};
+  double height_[5]{};
+  double pos_[5]{};        // actual marker positions (1-based)
+  double want_[5]{};       // desired positions
+  double step_[5]{};       // desired position increment per sample
+
+public:
+  explicit P2Quantile(double p = 0.5) : p_(p) {
+    step_[0] = 0.0;
+    step_[1] = p / 2.0;
+    step_[2] = p;
+    step_[3] = (1.0 + p) / 2.0;
+    step_[4] = 1.0;
+  }
+
+  std::uint64_t count() const { return count_; }
+
+  void add(double x) {
+    if (count_ < 5) {
+      // Insertion sort into the first five
+      std::size_t i = static_cast<std::size_t>(count_);
+      while (i > 0 && height_[i - 1] > x) {
+        height_[i] = height_[i - 1];
+        --i;
+      }
+      height_[i] = x;
+      if (++count_ == 5) {
+        for (int k = 0; k < 5; ++k) {
+          pos_[k] = k + 1;
+          want_[k] = 1.0 + 4.0 * step_[k];
+        }
+      }
+      return;
+    }
+    ++count_;
+
+    // Cell holding x; extremes stretch
+    int k;
+    if (x < height_[0]) {
+      height_[0] = x;
+      k = 0;
+    } else if (x >= height_[4]) {
+      height_[4] = x > height_[4] ? x : height_[4];
+      k = 3;
+    } else {
+      k = 0;
+      while (x >= height_[k + 1]) ++k;
+    }
+    for (int i = k + 1; i < 5; ++i) pos_[i] += 1.0;
+    for (int i = 0; i < 5; ++i) want_[i] += step_[i];
+
+    // Nudge the middle markers toward their desired positions
+    for (int i = 1; i <= 3; ++i) {
+      double d = want_[i] - pos_[i];
+      if ((d >= 1.0 && pos_[i + 1] - pos_[i] > 1.0) || (d <= -1.0 && pos_[i - 1] - pos_[i] < -1.0)) {
+        double s = d > 0.0 ? 1.0 : -1.0;
+        double q = parabolic(i, s);
+        height_[i] = (height_[i - 1] < q && q < height_[i + 1]) ? q : linear(i, s);
+        pos_[i] += s;
+      }
+    }
+  }
+
+  double value() const {
+    if (count_ == 0) return 0.0;
+    if (count_ < 5) {
+      // Nearest rank over the sorted samples so far
+      std::size_t i = static_cast<std::size_t>(p_ * double(count_ - 1) + 0.5);
+      return height_[i];
+    }
+    return height_[2];
+  }
+
+private:
+  double parabolic(int i, double s) const {
+    return height_[i] + s / (pos_[i + 1] - pos_[i - 1]) *
+      ((pos_[i] - pos_[i - 1] + s) * (height_[i + 1] - height_[i]) / (pos_[i + 1] - pos_[i]) +
+       (pos_[i + 1] - pos_[i] - s) * (height_[i] - height_[i - 1]) / (pos_[i] - pos_[i - 1]));
+  }
+  double linear(int i, double s) const {
+    int j = i + static_cast<int>(s);
+    return height_[i] + s * (height_[j] - height_[i]) / (pos_[j] - pos_[i]);
+  }
+};
+
+// Running aggregates over the anomaly records, updated as each one is
+// journaled so the statistics view never rescans the timeline.
+//
+// A stream is recorded once per incident (journals from before incidents
+// hold an active alert on every sample), and records of a metric less than
+// ANOMALY_EPISODE_GAP_MS apart are folded into one episode;
+// mean time between anomalies is measured between episode starts. Rates
+// come from a ring of STATS_RATE_BUCKETS per-minute counters.
+//
+// The host metrics [0, size()) are kept one by one. Streams beyond them
+// (processes, cgroups, logs, ...) come and go and reuse ids, so they share
+// one aggregate, others(), whose episodes span all of them; every record
+// counts in total().
+class AnomalyStats {
+public:
+  static constexpr std::size_t QUANTILES = 3;
+  static constexpr double QUANTILE_P[QUANTILES] = { 0.5, 0.9, 0.99 };
+
+  struct Metric {
+    std::uint64_t records{0};
+    std::uint64_t episodes{0};
+    float max_abs_z{0.0f};
+    double sum_abs_z{0.0};
+    std::int64_t first_episode_ms{0};
+    std::int64_t last_episode_ms{0};
+    std::int64_t last_ms{INT64_MIN};
+    P2Quantile abs_z[QUANTILES]{ P2Quantile(QUANTILE_P[0]), P2Quantile(QUANTILE_P[1]),
+                                 P2Quantile(QUANTILE_P[2]) };
+
+    double mean_abs_z() const { return records ? sum_abs_z / double(records) : 0.0; }
+    // Mean time between episode starts; 0 until there are two
+    double mtba_ms() const {
+      return episodes > 1 ? double(last_episode_ms - first_episode_ms) / double(episodes - 1) : 0.0;
+    }
+  };
+
+  explicit AnomalyStats(std::size_t n = N_METRICS) { resize(n); }
+
+  void resize(std::size_t n) {
+    metrics_.resize(n + 1);
+    bucket_id_.assign(STATS_RATE_BUCKETS, EMPTY);
+    bucket_count_.assign(STATS_RATE_BUCKETS * (n + 2), 0);
+    n_ = n;
+  }
+
+  void reset() {
+    std::size_t n = n_;
+    metrics_.assign(n + 1, Metric());
+    total_ = Metric();
+    resize(n);
+  }
+
+  void add(std::int64_t unix_ms, std::size_t metric, float z) {
+    const bool other = metric >= n_;
+    const float az = std::fabs(z);
+    Metric& m = metrics_[other ? n_ : metric];
+    bool new_episode = m.last_ms == INT64_MIN || unix_ms - m.last_ms > std::int64_t(ANOMALY_EPISODE_GAP_MS);
+    record(m, unix_ms, az, new_episode);
+    record(total_, unix_ms, az, new_episode);
+
+    // Per-minute rate ring: a slot still holding an older minute starts over
+    std::int64_t bucket = bucket_of(unix_ms);
+    std::size_t slot = slot_of(bucket);
+    std::uint32_t* counts = bucket_count_.data() + slot * (n_ + 2);
+    if (bucket_id_[slot] != bucket) {
+      bucket_id_[slot] = bucket;
+      for (std::size_t i = 0; i < n_ + 2; ++i) counts[i] = 0;
+    }
+    ++counts[other ? n_ + 1 : metric];
+    ++counts[n_];
+  }
+
+  std::size_t size() const { return n_; }
+  const Metric& metric(std::size_t i) const { return metrics_[i]; }
+  const Metric& others() const { return metrics_[n_]; }
+  const Metric& total() const { return total_; }
+
+  // Records in the `minutes` (<= STATS_RATE_BUCKETS) minutes up to now_ms,
+  // for one metric or, with metric == size(), all of them, or with
+  // size() + 1, the streams beyond the host metrics
+  std::uint64_t recent(std::int64_t now_ms, unsigned minutes, std::size_t metric) const {
+    if (minutes > STATS_RATE_BUCKETS) minutes = STATS_RATE_BUCKETS;
+    std::int64_t last = bucket_of(now_ms);
+    std::uint64_t sum = 0;
+    for (std::int64_t b = last - std::int64_t(minutes) + 1; b <= last; ++b) {
+      std::size_t slot = slot_of(b);
+      if (bucket_id_[slot] == b) sum += bucket_count_[slot * (n_ + 2) + metric];
+    }
+    return sum;
+  }
+
+private:
+  static constexpr std::int64_t EMPTY = INT64_MIN;
+
+  static void record(Metric& m, std::int64_t unix_ms, float az, bool new_episode) {
+    ++m.records;
+    m.max_abs_z = az > m.max_abs_z ? az : m.max_abs_z;
+    m.sum_abs_z += az;
+    for (P2Quantile& q : m.abs_z) q.add(az);
+    if (new_episode) {
+      if (m.episodes == 0) m.first_episode_ms = unix_ms;
+      m.last_episode_ms = unix_ms;
+      ++m.episodes;
+    }
+    m.last_ms = unix_ms;
+  }
+
+  static std::int64_t bucket_of(std::int64_t t_ms) {
+    std::int64_t q = t_ms / STATS_RATE_BUCKET_MS;
+    return (t_ms % STATS_RATE_BUCKET_MS < 0) ? q - 1 : q;
+  }
+  static std::size_t slot_of(std::int64_t bucket) {
+    std::int64_t r = bucket % std::int64_t(STATS_RATE_BUCKETS);
+    return static_cast<std::size_t>(r < 0 ? r + std::int64_t(STATS_RATE_BUCKETS) : r);
+  }
+
+  std::size_t n_{0};
+  std::vector<Metric> metrics_;
+  Metric total_;
+  std::vector<std::int64_t> bucket_id_;
+  std::vector<std::uint32_t> bucket_count_;   // [slot * (n + 2) + metric], then the total and others
+};
@@ -0,0 +1,100 @@
+#pragma once
+#include "config.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Reads many small files (proc and sysfs pseudo-files held open by the
+// collectors) from offset 0 in one batch. Files are attached once and get
+// a slot with their own buffer; each round the collectors queue the slots
+// they want, one submit() reads them all, and the results stay in the
+// slots until the next submit.
+//
+// Engines:
+//  - io_uring (Linux): the whole batch goes in with one io_uring_enter per
+//    BATCH_READ_RING_ENTRIES reads, with the files registered as fixed
+//    files and the buffers as fixed buffers where the kernel and
+//    RLIMIT_MEMLOCK allow (plain fds and buffers otherwise).
+//  - pread: one pread per queued slot, back to back. This is where io_uring
+//    is unavailable (old kernel, io_uring_disabled, seccomp), and also what
+//    AUTO picks when it measures faster: proc files do not support
+//    non-blocking reads, so io_uring hands each one to a kernel worker
+//    thread, which on small hosts costs more than the syscalls it saves.
+//
+// AUTO times the first BATCH_READ_CALIBRATE batches on each engine and
+// keeps the faster per read.
+class BatchReader {
+public:
+  using Slot = std::uint32_t;
+  static constexpr Slot NONE = UINT32_MAX;
+
+  enum class Engine { AUTO, URING, PREAD };
+
+  explicit BatchReader(Engine engine = Engine::AUTO);
+  ~BatchReader();
+  BatchReader(const BatchReader&) = delete;
+  BatchReader& operator=(const BatchReader&) = delete;
+
+  // A slot reading `fd` into a buffer of at least `bytes` (NONE if there is
+  // no room). The fd stays the caller's; detach before closing it.
+  Slot attach(int fd, std::size_t bytes);
+  void detach(Slot slot);
+
+  // Read the slot's file from offset 0 in the next submit()
+  void queue(Slot slot);
+  bool queued() const { return !queue_.empty(); }
+
+  // Read everything queued
+  void submit();
+
+  // Of the last read of a slot: bytes read or -errno, and the data (NUL
+  // terminated)
+  long result(Slot slot) const { return slots_[slot].result; }
+  const char* data(Slot slot) const { return buffer(slots_[slot]); }
+
+  // Engine in use (AUTO: the one calibration settled on, "auto" before)
+  const char* engine_name() const;
+  std::uint64_t reads() const { return reads_; }
+  std::uint64_t syscalls() const { return syscalls_; }
+  std::uint64_t batches() const { return batches_; }
+
+private:
+  struct SlotInfo {
+    int fd{-1};
+    std::uint32_t block{0};
+    std::uint32_t offset{0};
+    std::uint32_t size_class{0};
+    long result{0};
+    bool fixed_file{false};
+    bool live{false};
+  };
+
+  char* buffer(const SlotInfo& s) const { return blocks_[s.block] + s.offset; }
+  bool take_buffer(std::uint32_t size_class, SlotInfo& s);
+
+  void submit_pread();
+  bool uring_open();
+  void uring_close();
+  bool submit_uring();
+  bool register_buffers();
+
+  Engine engine_;
+  Engine active_;                     // URING or PREAD once known
+  std::vector<SlotInfo> slots_;
+  std::vector<Slot> free_slots_;
+  std::vector<Slot> queue_;
+  std::vector<char*> blocks_;         // BATCH_READ_BLOCK_BYTES each
+  std::uint32_t block_used_{BATCH_READ_BLOCK_BYTES};   // in the last block
+  std::vector<std::vector<std::uint64_t>> free_buffers_;   // block << 32 | offset, by size class
+
+  std::uint64_t reads_{0};
+  std::uint64_t syscalls_{0};
+  std::uint64_t batches_{0};
+  double calib_us_[2]{0.0, 0.0};      // per read: io_uring, pread
+  std::uint64_t calib_reads_[2]{0, 0};
+  unsigned calib_batches_[2]{0, 0};
+
+  // io_uring state (Linux), null when the pread engine is all there is
+  struct Ring;
+  Ring* ring_{nullptr};
+};
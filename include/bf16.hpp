@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// bfloat16 helpers for compact detector state: the top 16 bits of an IEEE
+// float (same range, 8 significant bits). Conversions are plain integer ops
+// so loops using them still vectorize.
+
+inline std::uint32_t float_bits(float f) {
+  std::uint32_t u;
+  std::memcpy(&u, &f, sizeof(u));
+  return u;
+}
+
+inline float bits_float(std::uint32_t u) {
+  float f;
+  std::memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+inline float bf16_to_float(std::uint16_t h) {
+  return bits_float(std::uint32_t(h) << 16);
+}
+
+// Round to nearest even (for values written once, e.g. thresholds)
+inline std::uint16_t bf16_from_float(float f) {
+  std::uint32_t u = float_bits(f);
+  u += 0x7FFFu + ((u >> 16) & 1u);
+  return std::uint16_t(u >> 16);
+}
+
+// Stochastic rounding with 16 random bits: unbiased in expectation, so a
+// value nudged by updates much smaller than its ulp still tracks on average
+inline std::uint16_t bf16_from_float_sr(float f, std::uint32_t rand16) {
+  return std::uint16_t((float_bits(f) + (rand16 & 0xFFFFu)) >> 16);
+}
+
+// 2^e as a float, for e in [-126, 127]
+inline float exp2i(int e) {
+  return bits_float(std::uint32_t(e + 127) << 23);
+}
+
+// floor(log2(f)) for a positive normal float
+inline int ilog2f(float f) {
+  return int((float_bits(f) >> 23) & 0xFFu) - 127;
+}
+
+// Cheap per-(stream, tick) random bits for stochastic rounding
+inline std::uint32_t mix_bits(std::uint32_t stream, std::uint32_t tick) {
+  std::uint32_t h = stream * 0x9E3779B1u ^ tick * 0x85EBCA77u;
+  h ^= h >> 15;
+  h *= 0x2C1B3C6Du;
+  h ^= h >> 12;
+  return h;
+}
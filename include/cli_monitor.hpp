@@ -1,10 +1,22 @@
 #pragma once
 #include "config.hpp"
 #include "metrics.hpp"
+#include "runtime_config.hpp"
+#include "timeline_export.hpp"
+#include "anomaly_journal.hpp"
+#include "anomaly_stats.hpp"
+#include "incident.hpp"
+#include "lead_lag.hpp"
+#include "sample_history.hpp"
+#include "rollup.hpp"
+#include "realtime.hpp"
 #include <vector>
 #include <string>
 #include <chrono>
 #include <memory>
+#include <mutex>
+
+class StreamTable;
 
 // Anomaly event record
 struct AnomalyEvent {
@@ -13,6 +25,12 @@ struct AnomalyEvent {
     float value;
     float z_score;
     std::string metric_name;
+    // Streams that moved before this one, strongest first (from the sample
+    // history; empty without one)
+    std::vector<LeadingIndicator> leaders;
+    // Change-point scoring: how long before this sample the change began
+    // (-1 if not known)
+    std::int64_t change_age_ms{-1};
     
     AnomalyEvent(std::size_t idx, float val, float z) 
         : timestamp(std::chrono::system_clock::now())
@@ -21,18 +39,36 @@ struct AnomalyEvent {
         , z_score(z)
         , metric_name(get_metric_name(idx)) {}
     
-    // Get metric name for display
+    // Get metric name for display (collector streams by their table name)
     static std::string get_metric_name(std::size_t idx);
 };
 
 // Enhanced CLI Monitor with real-time display and alarm effects
 class CLIMonitor {
 private:
-    std::vector<AnomalyEvent> anomaly_timeline_;
+    AnomalyJournal journal_;
+    // Aggregates over journal_, kept in step with it for show_statistics
+    AnomalyStats stats_;
+    // Groups the anomalies of all streams; alarms are raised per incident
+    IncidentCorrelator incidents_;
+    // Leading indicators for each reported anomaly, from history_, for at
+    // most LEAD_MAX_PER_ROUND of them per round (the round is its now_ms)
+    LeadLagAnalyzer lead_lag_;
+    std::int64_t lead_round_ms_{INT64_MIN};
+    unsigned lead_left_{0};
+    // Held while the journal is modified, and by the exporter thread while
+    // it copies a chunk out (the main thread reads without it)
+    std::mutex timeline_mutex_;
+    TimelineExporter exporter_;
     std::chrono::system_clock::time_point last_alarm_time_;
     bool alarm_active_{false};
     unsigned alarm_count_{0};
     bool interactive_mode_{false};
+    unsigned sample_interval_ms_{0};    // shown while sampling adaptively
+    const ConfigStore* config_{nullptr};
+    const SampleHistory* history_{nullptr};
+    const RollupStore* rollups_{nullptr};
+    const RealtimeSampler* realtime_{nullptr};
     
     // Terminal control sequences
     static constexpr const char* CLEAR_SCREEN = "\033[2J";
@@ -61,11 +97,28 @@ public:
                        unsigned sample_count,
                        bool warming_up);
     
-    // Handle anomaly detection
-    void handle_anomaly(std::size_t metric_idx, float value, float z_score);
+    // An anomalous sample of a stream at steady time now_ms, with the steady
+    // time its change began if the scoring policy tracks it (INT64_MIN
+    // otherwise). A stream is journaled and printed when it joins an
+    // incident, and again when it fires after a quiet INCIDENT_GAP_MS; an
+    // incident opening raises the alarm.
+    void handle_anomaly(std::size_t metric_idx, float value, float z_score, std::int64_t now_ms,
+                        std::int64_t onset_ms = INT64_MIN);
+    
+    // Close the open incident once it has been quiet for INCIDENT_GAP_MS or
+    // has run for INCIDENT_MAX_MS, printing its summary; call every round
+    void expire_incidents(std::int64_t now_ms);
+    
+    // A stream that came or went starts outside any incident
+    void reset_stream(std::size_t metric_idx) { incidents_.reset_stream(std::uint32_t(metric_idx)); }
     
-    // Display anomaly timeline
+    // Display anomaly timeline: everything, or the last `minutes` minutes
+    // of one metric (AnomalyJournal::ANY_METRIC for all)
     void show_timeline();
+    void show_timeline(unsigned minutes, std::uint32_t metric);
+    
+    // Persist anomalies under `dir` (empty: keep them in memory only)
+    bool open_journal(const std::string& dir, std::string& error);
     
     // Clear screen and setup
     void setup_display();
@@ -79,8 +132,29 @@ public:
     void show_help();
     void show_statistics();
     void clear_timeline();
+    // Start a background export; format from the extension (.csv, .jsonl, .bin)
     void export_timeline(const std::string& filename);
     
+    // Read thresholds and timing from published config snapshots
+    void set_config(const ConfigStore* store) { config_ = store; }
+    
+    // Recent raw samples for the history view
+    void set_history(const SampleHistory* history) { history_ = history; }
+    void show_history(unsigned minutes);
+    
+    // Long-range context (last hour / day / 30 days) from rollup buckets
+    void set_rollups(const RollupStore* rollups) { rollups_ = rollups; }
+    void show_rollups();
+    
+    // Current adaptive sampling interval (0: fixed rate, not shown)
+    void set_sample_interval(unsigned ms) { sample_interval_ms_ = ms; }
+    
+    // Real-time sampler state and wakeup latency for the status bar
+    void set_realtime(const RealtimeSampler* rt) { realtime_ = rt; }
+    
+    // Names of the streams past the host metrics (per-process streams)
+    void set_streams(const StreamTable* streams);
+    
     // Toggle interactive mode
     void set_interactive_mode(bool enabled) { interactive_mode_ = enabled; }
     bool is_interactive_mode() const { return interactive_mode_; }
@@ -93,14 +167,21 @@ private:
                            unsigned sample_count,
                            bool warming_up);
     void draw_status_bar();
+    void draw_export_status();
     void draw_timeline_panel();
     void trigger_alarm();
     void clear_alarm();
+    void print_incident_summary(const Incident& incident);
+    std::string format_leader(const LeadingIndicator& leader);
+    std::string format_duration(std::int64_t ms);
     std::string format_value(float val, std::size_t metric_idx);
     std::string get_status_color(float z_score);
     std::string get_metric_unit(std::size_t metric_idx);
     void draw_progress_bar(float percentage, int width = 20);
-    std::string format_timestamp(const std::chrono::system_clock::time_point& tp);
+    void draw_sparkline(const std::vector<RollupSummary>& buckets);
+    std::string format_timestamp(const std::chrono::system_clock::time_point& tp, bool with_date = false);
+    std::string format_timestamp_ms(std::int64_t unix_ms, bool with_date = false);
     float get_metric_threshold(std::size_t metric_idx);
     float get_hysteresis_threshold(std::size_t metric_idx);
+    const RuntimeConfig& config() const;
 }; 
\ No newline at end of file
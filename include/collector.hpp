@@ -0,0 +1,225 @@
+#pragma once
+#include "config.hpp"
+#include "metrics.hpp"
+#include "platform_metrics.hpp"
+#include "batch_reader.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Names of the detector's streams and the ids they occupy. The host metrics
+// hold ids 0..N_METRICS-1 in Metric order (so per-metric thresholds and the
+// display keep working); collectors add their own streams after them and
+// release them when the source goes away. Released ids are reused lowest
+// first so the detector's arrays stay dense; whoever owns per-stream state
+// polls take_changed() and starts those ids over. Each stream also carries
+// the step fixed-point scoring quantizes it to, chosen by its collector for
+// its unit (the *_QUANTUM constants).
+class StreamTable {
+public:
+  static constexpr std::uint32_t NONE = UINT32_MAX;
+
+  StreamTable() {
+    static const char* const host[N_METRICS] = { "cpu", "ram", "disk", "heap", "uptime" };
+    static const float quanta[N_METRICS] = { CPU_QUANTUM, RAM_QUANTUM, DISK_QUANTUM, HEAP_QUANTUM,
+                                             DEFAULT_QUANTUM };
+    for (std::size_t m = 0; m < N_METRICS; ++m) add(host[m], quanta[m]);
+    changed_.clear();
+  }
+
+  // Id of `name`, registering it with `quantum` if it is not live
+  std::uint32_t add(const std::string& name, float quantum = DEFAULT_QUANTUM) {
+    auto it = ids_.find(name);
+    if (it != ids_.end()) return it->second;
+    std::uint32_t id;
+    if (!free_.empty()) {
+      id = free_.top();
+      free_.pop();
+      names_[id] = name;
+      quanta_[id] = quantum;
+    } else {
+      id = std::uint32_t(names_.size());
+      names_.push_back(name);
+      quanta_.push_back(quantum);
+    }
+    ids_.emplace(name, id);
+    changed_.push_back(id);
+    return id;
+  }
+
+  void release(std::uint32_t id) {
+    if (id < N_METRICS || id >= names_.size() || names_[id].empty()) return;
+    ids_.erase(names_[id]);
+    names_[id].clear();
+    free_.push(id);
+    changed_.push_back(id);
+  }
+
+  std::uint32_t find(const std::string& name) const {
+    auto it = ids_.find(name);
+    return it == ids_.end() ? NONE : it->second;
+  }
+
+  // One past the highest id in use so far
+  std::size_t size() const { return names_.size(); }
+  bool live(std::uint32_t id) const { return id < names_.size() && !names_[id].empty(); }
+  const std::string& name(std::uint32_t id) const { return names_[id]; }
+  float quantum(std::uint32_t id) const { return quanta_[id]; }
+
+  // Ids assigned or released since the last call; false if there were none
+  bool take_changed(std::vector<std::uint32_t>& out) {
+    out.swap(changed_);
+    changed_.clear();
+    return !out.empty();
+  }
+
+private:
+  std::vector<std::string> names_;   // empty: free
+  std::vector<float> quanta_;
+  std::unordered_map<std::string, std::uint32_t> ids_;
+  std::priority_queue<std::uint32_t, std::vector<std::uint32_t>, std::greater<std::uint32_t>> free_;
+  std::vector<std::uint32_t> changed_;
+};
+
+// Readings gathered by the collectors of one scheduler round. Values persist
+// between rounds (the last reading of every stream); fresh() marks the ones
+// taken this round, which is the mask the detector is fed with.
+class SampleSink {
+public:
+  explicit SampleSink(std::size_t n = N_METRICS) { resize(n); }
+
+  void resize(std::size_t n) {
+    values_.resize(n, 0.0f);
+    fresh_.resize(n, 0);
+  }
+
+  void begin_round() {
+    fresh_.assign(fresh_.size(), 0);
+    counters_.clear();
+    any_ = false;
+  }
+
+  void put(std::uint32_t stream, float value) {
+    if (stream >= values_.size()) resize(stream + 1);
+    values_[stream] = value;
+    fresh_[stream] = 1;
+    any_ = true;
+  }
+
+  // Exact 64-bit counter reading behind a stream (see stage_counter)
+  void put_counter(std::uint32_t stream, std::uint64_t reading) {
+    counters_.emplace_back(stream, reading);
+  }
+
+  std::size_t size() const { return values_.size(); }
+  bool any() const { return any_; }
+  const float* values() const { return values_.data(); }
+  const std::uint8_t* fresh() const { return fresh_.data(); }
+  const std::vector<std::pair<std::uint32_t, std::uint64_t>>& counters() const { return counters_; }
+
+private:
+  std::vector<float> values_;
+  std::vector<std::uint8_t> fresh_;
+  std::vector<std::pair<std::uint32_t, std::uint64_t>> counters_;
+  bool any_{false};
+};
+
+// A source of one or more streams sampled at its own rate. The scheduler
+// asks interval_ms() again each time it re-arms the collector, so it may
+// change while running.
+class Collector {
+public:
+  virtual ~Collector() = default;
+
+  virtual const char* name() const = 0;
+
+  // Time between collections
+  virtual unsigned interval_ms() const = 0;
+
+  // Typical cost of one collect() in microseconds; the scheduler spreads
+  // expensive collectors over different ticks
+  virtual unsigned cost_us() const = 0;
+
+  // Register streams; false if the source is not available on this host
+  virtual bool open(StreamTable& streams) = 0;
+
+  // Queue this round's file reads on `io`. The scheduler reads what every
+  // due collector queued in one batch, then calls collect(), where the
+  // results are in the slots (and where a collector may submit a second
+  // batch of its own). Collectors reading their files directly skip this.
+  virtual void prepare(BatchReader&) {}
+
+  // Take one reading of every stream into `sink`
+  virtual void collect(std::int64_t now_ms, SampleSink& sink) = 0;
+
+  // A descriptor that polls readable (or urgent) when the collector should
+  // run before its interval is up, e.g. on a kernel event; -1 if none. Asked
+  // once, after open(); see CollectorScheduler::wake().
+  virtual int wake_fd() const { return -1; }
+};
+
+// All host metrics from a PlatformMetrics in one collection, at one interval
+// (the single-rate mode, and the fallback where there are no per-metric
+// collectors)
+class PlatformCollector : public Collector {
+public:
+  PlatformCollector(PlatformMetrics& platform, unsigned interval_ms)
+    : platform_(platform), interval_ms_(interval_ms) {}
+
+  void set_interval_ms(unsigned ms) { interval_ms_ = ms; }
+
+  const char* name() const override { return platform_.get_platform_name(); }
+  unsigned interval_ms() const override { return interval_ms_; }
+  unsigned cost_us() const override { return PLATFORM_COLLECT_COST_US; }
+  bool open(StreamTable&) override { return true; }
+
+  void collect(std::int64_t, SampleSink& sink) override {
+    float vals[N_METRICS];
+    platform_.sample_system_metrics(vals);
+    for (std::uint32_t i = 0; i < N_METRICS; ++i) sink.put(i, vals[i]);
+    sink.put_counter(UPTIME_MS, platform_.uptime_ms());
+  }
+
+private:
+  PlatformMetrics& platform_;
+  unsigned interval_ms_;
+};
+
+// One collector per host metric at its own rate where the platform has
+// them (Linux); otherwise a PlatformCollector over `platform`
+std::vector<std::unique_ptr<Collector>> create_platform_collectors(PlatformMetrics& platform,
+                                                                   unsigned sample_ms);
+
+// Per-process CPU, memory and I/O streams (nullptr where unsupported)
+std::unique_ptr<Collector> create_process_collector();
+
+// Per-cgroup (v2) CPU, memory, memory pressure and I/O streams (nullptr
+// where unsupported)
+std::unique_ptr<Collector> create_cgroup_collector();
+
+// Per-disk and per-interface I/O streams for the whole host (nullptr where
+// unsupported)
+std::unique_ptr<Collector> create_device_collector();
+
+// Per-CPU utilization, iowait, steal and softirq streams (nullptr where
+// unsupported)
+std::unique_ptr<Collector> create_percpu_collector();
+
+// Pressure stall (PSI) and VM reclaim/swap/fault streams, woken early by
+// PSI triggers (nullptr where unsupported)
+std::unique_ptr<Collector> create_pressure_collector();
+
+// This process's allocator statistics, and smaps_rollup streams for each of
+// `targets` (PIDs or process names); nullptr where unsupported
+std::unique_ptr<Collector> create_memory_collector(const std::vector<std::string>& targets);
+
+// Line and pattern-match rates of tailed log files; `patterns` are (name,
+// fixed string or "re:" regex) pairs (nullptr where unsupported)
+std::unique_ptr<Collector> create_log_collector(const std::vector<std::string>& paths,
+                                                const std::vector<std::pair<std::string, std::string>>& patterns);
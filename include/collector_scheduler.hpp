@@ -0,0 +1,89 @@
+#pragma once
+#include "config.hpp"
+#include "collector.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Runs collectors at their own intervals off a hashed timing wheel:
+// SCHEDULER_WHEEL_SLOTS slots of SCHEDULER_TICK_MS each, a collector sitting
+// in the slot of its due tick (intervals longer than one revolution just stay
+// put for the extra turns). Arming and expiry are O(1) whatever the number
+// of collectors, and every collector due by the same tick runs in one round,
+// so their readings reach the detector in a single feed.
+//
+// A new collector gets the phase, within its first interval, whose slot has
+// the least declared cost so far, so expensive collectors on the same
+// interval do not all land on the same tick.
+//
+// The file reads the collectors of a round queue in prepare() go to the
+// scheduler's BatchReader as one batch before any of them collects.
+//
+// Collectors with a wake_fd() can also be run early: the caller sleeps on
+// wake_fds() as well as next_due_ms() and passes what polled ready to
+// wake(), which re-arms those collectors for the next tick (their interval
+// then counts from that run).
+class CollectorScheduler {
+public:
+  struct Stats {
+    const char* name{nullptr};
+    unsigned interval_ms{0};      // as last armed (after scaling)
+    std::uint64_t runs{0};
+    std::uint64_t late{0};        // rounds started a tick or more behind
+    std::uint64_t woken{0};       // runs brought forward by wake()
+    float mean_us{0.0f};          // measured cost, exponentially weighted
+    unsigned max_us{0};
+  };
+
+  explicit CollectorScheduler(std::int64_t now_ms, BatchReader::Engine io = BatchReader::Engine::AUTO);
+
+  // Takes ownership; false (and dropped) if the collector fails to open
+  bool add(std::unique_ptr<Collector> collector, StreamTable& streams);
+
+  // Run every collector due by now_ms into `sink`; returns how many ran
+  std::size_t run_due(std::int64_t now_ms, SampleSink& sink);
+
+  // Stretch (>1) or shrink every interval, e.g. for adaptive sampling.
+  // Collectors are re-armed from their last run at once.
+  void set_rate_scale(double scale);
+
+  // When the next collector is due (steady clock)
+  std::int64_t next_due_ms() const;
+
+  // The collectors' wake descriptors, and those of them flagged in `woken`
+  // (same order) to run at the next tick
+  const std::vector<int>& wake_fds() const { return wake_fds_; }
+  void wake(const std::vector<std::uint8_t>& woken);
+
+  std::size_t size() const { return entries_.size(); }
+  Collector& collector(std::size_t i) { return *entries_[i].collector; }
+  const Stats& stats(std::size_t i) const { return entries_[i].stats; }
+  const BatchReader& io() const { return io_; }
+
+private:
+  struct Entry {
+    std::unique_ptr<Collector> collector;
+    std::int64_t due_tick{0};
+    std::int64_t last_tick{0};
+    std::size_t slot_pos{0};      // index within its slot
+    bool armed{false};
+    bool woken{false};
+    Stats stats;
+  };
+
+  std::int64_t interval_ticks(const Entry& e) const;
+  void arm(std::uint32_t id, std::int64_t due_tick);
+  void disarm(std::uint32_t id);
+
+  BatchReader io_;                                  // outlives the collectors' slots
+  std::vector<Entry> entries_;
+  std::vector<std::vector<std::uint32_t>> slots_;   // entry ids per slot
+  std::vector<std::uint64_t> slot_cost_;            // declared cost per slot
+  std::vector<std::uint32_t> due_;                  // scratch: this round
+  std::vector<std::int64_t> prepare_us_;            // scratch: per due_ entry
+  std::vector<int> wake_fds_;
+  std::vector<std::uint32_t> wake_ids_;             // entry id per wake_fds_
+  std::int64_t tick_;                               // last tick processed
+  double scale_{1.0};
+};
@@ -7,6 +7,16 @@ constexpr std::size_t N_METRICS = 5;
 // sampling interval in milliseconds (used in main.cpp)
 constexpr unsigned SAMPLE_MS = 500;
 
+// Adaptive sampling (off unless enabled): the interval stretches to
+// ADAPTIVE_MAX_SAMPLE_MS while every |z| is below ADAPTIVE_QUIET_RATIO of its
+// hysteresis threshold and shrinks towards ADAPTIVE_MIN_SAMPLE_MS as the
+// closest stream approaches it; it lengthens by at most ADAPTIVE_RELAX per
+// sample so a brief dip does not drop straight back to sparse sampling
+constexpr unsigned ADAPTIVE_MIN_SAMPLE_MS = 50;
+constexpr unsigned ADAPTIVE_MAX_SAMPLE_MS = 2000;
+constexpr float ADAPTIVE_QUIET_RATIO = 0.5f;
+constexpr float ADAPTIVE_RELAX = 1.25f;
+
 // EWMA smoothing factor α (0 < α < 1). 
 // Smaller α → slower adaptation, larger α → faster adaptation
 // Tuned to be more stable and less sensitive to noise
@@ -38,4 +48,186 @@ constexpr float CPU_HYSTERESIS = 5.0f;
 constexpr float RAM_HYSTERESIS = 3.5f;
 constexpr float DISK_HYSTERESIS = 4.0f;
 constexpr float HEAP_HYSTERESIS = 6.0f;
-constexpr float UPTIME_HYSTERESIS = 3.0f;
\ No newline at end of file
+constexpr float UPTIME_HYSTERESIS = 3.0f;
+
+// Robust scoring: median step per sample, as a fraction of the current spread
+constexpr float ROBUST_STEP = 0.05f;
+
+// Seasonal scoring: one baseline per phase of a repeating period
+constexpr unsigned SEASONAL_PERIOD_MS = 24u * 60u * 60u * 1000u;  // daily cycle
+constexpr unsigned SEASONAL_BUCKETS = 24;                         // hourly phases
+
+// Fixed-point scoring: size of one integer step per metric
+constexpr float CPU_QUANTUM = 0.01f;       // %
+constexpr float RAM_QUANTUM = 0.01f;       // %
+constexpr float DISK_QUANTUM = 16384.0f;   // bytes/sec
+constexpr float HEAP_QUANTUM = 4096.0f;    // bytes
+constexpr float MEMORY_QUANTUM = 65536.0f; // bytes: process, cgroup memory (to 256 GiB)
+constexpr float COUNT_RATE_QUANTUM = 1.0f; // events/sec of busy counters (faults, packets, lines)
+constexpr float DEFAULT_QUANTUM = 0.01f;   // any other stream (%, ms, rare events)
+
+// Change-point scoring (cusum, page-hinkley), all in standard deviations:
+// the drift per sample ignored as noise (k, or delta), the smaller one used
+// to time the change's onset, the statistic above
+// which the reference stops adapting (cusum), and the one past which the
+// change is taken as the new normal and both start over. The CUSUM
+// reference adapts CHANGE_REFERENCE_RATIO times as fast as the EWMA, the
+// Page-Hinkley reference is the mean of up to PH_MAX_SAMPLES samples since
+// the last change, and nothing accumulates in a stream's first
+// CHANGE_WARMUP_SAMPLES samples while its spread is still being learned.
+constexpr float CHANGE_SLACK_SIGMA = 1.0f;
+constexpr float CHANGE_ONSET_SLACK_SIGMA = 0.25f;
+constexpr float CHANGE_HOLD_SIGMA = 1.0f;
+constexpr float CHANGE_RESTART_SIGMA = 25.0f;
+constexpr float CHANGE_REFERENCE_RATIO = 0.1f;
+constexpr float PH_MAX_SAMPLES = 1e6f;
+constexpr unsigned CHANGE_WARMUP_SAMPLES = 200;
+
+// Compact detector state: resolution of the 32-bit last-alert timestamps
+constexpr unsigned COMPACT_TICK_MS = 10;
+
+// Anomaly journal: records per segment file, records per sparse index entry,
+// segments kept before the oldest is deleted (~1.5 MB each), and the
+// largest backward clock step recorded at the segment's latest time rather
+// than starting a new segment
+constexpr unsigned JOURNAL_SEGMENT_RECORDS = 65536;
+constexpr unsigned JOURNAL_INDEX_STRIDE = 256;
+constexpr unsigned JOURNAL_MAX_SEGMENTS = 32;
+constexpr unsigned JOURNAL_CLOCK_STEP_MS = 60000;
+constexpr const char* JOURNAL_DIR = "anomaly_journal";
+
+// Sample history: compressed block size and blocks kept per stream (at a few
+// bytes per point, 1024 x 4 KB holds ~3 h of 100 Hz samples), and per
+// collector stream, of which there may be thousands (4 x 4 KB still holds
+// the leading-indicator window at 10 Hz)
+constexpr unsigned HISTORY_BLOCK_BYTES = 4096;
+constexpr unsigned HISTORY_MAX_BLOCKS = 1024;
+constexpr unsigned HISTORY_COLLECTOR_BLOCKS = 4;
+
+// Rollup rings: bucket width and buckets kept per resolution
+// (1 s for an hour, 1 min for a day, 1 h for 30 days)
+constexpr std::size_t ROLLUP_LEVELS = 3;
+constexpr long long ROLLUP_RESOLUTION_MS[ROLLUP_LEVELS] = { 1000, 60000, 3600000 };
+constexpr std::size_t ROLLUP_BUCKETS[ROLLUP_LEVELS] = { 3600, 1440, 720 };
+
+// Sample archive: rows per columnar block, and the longest a partly filled
+// block is held in memory before it is written anyway
+constexpr unsigned ARCHIVE_BLOCK_ROWS = 8192;
+constexpr unsigned ARCHIVE_FLUSH_MS = 300000;
+
+// Anomaly statistics: records of one metric closer together than this are
+// one episode (older journals record an active alert on every sample), and the width
+// and number of buckets behind the anomaly-rate windows (one hour)
+constexpr unsigned ANOMALY_EPISODE_GAP_MS = 5000;
+constexpr unsigned STATS_RATE_BUCKET_MS = 60000;
+constexpr std::size_t STATS_RATE_BUCKETS = 60;
+
+// Incidents: an anomaly this close to the open incident's latest one joins
+// it (a quiet gap this long closes it, and a member quiet this long is
+// reported again when it fires), the longest one runs before it is closed
+// and the next anomaly opens another, and how many closed ones are kept
+// for the display
+constexpr unsigned INCIDENT_GAP_MS = 10000;
+constexpr unsigned INCIDENT_MAX_MS = 600000;
+constexpr std::size_t INCIDENT_HISTORY = 16;
+
+// Leading indicators on an alert: the window of history compared, its bin
+// width, the longest lead looked for, the weakest correlation reported
+// (pure noise reaches about 0.4 at some lead among 500 streams), how many
+// streams are reported, how many reported anomalies of one round get them,
+// and how many streams one of them decodes (~14 ms at 500 streams)
+constexpr unsigned LEAD_WINDOW_MS = 120000;
+constexpr unsigned LEAD_BIN_MS = 500;
+constexpr unsigned LEAD_MAX_LAG_MS = 30000;
+constexpr float LEAD_MIN_R = 0.45f;
+constexpr std::size_t LEAD_TOP = 3;
+constexpr unsigned LEAD_MAX_PER_ROUND = 2;
+constexpr std::size_t LEAD_MAX_CANDIDATES = 256;
+
+// Collector scheduler: timing-wheel tick and slots (one revolution is 2.56 s;
+// longer intervals wait out extra turns in their slot)
+constexpr unsigned SCHEDULER_TICK_MS = 10;
+constexpr std::size_t SCHEDULER_WHEEL_SLOTS = 256;
+
+// Multi-rate collectors (--multi-rate): interval and typical cost of one
+// collection per host metric. Cheap counters are read often; the
+// allocator's statistics (which walk its free lists) are left to every 10 s.
+constexpr unsigned CPU_COLLECT_MS = 10;
+constexpr unsigned RAM_COLLECT_MS = 1000;
+constexpr unsigned DISK_COLLECT_MS = 1000;
+constexpr unsigned HEAP_COLLECT_MS = 10000;
+constexpr unsigned UPTIME_COLLECT_MS = 1000;
+constexpr unsigned CPU_COLLECT_COST_US = 15;
+constexpr unsigned RAM_COLLECT_COST_US = 2;
+constexpr unsigned DISK_COLLECT_COST_US = 20;
+constexpr unsigned HEAP_COLLECT_COST_US = 40;
+constexpr unsigned UPTIME_COLLECT_COST_US = 1;
+constexpr unsigned PLATFORM_COLLECT_COST_US = 100;   // all metrics at once
+
+// Multi-rate display refresh (collection may run far faster)
+constexpr unsigned DISPLAY_REFRESH_MS = 250;
+
+// Real-time sampler (--realtime): SCHED_FIFO priority (modest, below kernel
+// threads such as watchdogs at 99) and how much stack to prefault
+constexpr int REALTIME_PRIORITY = 10;
+constexpr std::size_t REALTIME_STACK_PREFAULT = 256 * 1024;
+
+// Per-process collector (--processes): scan interval, typical cost of a
+// scan (a few thousand processes), and the fds it may hold open between
+// scans, leaving PROCESS_RESERVED_FDS of RLIMIT_NOFILE for everything else
+constexpr unsigned PROCESS_COLLECT_MS = 1000;
+constexpr unsigned PROCESS_COLLECT_COST_US = 20000;
+constexpr std::size_t PROCESS_MAX_HELD_FDS = 65536;
+constexpr std::size_t PROCESS_RESERVED_FDS = 256;
+
+// cgroup v2 collector (--cgroups): collection interval, typical cost (about
+// a thousand cgroups), how often the hierarchy is walked for new cgroups
+// regardless of the descendant count, and the fds it may hold open
+constexpr unsigned CGROUP_COLLECT_MS = 1000;
+constexpr unsigned CGROUP_COLLECT_COST_US = 10000;
+constexpr unsigned CGROUP_RESCAN_MS = 10000;
+constexpr std::size_t CGROUP_MAX_HELD_FDS = 16384;
+
+// Batched reads of held proc/sysfs files (batch_reader.hpp): io_uring
+// submission queue size, buffer arena block size, fixed-file table size
+// (at most RLIMIT_NOFILE), and batches timed per engine before AUTO picks
+constexpr unsigned BATCH_READ_RING_ENTRIES = 4096;
+constexpr unsigned BATCH_READ_BLOCK_BYTES = 256 * 1024;
+constexpr std::size_t BATCH_READ_MAX_FILES = 65536;
+constexpr unsigned BATCH_READ_CALIBRATE = 4;
+
+// Disk and network device collector (--devices): collection interval and
+// typical cost (a few hundred devices)
+constexpr unsigned DEVICE_COLLECT_MS = 1000;
+constexpr unsigned DEVICE_COLLECT_COST_US = 300;
+
+// Per-CPU collector (--cpus): collection interval and typical cost (a few
+// hundred CPUs, mostly the kernel generating /proc/stat)
+constexpr unsigned PERCPU_COLLECT_MS = 1000;
+constexpr unsigned PERCPU_COLLECT_COST_US = 200;
+
+// Pressure collector (--pressure): polling interval and typical cost, and
+// the PSI trigger that runs it early, a "some" stall of
+// PSI_TRIGGER_STALL_PCT % of a PSI_TRIGGER_WINDOW_US window (unprivileged
+// processes may only use multiples of 2 s, which is tried next)
+constexpr unsigned PRESSURE_COLLECT_MS = 2000;
+constexpr unsigned PRESSURE_COLLECT_COST_US = 60;
+constexpr unsigned PSI_TRIGGER_WINDOW_US = 1000000;
+constexpr unsigned PSI_TRIGGER_STALL_PCT = 10;
+
+// Memory accounting collector (--memory): collection interval, typical cost
+// (allocator statistics and a few targets' smaps_rollup; a process with
+// many mappings costs more), and how often named targets are looked for
+constexpr unsigned MEMORY_COLLECT_MS = 5000;
+constexpr unsigned MEMORY_COLLECT_COST_US = 300;
+constexpr unsigned MEMORY_RESCAN_MS = 10000;
+
+// Log collector (--log): collection interval, typical cost (about 1 GB/min
+// of appended text against a few fixed strings), read block size, the
+// longest partial line kept for its newline, and the most read from one
+// file per collection (a faster writer is caught up over several)
+constexpr unsigned LOG_COLLECT_MS = 1000;
+constexpr unsigned LOG_COLLECT_COST_US = 10000;
+constexpr std::size_t LOG_READ_BLOCK_BYTES = 1024 * 1024;
+constexpr std::size_t LOG_MAX_LINE_BYTES = 64 * 1024;
+constexpr std::size_t LOG_MAX_READ_BYTES = 256 * 1024 * 1024;
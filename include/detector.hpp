@@ -1,128 +1,241 @@
 #pragma once
 #include "config.hpp"
-#include "stats.hpp"
-#include <array>
+#include "runtime_config.hpp"
+#include "scoring.hpp"
+#include "alerting.hpp"
 #include <cstddef>
-#include <cmath>
+#include <cstdint>
 #include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
 
-// Online anomaly detector over N_METRICS streams with hysteresis.
-class AnomalyDetector {
-  std::array<EWMA, N_METRICS> stats_;
-  
-  // Hysteresis state tracking
-  std::array<bool, N_METRICS> anomaly_active_;      // Current anomaly state per metric
-  std::array<unsigned, N_METRICS> normal_samples_;  // Consecutive normal samples
-  std::array<std::chrono::steady_clock::time_point, N_METRICS> last_alert_time_;
-  
-  // Per-metric thresholds
-  std::array<float, N_METRICS> thresholds_;
-  std::array<float, N_METRICS> hysteresis_thresholds_;
-  
-  // Get threshold for a specific metric
-  float get_threshold(std::size_t metric_idx) const {
-    switch (metric_idx) {
-      case 0: return CPU_THRESHOLD;      // CPU_UTIL
-      case 1: return RAM_THRESHOLD;      // RAM_USED
-      case 2: return DISK_THRESHOLD;     // DISK_IO_RATE
-      case 3: return HEAP_THRESHOLD;     // HEAP_FREE
-      case 4: return UPTIME_THRESHOLD;   // UPTIME_MS
-      default: return Z_THRESHOLD;
-    }
+// Milliseconds on the steady clock; the detector's notion of "now"
+inline std::int64_t steady_now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Online anomaly detector over a set of streams, composed at compile time
+// from a scoring policy (see scoring.hpp) and an alerting policy (see
+// alerting.hpp). Each feed is two inlined batch loops; there is no virtual
+// dispatch per sample.
+template <class Scoring, class Alerting>
+class BasicAnomalyDetector {
+  std::size_t n_;
+  Scoring scoring_;
+  Alerting alerting_;
+  std::vector<std::uint8_t> all_fresh_;
+  const ConfigStore* config_{nullptr};
+  std::uint64_t config_generation_{0};
+
+  // Pick up a newly published snapshot; a single acquire load if unchanged.
+  // The caller's thread must be a registered ConfigStore reader.
+  void refresh_config() {
+    const RuntimeConfig* cfg = config_->current();
+    if (cfg->generation == config_generation_) return;
+    scoring_.apply(*cfg);
+    alerting_.apply(*cfg);
+    config_generation_ = cfg->generation;
   }
-  
-  // Get hysteresis threshold for a specific metric
-  float get_hysteresis_threshold(std::size_t metric_idx) const {
-    switch (metric_idx) {
-      case 0: return CPU_HYSTERESIS;
-      case 1: return RAM_HYSTERESIS;
-      case 2: return DISK_HYSTERESIS;
-      case 3: return HEAP_HYSTERESIS;
-      case 4: return UPTIME_HYSTERESIS;
-      default: return HYSTERESIS_THRESHOLD;
-    }
+
+public:
+  explicit BasicAnomalyDetector(std::size_t n = N_METRICS)
+    : n_(n), scoring_(n), alerting_(n, steady_now_ms()), all_fresh_(n, 1) {}
+
+  std::size_t size() const { return n_; }
+
+  // Feed raw metrics; outputs per-metric z-scores.
+  // Returns true if any anomaly is active (considering the alerting policy).
+  bool feed(const float* vals, float* zscores) {
+    return feed(vals, zscores, steady_now_ms());
   }
-  
-  // Initialize hysteresis state
-  void init_hysteresis() {
-    for (std::size_t i = 0; i < N_METRICS; ++i) {
-      anomaly_active_[i] = false;
-      normal_samples_[i] = 0;
-      last_alert_time_[i] = std::chrono::steady_clock::now();
-      thresholds_[i] = get_threshold(i);
-      hysteresis_thresholds_[i] = get_hysteresis_threshold(i);
-    }
+
+  // Same, with an explicit timestamp (replay/backtesting)
+  bool feed(const float* vals, float* zscores, std::int64_t now_ms) {
+    return feed(vals, zscores, now_ms, all_fresh_.data());
   }
 
-public:
-  AnomalyDetector() {
-    init_hysteresis();
+  // Feed only the streams with fresh[i] set (sampled this round); the rest
+  // keep their baseline, z-score and alert state. Returns true if any
+  // stream, fresh or not, is active.
+  bool feed(const float* vals, float* zscores, std::int64_t now_ms, const std::uint8_t* fresh) {
+    if (config_) refresh_config();
+    scoring_.score(vals, zscores, n_, now_ms, fresh);
+    return alerting_.update(zscores, n_, now_ms, fresh);
   }
 
-  // Feed raw metrics; outputs per-metric z-scores.
-  // Returns true if any anomaly is active (considering hysteresis).
-  bool feed(const float vals[N_METRICS],
-            float zscores[N_METRICS]) {
-    bool any_anom = false;
-    auto now = std::chrono::steady_clock::now();
-    
-    for (std::size_t i = 0; i < N_METRICS; ++i) {
-      stats_[i].update(vals[i]);
-      float z = stats_[i].z_score(vals[i]);
-      zscores[i] = z;
-      
-      float threshold = thresholds_[i];
-      float hysteresis_threshold = hysteresis_thresholds_[i];
-      
-      // Check if we should trigger a new alert
-      bool should_alert = false;
-      if (!anomaly_active_[i]) {
-        // Not currently in anomaly state - check if we should trigger
-        if (std::fabs(z) > threshold) {
-          auto time_since_last = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - last_alert_time_[i]).count();
-          
-          if (time_since_last >= MIN_QUIET_TIME_MS) {
-            should_alert = true;
-            anomaly_active_[i] = true;
-            normal_samples_[i] = 0;
-            last_alert_time_[i] = now;
-          }
-        }
-      } else {
-        // Currently in anomaly state - check if we should clear
-        if (std::fabs(z) < hysteresis_threshold) {
-          normal_samples_[i]++;
-          if (normal_samples_[i] >= HYSTERESIS_SAMPLES) {
-            anomaly_active_[i] = false;
-            normal_samples_[i] = 0;
-          }
-        } else {
-          // Still anomalous, reset normal sample counter
-          normal_samples_[i] = 0;
-        }
-      }
-      
-      if (anomaly_active_[i]) {
-        any_anom = true;
-      }
-    }
-    
-    return any_anom;
+  // Exact 64-bit reading for a counter stream, consumed by the next feed
+  // (used by FixedPointScoring; other scoring policies ignore it)
+  void stage_counter(std::size_t metric_idx, std::uint64_t reading) {
+    if (metric_idx < n_) scoring_.stage_counter(metric_idx, reading);
   }
-  
+
+  // Integer step of a stream, e.g. its StreamTable::quantum (used by
+  // FixedPointScoring; other scoring policies ignore it)
+  void set_quantum(std::size_t metric_idx, float quantum) {
+    if (metric_idx < n_) scoring_.set_quantum(metric_idx, quantum);
+  }
+
+  // Follow the tunables published in `store` (nullptr: keep current ones)
+  void attach_config(const ConfigStore* store) {
+    config_ = store;
+    config_generation_ = 0;
+    if (config_) refresh_config();
+  }
+
   // Get current anomaly state for a specific metric
   bool is_anomaly_active(std::size_t metric_idx) const {
-    return (metric_idx < N_METRICS) ? anomaly_active_[metric_idx] : false;
+    return (metric_idx < n_) ? alerting_.active(metric_idx) : false;
   }
-  
+
   // Get threshold for a specific metric (for display purposes)
   float get_metric_threshold(std::size_t metric_idx) const {
-    return (metric_idx < N_METRICS) ? thresholds_[metric_idx] : Z_THRESHOLD;
+    return (metric_idx < n_) ? alerting_.threshold(metric_idx) : Z_THRESHOLD;
+  }
+
+  // When the change a change-point policy is scoring began (steady ms);
+  // NO_CHANGE_ONSET otherwise
+  std::int64_t change_onset_ms(std::size_t metric_idx) const {
+    return (metric_idx < n_) ? scoring_.onset_ms(metric_idx) : NO_CHANGE_ONSET;
   }
-  
+
+  void set_thresholds(std::size_t metric_idx, float threshold, float hysteresis) {
+    if (metric_idx < n_) alerting_.set_thresholds(metric_idx, threshold, hysteresis);
+  }
+
+  // Grow or shrink the stream set; new streams start with a fresh baseline
+  void resize(std::size_t n) {
+    scoring_.resize(n);
+    alerting_.resize(n, steady_now_ms());
+    all_fresh_.resize(n, 1);
+    n_ = n;
+  }
+
+  // Forget everything learned for one stream (e.g. its slot is being reused)
+  void reset_stream(std::size_t metric_idx) {
+    if (metric_idx >= n_) return;
+    scoring_.reset(metric_idx);
+    alerting_.reset(metric_idx, steady_now_ms());
+  }
+
   // Reset hysteresis state (useful for testing or system reset)
   void reset_hysteresis() {
-    init_hysteresis();
+    std::int64_t now = steady_now_ms();
+    for (std::size_t i = 0; i < n_; ++i) alerting_.reset(i, now);
   }
-};
\ No newline at end of file
+};
+
+// The original detector: EWMA baseline with hysteresis and quiet time
+using AnomalyDetector = BasicAnomalyDetector<EWMAScoring, HysteresisAlerting>;
+
+enum class ScoringPolicy { EWMA, ROBUST, SEASONAL, FIXED, COMPACT, CUSUM, PAGE_HINKLEY };
+enum class AlertingPolicy { HYSTERESIS, QUIET_TIME, NONE, COMPACT };
+
+// Parse policy names as used on the command line ("ewma", "robust",
+// "seasonal", "fixed", "compact", "cusum", "page-hinkley"; "hysteresis",
+// "quiet", "none", "compact"). Return false if unknown.
+bool parse_scoring_policy(const std::string& name, ScoringPolicy& out);
+bool parse_alerting_policy(const std::string& name, AlertingPolicy& out);
+
+// Type-erased detector for choosing policies at runtime. The virtual call
+// happens once per feed (a whole batch of streams), never per sample.
+class AnyDetector {
+  struct Concept {
+    virtual ~Concept() = default;
+    virtual std::size_t size() const = 0;
+    virtual bool feed(const float* vals, float* zscores, std::int64_t now_ms) = 0;
+    virtual bool feed(const float* vals, float* zscores, std::int64_t now_ms,
+                      const std::uint8_t* fresh) = 0;
+    virtual bool is_anomaly_active(std::size_t metric_idx) const = 0;
+    virtual float get_metric_threshold(std::size_t metric_idx) const = 0;
+    virtual std::int64_t change_onset_ms(std::size_t metric_idx) const = 0;
+    virtual void set_thresholds(std::size_t metric_idx, float threshold, float hysteresis) = 0;
+    virtual void attach_config(const ConfigStore* store) = 0;
+    virtual void stage_counter(std::size_t metric_idx, std::uint64_t reading) = 0;
+    virtual void set_quantum(std::size_t metric_idx, float quantum) = 0;
+    virtual void resize(std::size_t n) = 0;
+    virtual void reset_stream(std::size_t metric_idx) = 0;
+    virtual void reset_hysteresis() = 0;
+  };
+
+  template <class Detector>
+  struct Model final : Concept {
+    Detector det;
+    explicit Model(std::size_t n) : det(n) {}
+    std::size_t size() const override { return det.size(); }
+    bool feed(const float* vals, float* zscores, std::int64_t now_ms) override {
+      return det.feed(vals, zscores, now_ms);
+    }
+    bool feed(const float* vals, float* zscores, std::int64_t now_ms,
+              const std::uint8_t* fresh) override {
+      return det.feed(vals, zscores, now_ms, fresh);
+    }
+    bool is_anomaly_active(std::size_t metric_idx) const override {
+      return det.is_anomaly_active(metric_idx);
+    }
+    float get_metric_threshold(std::size_t metric_idx) const override {
+      return det.get_metric_threshold(metric_idx);
+    }
+    std::int64_t change_onset_ms(std::size_t metric_idx) const override {
+      return det.change_onset_ms(metric_idx);
+    }
+    void set_thresholds(std::size_t metric_idx, float threshold, float hysteresis) override {
+      det.set_thresholds(metric_idx, threshold, hysteresis);
+    }
+    void attach_config(const ConfigStore* store) override { det.attach_config(store); }
+    void stage_counter(std::size_t metric_idx, std::uint64_t reading) override {
+      det.stage_counter(metric_idx, reading);
+    }
+    void set_quantum(std::size_t metric_idx, float quantum) override { det.set_quantum(metric_idx, quantum); }
+    void resize(std::size_t n) override { det.resize(n); }
+    void reset_stream(std::size_t metric_idx) override { det.reset_stream(metric_idx); }
+    void reset_hysteresis() override { det.reset_hysteresis(); }
+  };
+
+  std::unique_ptr<Concept> impl_;
+
+  explicit AnyDetector(std::unique_ptr<Concept> impl) : impl_(std::move(impl)) {}
+
+public:
+  template <class Scoring, class Alerting>
+  static AnyDetector make(std::size_t n = N_METRICS) {
+    return AnyDetector(std::unique_ptr<Concept>(
+      new Model<BasicAnomalyDetector<Scoring, Alerting>>(n)));
+  }
+
+  std::size_t size() const { return impl_->size(); }
+  bool feed(const float* vals, float* zscores) {
+    return impl_->feed(vals, zscores, steady_now_ms());
+  }
+  bool feed(const float* vals, float* zscores, std::int64_t now_ms) {
+    return impl_->feed(vals, zscores, now_ms);
+  }
+  bool feed(const float* vals, float* zscores, std::int64_t now_ms, const std::uint8_t* fresh) {
+    return impl_->feed(vals, zscores, now_ms, fresh);
+  }
+  bool is_anomaly_active(std::size_t metric_idx) const {
+    return impl_->is_anomaly_active(metric_idx);
+  }
+  float get_metric_threshold(std::size_t metric_idx) const {
+    return impl_->get_metric_threshold(metric_idx);
+  }
+  std::int64_t change_onset_ms(std::size_t metric_idx) const {
+    return impl_->change_onset_ms(metric_idx);
+  }
+  void set_thresholds(std::size_t metric_idx, float threshold, float hysteresis) {
+    impl_->set_thresholds(metric_idx, threshold, hysteresis);
+  }
+  void attach_config(const ConfigStore* store) { impl_->attach_config(store); }
+  void stage_counter(std::size_t metric_idx, std::uint64_t reading) {
+    impl_->stage_counter(metric_idx, reading);
+  }
+  void set_quantum(std::size_t metric_idx, float quantum) { impl_->set_quantum(metric_idx, quantum); }
+  void resize(std::size_t n) { impl_->resize(n); }
+  void reset_stream(std::size_t metric_idx) { impl_->reset_stream(metric_idx); }
+  void reset_hysteresis() { impl_->reset_hysteresis(); }
+};
+
+// Factory: instantiate the policy combination chosen at configuration time
+AnyDetector make_detector(ScoringPolicy scoring, AlertingPolicy alerting,
+                          std::size_t n = N_METRICS);
@@ -0,0 +1,206 @@
+#pragma once
+#include "proc_text.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+
+// /proc/diskstats and /proc/net/dev, parsed in place. Both list one device
+// per line, in an order that only changes when devices come or go.
+
+// Counters of a /proc/diskstats line after "major minor name" (newer
+// kernels append discard and flush counters, which we do not use)
+enum DiskField {
+  DS_READS, DS_READS_MERGED, DS_SECTORS_READ, DS_MS_READING,
+  DS_WRITES, DS_WRITES_MERGED, DS_SECTORS_WRITTEN, DS_MS_WRITING,
+  DS_IN_FLIGHT, DS_MS_IO, DS_MS_WEIGHTED, DS_FIELDS
+};
+
+// Counters of a /proc/net/dev line after "name:", receive then transmit
+enum NetField {
+  ND_RX_BYTES, ND_RX_PACKETS, ND_RX_ERRS, ND_RX_DROP, ND_RX_FIFO, ND_RX_FRAME,
+  ND_RX_COMPRESSED, ND_RX_MULTICAST,
+  ND_TX_BYTES, ND_TX_PACKETS, ND_TX_ERRS, ND_TX_DROP, ND_TX_FIFO, ND_TX_COLLS,
+  ND_TX_CARRIER, ND_TX_COMPRESSED, ND_FIELDS
+};
+
+// diskstats counts 512-byte sectors whatever the device's sector size
+constexpr std::uint64_t DISK_SECTOR_BYTES = 512;
+
+// One device's line: its name (into the buffer, not terminated) and counters
+struct DeviceLine {
+  const char* name;
+  std::size_t name_len;
+  std::uint64_t field[ND_FIELDS];
+};
+
+inline const char* skip_line(const char* p) {
+  while (*p != '\0' && *p != '\n') ++p;
+  return *p == '\n' ? p + 1 : p;
+}
+
+// Next line of /proc/diskstats from `p`; false at the end
+inline bool next_diskstats(const char*& p, DeviceLine& d) {
+  while (*p != '\0') {
+    const char* line = p;
+    p = skip_line(p);
+    next_field(line);                        // major
+    next_field(line);                        // minor
+    while (*line == ' ' || *line == '\t') ++line;
+    d.name = line;
+    while (*line > ' ') ++line;
+    d.name_len = std::size_t(line - d.name);
+    if (d.name_len == 0) continue;
+    for (int k = 0; k < DS_FIELDS; ++k) d.field[k] = next_field(line);
+    return true;
+  }
+  return false;
+}
+
+// Next interface of /proc/net/dev from `p` (the two header lines have no
+// ':' and are skipped); false at the end
+inline bool next_netdev(const char*& p, DeviceLine& d) {
+  while (*p != '\0') {
+    const char* line = p;
+    p = skip_line(p);
+    while (*line == ' ') ++line;
+    const char* colon = line;
+    while (colon < p && *colon != ':') ++colon;
+    if (colon >= p || colon == line) continue;
+    d.name = line;
+    d.name_len = std::size_t(colon - line);
+    line = colon + 1;
+    for (int k = 0; k < ND_FIELDS; ++k) d.field[k] = next_field(line);
+    return true;
+  }
+  return false;
+}
+
+// Whole file from offset 0 into `buf`, NUL-terminated, growing it (the only
+// allocation) when the file no longer fits; bytes read or -1
+inline ssize_t read_whole(int fd, std::vector<char>& buf) {
+  if (buf.size() < 4096) buf.resize(4096);
+  for (;;) {
+    ssize_t n = pread(fd, buf.data(), buf.size() - 1, 0);
+    if (n < 0) return -1;
+    if (std::size_t(n) < buf.size() - 1) {
+      buf[std::size_t(n)] = '\0';
+      return n;
+    }
+    buf.resize(buf.size() * 2);
+  }
+}
+
+// What a diskstats device is, from sysfs: partitions have no /sys/block
+// entry of their own, and only hardware-backed disks (not loop, dm, md,
+// zram, ...) have a device link there
+enum class DiskKind { PARTITION, VIRTUAL, PHYSICAL };
+
+inline DiskKind disk_kind(const char* name, std::size_t len) {
+  char path[128];
+  int n = std::snprintf(path, sizeof(path), "/sys/block/%.*s", int(len), name);
+  if (n <= 0 || std::size_t(n) >= sizeof(path) - 8) return DiskKind::VIRTUAL;
+  for (char* c = path + 11; *c != '\0'; ++c) {
+    if (*c == '/') *c = '!';               // "cciss/c0d0" is "cciss!c0d0" in sysfs
+  }
+  if (access(path, F_OK) != 0) return DiskKind::PARTITION;
+  std::strcat(path, "/device");
+  return access(path, F_OK) == 0 ? DiskKind::PHYSICAL : DiskKind::VIRTUAL;
+}
+
+// Per-device state kept in the order the file lists the devices. While the
+// set of devices is unchanged, line k matches entry k by comparing names,
+// so a read costs no lookup and no allocation; when it changes, entries
+// are moved or added to follow the file. T needs a std::string `name`.
+template <typename T>
+class DeviceList {
+public:
+  // Before the first line of a read
+  void begin() { matched_ = 0; }
+
+  // The entry for the next line's device; `added` if it is new
+  T& match(const char* name, std::size_t len, bool& added) {
+    added = false;
+    std::size_t k = matched_++;
+    if (k < items_.size() && is(items_[k], name, len)) return items_[k];
+    for (std::size_t j = k + 1; j < items_.size(); ++j) {
+      if (is(items_[j], name, len)) {
+        std::swap(items_[k], items_[j]);
+        return items_[k];
+      }
+    }
+    added = true;
+    T fresh;
+    fresh.name.assign(name, len);
+    items_.insert(items_.begin() + std::ptrdiff_t(k), std::move(fresh));
+    return items_[k];
+  }
+
+  // After the last line: the devices no longer listed go, `gone` is called
+  // on each first
+  template <typename F>
+  void end(F gone) {
+    for (std::size_t k = matched_; k < items_.size(); ++k) gone(items_[k]);
+    items_.resize(matched_);
+  }
+
+  std::size_t size() const { return items_.size(); }
+
+private:
+  static bool is(const T& t, const char* name, std::size_t len) {
+    return t.name.size() == len && std::memcmp(t.name.data(), name, len) == 0;
+  }
+
+  std::vector<T> items_;
+  std::size_t matched_{0};
+};
+
+// Bytes read and written since boot on the host's physical disks, which is
+// what DISK_IO_RATE measures. Partitions would count their disk's I/O
+// twice, and loop, dm and md devices that of the disks below them.
+class HostDiskBytes {
+public:
+  HostDiskBytes() = default;
+  HostDiskBytes(const HostDiskBytes&) = delete;
+  HostDiskBytes& operator=(const HostDiskBytes&) = delete;
+  ~HostDiskBytes() { if (fd_ >= 0) close(fd_); }
+
+  bool open() {
+    if (fd_ < 0) fd_ = ::open("/proc/diskstats", O_RDONLY | O_CLOEXEC);
+    return fd_ >= 0;
+  }
+
+  bool read(std::uint64_t& bytes) {
+    if (fd_ < 0 || read_whole(fd_, buf_) < 0) return false;
+    std::uint64_t sectors = 0;
+    const char* p = buf_.data();
+    DeviceLine line;
+    bool added;
+    disks_.begin();
+    while (next_diskstats(p, line)) {
+      Disk& d = disks_.match(line.name, line.name_len, added);
+      if (added) d.physical = disk_kind(line.name, line.name_len) == DiskKind::PHYSICAL;
+      if (d.physical) sectors += line.field[DS_SECTORS_READ] + line.field[DS_SECTORS_WRITTEN];
+    }
+    disks_.end([](Disk&) {});
+    bytes = sectors * DISK_SECTOR_BYTES;
+    return true;
+  }
+
+private:
+  struct Disk {
+    std::string name;
+    bool physical{false};
+  };
+
+  int fd_{-1};
+  std::vector<char> buf_;
+  DeviceList<Disk> disks_;
+};
+#endif
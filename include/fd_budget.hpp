@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <dirent.h>
+
+// Descriptors a collector may hold open between collections: RLIMIT_NOFILE
+// (raised to its hard limit first) less those already open and `reserve`
+// left for everything else, at most `cap`. Collectors that hold fds are
+// opened one after another, so each sees what the previous ones took.
+inline std::size_t fd_budget(std::size_t cap, std::size_t reserve) {
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return 0;
+  if (rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    getrlimit(RLIMIT_NOFILE, &rl);
+  }
+  std::size_t limit = rl.rlim_cur == RLIM_INFINITY ? cap + reserve : std::size_t(rl.rlim_cur);
+
+  std::size_t open_now = 0;
+  if (DIR* d = opendir("/proc/self/fd")) {
+    while (struct dirent* de = readdir(d)) open_now += de->d_name[0] != '.';
+    closedir(d);
+  }
+  std::size_t used = open_now + reserve;
+  std::size_t budget = limit > used ? limit - used : 0;
+  return budget < cap ? budget : cap;
+}
+#endif
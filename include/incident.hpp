@@ -0,0 +1,150 @@
+#pragma once
+#include "config.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// One stream's part in an incident
+struct IncidentMember {
+  std::uint32_t stream;
+  std::int64_t first_ms;       // steady clock, when it joined
+  std::int64_t last_ms;        // its latest anomalous sample
+  float first_value;
+  float first_z;
+  float peak_value;            // value at peak_z
+  float peak_z;                // largest |z| seen, with its sign
+  std::uint32_t samples;       // anomalous samples folded in
+  std::uint32_t fired;         // times reported: on joining, then after each quiet gap
+};
+
+// Anomalies close together in time, across streams
+struct Incident {
+  std::uint32_t id{0};         // from 1; 0 is no incident
+  std::int64_t start_ms{0};    // steady clock
+  std::int64_t last_ms{0};     // latest anomalous sample of any member
+  std::int64_t start_unix_ms{0};
+  bool split{false};           // closed at INCIDENT_MAX_MS while still firing
+  std::vector<IncidentMember> members;   // in the order they joined
+
+  // Member with the largest |z|; members is never empty
+  const IncidentMember& peak() const {
+    std::size_t best = 0;
+    for (std::size_t k = 1; k < members.size(); ++k) {
+      if (std::fabs(members[k].peak_z) > std::fabs(members[best].peak_z)) best = k;
+    }
+    return members[best];
+  }
+};
+
+// Folds the anomalous samples of all streams into incidents. When a host
+// degrades several streams go anomalous together and stay so for many
+// samples; rather than an alert per stream per sample, the caller reports
+// an incident once when it opens, each stream once when it joins, and a
+// summary with every member's peak when it closes.
+//
+// An anomaly within INCIDENT_GAP_MS of the open incident's latest one joins
+// it, so the incident lasts as long as any member keeps firing; after a
+// quiet INCIDENT_GAP_MS it is closed. A stream already in the incident only
+// moves its peak while it keeps firing; one that was quiet for
+// INCIDENT_GAP_MS and fires again is reported again, as a join. So that a
+// flapping stream cannot hold one incident open for hours and fold every
+// unrelated anomaly into it, an incident is closed after INCIDENT_MAX_MS
+// and the next anomaly opens a new one. O(1) per anomaly: each stream has a
+// slot pointing at its member. The last INCIDENT_HISTORY closed incidents
+// are kept.
+class IncidentCorrelator {
+public:
+  enum Change { REPEAT, OPENED, JOINED };
+
+  // Fold in an anomalous sample; says whether it opened an incident, added
+  // a stream to the open one (or one there that fired again after a quiet
+  // gap), or repeated a stream still firing in it
+  Change observe(std::int64_t now_ms, std::int64_t unix_ms, std::uint32_t stream, float value, float z) {
+    expire(now_ms);
+    if (stream >= slot_.size()) slot_.resize(std::size_t(stream) + 1, 0);
+    Change change = REPEAT;
+    if (open_.id == 0) {
+      open_.id = ++last_id_;
+      ++opened_;
+      open_.start_ms = now_ms;
+      open_.start_unix_ms = unix_ms;
+      change = OPENED;
+    }
+    open_.last_ms = now_ms;
+    if (slot_[stream] == 0) {
+      open_.members.push_back(IncidentMember{ stream, now_ms, now_ms, value, z, value, z, 1, 1 });
+      slot_[stream] = std::uint32_t(open_.members.size());
+      return change == OPENED ? OPENED : JOINED;
+    }
+    IncidentMember& m = open_.members[slot_[stream] - 1];
+    const bool again = now_ms - m.last_ms > std::int64_t(INCIDENT_GAP_MS);
+    m.last_ms = now_ms;
+    ++m.samples;
+    if (std::fabs(z) > std::fabs(m.peak_z)) {
+      m.peak_z = z;
+      m.peak_value = value;
+    }
+    if (again) {
+      ++m.fired;
+      return JOINED;
+    }
+    ++repeats_;
+    return REPEAT;
+  }
+
+  // Close the open incident if it has been quiet for INCIDENT_GAP_MS or
+  // has run for INCIDENT_MAX_MS; true if it was closed (it is then
+  // last_closed())
+  bool expire(std::int64_t now_ms) {
+    if (open_.id == 0) return false;
+    const bool quiet = now_ms - open_.last_ms > std::int64_t(INCIDENT_GAP_MS);
+    if (!quiet && now_ms - open_.start_ms < std::int64_t(INCIDENT_MAX_MS)) return false;
+    open_.split = !quiet;
+    for (const IncidentMember& m : open_.members) slot_[m.stream] = 0;
+    if (closed_.size() == INCIDENT_HISTORY) closed_.erase(closed_.begin());
+    closed_.push_back(std::move(open_));
+    open_ = Incident();
+    return true;
+  }
+
+  // A stream id that was released and reused joins as a new member
+  void reset_stream(std::uint32_t stream) {
+    if (stream < slot_.size()) slot_[stream] = 0;
+  }
+
+  bool active() const { return open_.id != 0; }
+  const Incident& current() const { return open_; }
+
+  // The stream's member of the open incident, or null
+  const IncidentMember* member(std::uint32_t stream) const {
+    return stream < slot_.size() && slot_[stream] ? &open_.members[slot_[stream] - 1] : nullptr;
+  }
+  const Incident& last_closed() const { return closed_.back(); }
+  const std::vector<Incident>& closed() const { return closed_; }
+
+  // Incidents opened by this process, and anomalous samples folded into a member already
+  // reported (alerts not raised)
+  std::uint64_t opened() const { return opened_; }
+  std::uint64_t repeats() const { return repeats_; }
+
+  // Number incidents on from `last_id` (the highest in a reopened journal)
+  void resume(std::uint32_t last_id) {
+    if (last_id > last_id_) last_id_ = last_id;
+  }
+
+  void clear() {
+    slot_.assign(slot_.size(), 0);
+    open_ = Incident();
+    closed_.clear();
+  }
+
+private:
+  Incident open_;
+  std::vector<Incident> closed_;
+  std::vector<std::uint32_t> slot_;   // per stream: 1 + its member index in open_, 0 if none
+  std::uint32_t last_id_{0};
+  std::uint64_t opened_{0};
+  std::uint64_t repeats_{0};
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include "config.hpp"
+#include "sample_history.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A stream whose changes preceded the alerting stream's
+struct LeadingIndicator {
+  std::uint32_t stream;
+  std::int32_t lead_ms;        // how much earlier it moved
+  float r;                     // correlation of the changes at that lead; < 0: opposite direction
+};
+
+// Root-cause hints: which streams moved first. On an alert, every stream's
+// recent history is decoded from SampleHistory into LEAD_BIN_MS bins over
+// the last LEAD_WINDOW_MS (bin means, an empty bin holding the level before
+// it), and the changes between bins are correlated against the alerting
+// stream's at each lead from one bin to LEAD_MAX_LAG_MS. A stream counts as
+// leading when its best lead correlates at least LEAD_MIN_R and better than
+// moving in the same bin.
+//
+// Computed on demand, not kept up to date: with a few hundred bins and
+// lags the direct lagged products (vectorized, about 15k multiply-adds per
+// stream) cost less than transforming both series, and nothing is spent
+// while no alert is being raised. One call decodes at most
+// LEAD_MAX_CANDIDATES streams: the host metrics, then the next slice of the
+// collector streams, so with thousands of them each is still a candidate
+// every few alerts.
+class LeadLagAnalyzer {
+public:
+  static constexpr std::size_t BINS = LEAD_WINDOW_MS / LEAD_BIN_MS;
+  static constexpr std::size_t CHANGES = BINS - 1;
+  static constexpr std::size_t MAX_LAG = LEAD_MAX_LAG_MS / LEAD_BIN_MS;
+
+  LeadLagAnalyzer();
+
+  // Up to `top` streams of `history` other than `target` that led it in the
+  // window ending at now_ms (history time), strongest first
+  std::vector<LeadingIndicator> leaders(const SampleHistory& history, std::size_t target,
+                                        std::int64_t now_ms, std::size_t top);
+
+private:
+  bool changes(const SampleHistory& history, std::size_t stream, std::int64_t from_ms, float* out);
+
+  std::vector<float> target_;
+  std::vector<float> candidate_;
+  std::vector<double> sum_;
+  std::vector<std::uint32_t> count_;
+  std::size_t next_{0};          // first collector stream of the next slice
+};
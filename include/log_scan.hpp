@@ -0,0 +1,176 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Line and substring counting over blocks of log text, and the prefilter
+// that keeps most lines away from a regex. The byte loops are
+// branch-free so the compiler vectorizes them (16 or 32 bytes a step);
+// anything data-dependent happens only at the rare candidate positions.
+
+// Bytes scanned per inner loop: small enough for the candidate flags to
+// stay in L1, large enough to amortize the check for any set flag
+constexpr std::size_t LOG_SCAN_WINDOW = 256;
+
+// Newlines in [p, p + n)
+inline std::size_t count_newlines(const char* p, std::size_t n) {
+  const unsigned char* s = reinterpret_cast<const unsigned char*>(p);
+  std::size_t total = 0;
+  // Byte-wide sums (at most 255 per lane) widened once per run, rather
+  // than widening every compare
+  while (n > 0) {
+    const std::size_t run = n < 255 * 16 ? n : 255 * 16;
+    std::uint8_t lane[16] = {};
+    std::size_t i = 0;
+    for (; i + 16 <= run; i += 16) {
+      for (int j = 0; j < 16; ++j) lane[j] = std::uint8_t(lane[j] + (s[i + j] == '\n'));
+    }
+    for (; i < run; ++i) total += s[i] == '\n';
+    for (int j = 0; j < 16; ++j) total += lane[j];
+    s += run;
+    n -= run;
+  }
+  return total;
+}
+
+// Lines containing a fixed string. Candidates are the offsets where the
+// needle's first and last bytes both match, flagged a window at a time by
+// a vectorized compare; only those are compared in full. After a match the
+// scan skips to the next line, so each line counts once.
+class LiteralScanner {
+public:
+  explicit LiteralScanner(std::string needle) : needle_(std::move(needle)) {}
+
+  const std::string& needle() const { return needle_; }
+
+  // Calls line(begin, end) for each line of [p, p + n) containing the
+  // needle, `end` at its newline (or p + n for a last line without one);
+  // returns how many
+  template <typename F>
+  std::size_t each_line(const char* p, std::size_t n, F&& line) const {
+    const std::size_t k = needle_.size();
+    if (k == 0 || n < k) return 0;
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(p);
+    const unsigned char first = static_cast<unsigned char>(needle_.front());
+    const unsigned char last = static_cast<unsigned char>(needle_.back());
+    const std::size_t starts = n - k + 1;    // offsets a match may start at
+    std::size_t count = 0;
+    std::size_t i = 0;
+    std::size_t line_start = 0;              // of the line after the last match
+    // Flags padded to whole words; the padding stays zero
+    alignas(8) std::uint8_t cand[LOG_SCAN_WINDOW + 8];
+    while (i < starts) {
+      const std::size_t w = starts - i < LOG_SCAN_WINDOW ? starts - i : LOG_SCAN_WINDOW;
+      const unsigned char* a = s + i;
+      const unsigned char* b = s + i + k - 1;
+      for (std::size_t j = 0; j < w; ++j) cand[j] = std::uint8_t((a[j] == first) & (b[j] == last));
+      std::memset(cand + w, 0, 8);
+      std::size_t next = i + w;
+      for (std::size_t j = 0; j < w; j += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, cand + j, 8);
+        while (word != 0) {
+          const std::size_t at = i + j + std::size_t(ctz64(word) >> 3);
+          word &= word - 1;
+          if (std::memcmp(s + at, needle_.data(), k) != 0) continue;
+          ++count;
+          const void* prev = at > line_start ? find_back(s + line_start, '\n', at - line_start) : nullptr;
+          const std::size_t begin = prev ? std::size_t(static_cast<const unsigned char*>(prev) - s) + 1 : line_start;
+          const void* nl = std::memchr(s + at + k, '\n', n - at - k);
+          const std::size_t end = nl ? std::size_t(static_cast<const unsigned char*>(nl) - s) : n;
+          line(p + begin, p + end);
+          if (!nl) return count;
+          next = line_start = end + 1;
+          goto window_done;
+        }
+      }
+    window_done:
+      i = next;
+    }
+    return count;
+  }
+
+  // Lines of [p, p + n) containing the needle
+  std::size_t count_lines(const char* p, std::size_t n) const {
+    return each_line(p, n, [](const char*, const char*) {});
+  }
+
+private:
+  static const void* find_back(const unsigned char* p, int c, std::size_t n) {
+    while (n > 0) {
+      if (p[--n] == c) return p + n;
+    }
+    return nullptr;
+  }
+
+  static unsigned ctz64(std::uint64_t x) {
+#if defined(__GNUC__)
+    return unsigned(__builtin_ctzll(x));
+#else
+    unsigned n = 0;
+    while (!(x & 1)) {
+      x >>= 1;
+      ++n;
+    }
+    return n;
+#endif
+  }
+
+  std::string needle_;
+};
+
+// A fixed string every match of the ECMAScript regex `re` contains (the
+// longest run of plain characters outside any group), or "" if none can be
+// told without parsing it properly: alternation, or no such run. Lines
+// without it need not go through the regex.
+inline std::string regex_required_literal(const std::string& re) {
+  std::string best, run;
+  int depth = 0;
+  auto end_run = [&]() {
+    if (run.size() > best.size()) best = run;
+    run.clear();
+  };
+  for (std::size_t i = 0; i < re.size(); ++i) {
+    const char c = re[i];
+    if (c == '|') return std::string();
+    // A group may be optional as a whole
+    if (c == '(' || c == ')') {
+      depth += c == '(' ? 1 : -1;
+      end_run();
+      continue;
+    }
+    if (depth > 0) {
+      if (c == '\\') ++i;
+      continue;
+    }
+    const bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                       c == ' ' || c == '_' || c == '-' || c == ':' || c == '=' || c == '/' || c == '@' ||
+                       c == ',' || c == '\'' || c == '"' || c == '<' || c == '>' || c == '#' || c == '%';
+    if (!plain) {
+      end_run();
+      // Escapes and classes stand for a character we cannot name here
+      if (c == '\\') ++i;
+      if (c == '[') {
+        while (i + 1 < re.size() && re[i + 1] != ']') i += re[i + 1] == '\\' ? 2 : 1;
+        ++i;
+      }
+      // Bounds of a quantifier are not text
+      if (c == '{') {
+        while (i + 1 < re.size() && re[i + 1] != '}') ++i;
+        ++i;
+      }
+      continue;
+    }
+    // A quantifier that allows zero takes the character out of the run
+    const char q = i + 1 < re.size() ? re[i + 1] : '\0';
+    if (q == '?' || q == '*' || q == '{') {
+      end_run();
+      continue;
+    }
+    run += c;
+    if (q == '+') end_run();
+  }
+  end_run();
+  return best;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "config.hpp"
 #include <cstddef>
+#include <cstdint>
 
 // Generic platform metrics interface
 class PlatformMetrics {
@@ -18,6 +19,13 @@ public:
     
     // Cleanup platform-specific resources
     virtual void cleanup() = 0;
+    
+    // Exact uptime (ms) as of the last sample; the float in out[UPTIME_MS]
+    // only keeps 24 significant bits of it
+    std::uint64_t uptime_ms() const { return uptime_ms_; }
+    
+protected:
+    std::uint64_t uptime_ms_ = 0;
 };
 
 // Factory function to create appropriate platform implementation
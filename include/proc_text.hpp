@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// In-place parsing of the text files under /proc and /sys/fs/cgroup: no
+// allocation, no locale, nothing past the NUL the reader put at the end.
+
+// Next unsigned field; a leading '-' (signed fields we do not use) is skipped
+inline std::uint64_t next_field(const char*& p) {
+  while (*p == ' ' || *p == '\t') ++p;
+  if (*p == '-') ++p;
+  std::uint64_t v = 0;
+  while (*p >= '0' && *p <= '9') v = v * 10 + std::uint64_t(*p++ - '0');
+  return v;
+}
+
+// Bytes past the terminating NUL that next_field_padded may read
+constexpr std::size_t FIELD_PADDING = 8;
+
+// next_field eight digits at a time, for files that are mostly long
+// counters (/proc/stat). Loads up to FIELD_PADDING bytes past the NUL, so
+// the buffer needs that much slack.
+inline std::uint64_t next_field_padded(const char*& p) {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  static const std::uint64_t POW10[9] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+  while (*p == ' ' || *p == '\t') ++p;
+  if (*p == '-') ++p;
+  std::uint64_t v = 0;
+  for (;;) {
+    std::uint64_t x;
+    std::memcpy(&x, p, 8);
+    x -= 0x3030303030303030ull;
+    // High bit of each byte that is not a digit; a borrow only reaches
+    // the bytes after the first of them, which are dropped below
+    const std::uint64_t stop = (x | (x + 0x7676767676767676ull)) & 0x8080808080808080ull;
+    const unsigned k = stop ? unsigned(__builtin_ctzll(stop)) >> 3 : 8;
+    if (k == 0) return v;
+    // The k digits to the top bytes (first digit most significant), then
+    // pairs, quads and the eight combined
+    x <<= 8 * (8 - k);
+    x = ((x & 0x0f0f0f0f0f0f0f0full) * 2561) >> 8;
+    x = ((x & 0x00ff00ff00ff00ffull) * 6553601) >> 16;
+    x = ((x & 0x0000ffff0000ffffull) * 42949672960001ull) >> 32;
+    v = v * POW10[k] + x;
+    p += k;
+    if (k < 8) return v;
+  }
+#else
+  return next_field(p);
+#endif
+}
+
+// Value after "<key>" in a "key value" / "key: value" / "key=value" file,
+// 0 if absent
+inline std::uint64_t field_after(const char* buf, const char* key) {
+  const char* p = std::strstr(buf, key);
+  if (!p) return 0;
+  p += std::strlen(key);
+  return next_field(p);
+}
+
+// Increase of a kernel counter from `prev` to `cur`, allowing for a 32-bit
+// counter that wrapped (net/dev on some drivers, anything on a 32-bit
+// kernel); false if it went back otherwise, i.e. was reset
+inline bool counter_delta(std::uint64_t prev, std::uint64_t cur, std::uint64_t& delta) {
+  if (cur >= prev) {
+    delta = cur - prev;
+    return true;
+  }
+  if (prev > 0xffffffffull) return false;
+  delta = (0x100000000ull - prev) + cur;
+  return true;
+}
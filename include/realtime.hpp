@@ -0,0 +1,69 @@
+#pragma once
+#include "config.hpp"
+#include "anomaly_stats.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#endif
+
+// Opt-in low-jitter mode for the sampling thread (--realtime[=CPU]): pinned
+// to one core, SCHED_FIFO at REALTIME_PRIORITY, every page locked and the
+// stack prefaulted, so the sampler is neither descheduled nor page-faulted
+// during the load spikes it is measuring. Each step falls back on its own
+// when not permitted (no CAP_SYS_NICE or RLIMIT_RTPRIO, not Linux); under a
+// finite RLIMIT_MEMLOCK only the pages mapped at entry are locked, or just
+// the stack if even those do not fit, so later allocations never fail for
+// it. What was achieved is reported, never fatal.
+//
+// In this mode sleep_until() wakes on an absolute CLOCK_MONOTONIC deadline
+// and records how late each wakeup was (not wakeups by a descriptor).
+class RealtimeSampler {
+public:
+  struct Status {
+    int cpu{-1};              // pinned core, -1 if not pinned
+    int priority{0};          // SCHED_FIFO priority, 0 if not real-time
+    bool memory_locked{false}; // pages mapped at entry (and later ones if unlimited)
+    std::string notes;        // what fell back, and why
+  };
+
+  // Apply to the calling thread; cpu < 0 picks the highest core it may run
+  // on. Returns true if every step succeeded.
+  bool enter(int cpu);
+
+  bool active() const { return active_; }
+  const Status& status() const { return status_; }
+
+  // Sleep until due_ms on the steady clock (steady_now_ms)
+  void sleep_until(std::int64_t due_ms);
+
+  // The same, returning early (true) when one of `wake` polls readable or
+  // has urgent data; `woken` flags which, in order. Off Linux the
+  // descriptors are not waited on.
+  bool sleep_until(std::int64_t due_ms, const std::vector<int>& wake, std::vector<std::uint8_t>& woken);
+
+  // Observed wakeup latency, microseconds past the deadline
+  std::uint64_t wakeups() const { return p50_.count(); }
+  double latency_p50_us() const { return p50_.value(); }
+  double latency_p99_us() const { return p99_.value(); }
+  double latency_max_us() const { return max_us_; }
+
+private:
+  void record(double late_us);
+
+  bool active_{false};
+  Status status_;
+  P2Quantile p50_{0.5};
+  P2Quantile p99_{0.99};
+  double max_us_{0.0};
+#ifdef __linux__
+  std::vector<pollfd> polls_;
+#endif
+};
+
+// Put the calling thread back to normal scheduling on the original cores.
+// Threads started after enter() inherit real-time mode; helper threads
+// (e.g. exports) call this first.
+void leave_realtime();
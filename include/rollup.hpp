@@ -0,0 +1,218 @@
+#pragma once
+#include "config.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Aggregate of the samples in a time range
+struct RollupSummary {
+  float min{0.0f};
+  float max{0.0f};
+  double sum{0.0};
+  double sumsq{0.0};
+  std::uint64_t count{0};
+
+  double mean() const { return count ? sum / double(count) : 0.0; }
+  double stddev() const {
+    if (count < 2) return 0.0;
+    double m = mean();
+    double var = sumsq / double(count) - m * m;
+    return var > 0.0 ? std::sqrt(var) : 0.0;
+  }
+  void merge(const RollupSummary& o) {
+    if (o.count == 0) return;
+    min = count ? (o.min < min ? o.min : min) : o.min;
+    max = count ? (o.max > max ? o.max : max) : o.max;
+    sum += o.sum;
+    sumsq += o.sumsq;
+    count += o.count;
+  }
+};
+
+// Fixed-size rings of min/max/sum/sumsq/count buckets at each resolution in
+// ROLLUP_RESOLUTION_MS, updated on every sample. A sample lands directly in
+// its bucket at every level (no cascading), so an update is O(levels) and
+// a bucket that has fallen out of its ring is simply overwritten. Memory is
+// fixed per stream (~200 KB with the default levels).
+//
+// Buckets are slot-major with streams contiguous, so add_row over a batch of
+// streams is a straight select/accumulate loop, like the scoring kernels.
+class RollupStore {
+  static constexpr std::int64_t EMPTY = INT64_MIN;
+
+  struct Level {
+    std::int64_t resolution_ms;
+    std::size_t buckets;
+    std::vector<std::int64_t> id;   // bucket number held by [slot * n + stream]
+    std::vector<float> min;
+    std::vector<float> max;
+    std::vector<double> sum;
+    std::vector<double> sumsq;
+    std::vector<std::uint32_t> count;
+    // Most recent bucket, so in-bucket updates skip the division
+    std::int64_t last_bucket{EMPTY};
+    std::int64_t last_start_ms{0};
+    std::size_t last_slot{0};
+  };
+
+  std::size_t n_{0};
+  Level levels_[ROLLUP_LEVELS];
+
+  static std::int64_t bucket_of(std::int64_t t_ms, std::int64_t resolution_ms) {
+    std::int64_t q = t_ms / resolution_ms;
+    return (t_ms % resolution_ms < 0) ? q - 1 : q;
+  }
+
+  static std::size_t slot_of(std::int64_t bucket, std::size_t buckets) {
+    std::int64_t r = bucket % std::int64_t(buckets);
+    return static_cast<std::size_t>(r < 0 ? r + std::int64_t(buckets) : r);
+  }
+
+  // Bucket number and ring slot for t_ms
+  static std::int64_t locate(Level& L, std::int64_t t_ms, std::size_t& slot) {
+    if (L.last_bucket == EMPTY || t_ms < L.last_start_ms ||
+        t_ms - L.last_start_ms >= L.resolution_ms) {
+      L.last_bucket = bucket_of(t_ms, L.resolution_ms);
+      L.last_start_ms = L.last_bucket * L.resolution_ms;
+      L.last_slot = slot_of(L.last_bucket, L.buckets);
+    }
+    slot = L.last_slot;
+    return L.last_bucket;
+  }
+
+public:
+  explicit RollupStore(std::size_t n = N_METRICS) {
+    for (std::size_t l = 0; l < ROLLUP_LEVELS; ++l) {
+      levels_[l].resolution_ms = ROLLUP_RESOLUTION_MS[l];
+      levels_[l].buckets = ROLLUP_BUCKETS[l];
+    }
+    resize(n);
+  }
+
+  std::size_t size() const { return n_; }
+  static constexpr std::size_t level_count() { return ROLLUP_LEVELS; }
+  std::int64_t resolution_ms(std::size_t level) const { return levels_[level].resolution_ms; }
+  std::size_t buckets(std::size_t level) const { return levels_[level].buckets; }
+
+  // Change the stream count; existing streams keep their buckets
+  void resize(std::size_t n) {
+    for (Level& L : levels_) {
+      Level next = L;
+      std::size_t cells = L.buckets * n;
+      next.id.assign(cells, EMPTY);
+      next.min.assign(cells, 0.0f);
+      next.max.assign(cells, 0.0f);
+      next.sum.assign(cells, 0.0);
+      next.sumsq.assign(cells, 0.0);
+      next.count.assign(cells, 0);
+      std::size_t keep = n < n_ ? n : n_;
+      for (std::size_t slot = 0; slot < L.buckets; ++slot) {
+        for (std::size_t i = 0; i < keep; ++i) {
+          std::size_t from = slot * n_ + i, to = slot * n + i;
+          next.id[to] = L.id[from];
+          next.min[to] = L.min[from];
+          next.max[to] = L.max[from];
+          next.sum[to] = L.sum[from];
+          next.sumsq[to] = L.sumsq[from];
+          next.count[to] = L.count[from];
+        }
+      }
+      L = std::move(next);
+    }
+    n_ = n;
+  }
+
+  // Forget one stream's buckets
+  void reset(std::size_t stream) {
+    for (Level& L : levels_) {
+      for (std::size_t slot = 0; slot < L.buckets; ++slot) L.id[slot * n_ + stream] = EMPTY;
+    }
+  }
+
+  // One sample for every stream in [0, n) at time t_ms
+  void add_row(std::int64_t t_ms, const float* x, std::size_t n) {
+    if (n > n_) n = n_;
+    for (Level& L : levels_) {
+      std::size_t slot;
+      const std::int64_t bucket = locate(L, t_ms, slot);
+      const std::size_t base = slot * n_;
+      std::int64_t* id = L.id.data() + base;
+      float* mn = L.min.data() + base;
+      float* mx = L.max.data() + base;
+      double* sum = L.sum.data() + base;
+      double* sumsq = L.sumsq.data() + base;
+      std::uint32_t* count = L.count.data() + base;
+      for (std::size_t i = 0; i < n; ++i) {
+        // A slot still holding an older bucket starts over
+        bool fresh = id[i] != bucket;
+        float v = x[i];
+        double d = v;
+        mn[i] = (fresh || v < mn[i]) ? v : mn[i];
+        mx[i] = (fresh || v > mx[i]) ? v : mx[i];
+        sum[i] = (fresh ? 0.0 : sum[i]) + d;
+        sumsq[i] = (fresh ? 0.0 : sumsq[i]) + d * d;
+        count[i] = (fresh ? 0u : count[i]) + 1u;
+        id[i] = bucket;
+      }
+    }
+  }
+
+  // One sample for one stream
+  void add(std::size_t stream, std::int64_t t_ms, float v) {
+    for (Level& L : levels_) {
+      std::size_t slot;
+      const std::int64_t bucket = locate(L, t_ms, slot);
+      const std::size_t c = slot * n_ + stream;
+      bool fresh = L.id[c] != bucket;
+      L.min[c] = (fresh || v < L.min[c]) ? v : L.min[c];
+      L.max[c] = (fresh || v > L.max[c]) ? v : L.max[c];
+      L.sum[c] = (fresh ? 0.0 : L.sum[c]) + double(v);
+      L.sumsq[c] = (fresh ? 0.0 : L.sumsq[c]) + double(v) * double(v);
+      L.count[c] = (fresh ? 0u : L.count[c]) + 1u;
+      L.id[c] = bucket;
+    }
+  }
+
+  // Bucket containing t_ms at `level` (empty if not retained)
+  RollupSummary bucket(std::size_t stream, std::size_t level, std::int64_t t_ms) const {
+    const Level& L = levels_[level];
+    const std::int64_t b = bucket_of(t_ms, L.resolution_ms);
+    const std::size_t c = slot_of(b, L.buckets) * n_ + stream;
+    RollupSummary s;
+    if (L.id[c] != b) return s;
+    s.min = L.min[c];
+    s.max = L.max[c];
+    s.sum = L.sum[c];
+    s.sumsq = L.sumsq[c];
+    s.count = L.count[c];
+    return s;
+  }
+
+  // Everything in [from_ms, to_ms] at `level`, whole buckets, at most one
+  // ring's worth: cost is the number of buckets, not samples
+  RollupSummary summarize(std::size_t stream, std::size_t level,
+                          std::int64_t from_ms, std::int64_t to_ms) const {
+    const Level& L = levels_[level];
+    std::int64_t first = bucket_of(from_ms, L.resolution_ms);
+    std::int64_t last = bucket_of(to_ms, L.resolution_ms);
+    if (last - first >= std::int64_t(L.buckets)) first = last - std::int64_t(L.buckets) + 1;
+    RollupSummary s;
+    for (std::int64_t b = first; b <= last; ++b) {
+      s.merge(bucket(stream, level, b * L.resolution_ms));
+    }
+    return s;
+  }
+
+  // The `count` buckets ending with the one holding now_ms, oldest first
+  void series(std::size_t stream, std::size_t level, std::int64_t now_ms,
+              std::size_t count, std::vector<RollupSummary>& out) const {
+    const Level& L = levels_[level];
+    if (count > L.buckets) count = L.buckets;
+    std::int64_t last = bucket_of(now_ms, L.resolution_ms);
+    out.clear();
+    for (std::int64_t b = last - std::int64_t(count) + 1; b <= last; ++b) {
+      out.push_back(bucket(stream, level, b * L.resolution_ms));
+    }
+  }
+};
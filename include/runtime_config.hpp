@@ -0,0 +1,119 @@
+#pragma once
+#include "config.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Tunables that can change while running. Defaults come from config.hpp;
+// a config file (see load_runtime_config) overrides any subset of them.
+struct RuntimeConfig {
+  std::uint64_t generation{0};   // assigned by ConfigStore::publish
+
+  float ewma_alpha{EWMA_ALPHA};
+  float z_threshold{Z_THRESHOLD};
+  float hysteresis_threshold{HYSTERESIS_THRESHOLD};
+  unsigned min_quiet_time_ms{MIN_QUIET_TIME_MS};
+  unsigned hysteresis_samples{HYSTERESIS_SAMPLES};
+  unsigned warmup_samples{WARMUP_SAMPLES};
+  unsigned sample_ms{SAMPLE_MS};
+  // Adaptive sampling: interval bounds, and ewma_alpha is then the weight of
+  // one sample_ms interval rather than of one sample
+  bool adaptive_sampling{false};
+  unsigned adaptive_min_ms{ADAPTIVE_MIN_SAMPLE_MS};
+  unsigned adaptive_max_ms{ADAPTIVE_MAX_SAMPLE_MS};
+  // Collectors sample at their own intervals (--multi-rate); like adaptive
+  // sampling, ewma_alpha is then per sample_ms rather than per sample.
+  // Fixed at startup, not read from the file.
+  bool multi_rate{false};
+
+  // Per-metric thresholds, indexed by Metric
+  std::array<float, N_METRICS> thresholds{
+    {CPU_THRESHOLD, RAM_THRESHOLD, DISK_THRESHOLD, HEAP_THRESHOLD, UPTIME_THRESHOLD}};
+  std::array<float, N_METRICS> hysteresis{
+    {CPU_HYSTERESIS, RAM_HYSTERESIS, DISK_HYSTERESIS, HEAP_HYSTERESIS, UPTIME_HYSTERESIS}};
+};
+
+// Parse a "key = value" config file ('#' starts a comment) on top of the
+// values already in `out`. On error, returns false, leaves `out` untouched
+// and describes the problem in `error`.
+bool load_runtime_config(const std::string& path, RuntimeConfig& out, std::string& error);
+
+// Publishes immutable RuntimeConfig snapshots, RCU-style.
+//
+// Readers call current() (one acquire load, never blocks) and may use the
+// snapshot until they announce a quiescent state with quiescent(reader),
+// typically once per main-loop iteration. The writer swaps the pointer
+// atomically and frees a retired snapshot only after every registered reader
+// has passed a quiescent state since it was replaced: on the next publish,
+// or from the quiescent() that lets it go (without waiting, if a writer is
+// busy it is left for later).
+class ConfigStore {
+public:
+  static constexpr std::size_t MAX_READERS = 8;
+
+  explicit ConfigStore(const RuntimeConfig& initial = RuntimeConfig());
+  ~ConfigStore();
+  ConfigStore(const ConfigStore&) = delete;
+  ConfigStore& operator=(const ConfigStore&) = delete;
+
+  // Reader side (wait-free)
+  std::size_t register_reader();
+  const RuntimeConfig* current() const {
+    return current_.load(std::memory_order_acquire);
+  }
+  void quiescent(std::size_t reader) {
+    readers_[reader].store(current()->generation, std::memory_order_release);
+    if (n_retired_.load(std::memory_order_acquire) != 0) try_reclaim();
+  }
+
+  // Writer side; returns the generation of the new snapshot
+  std::uint64_t publish(const RuntimeConfig& next);
+
+private:
+  void reclaim();
+  void try_reclaim();
+
+  std::atomic<const RuntimeConfig*> current_;
+  std::array<std::atomic<std::uint64_t>, MAX_READERS> readers_;
+  std::atomic<std::size_t> n_readers_{0};
+
+  std::mutex writer_mutex_;                    // serializes writers only
+  std::vector<const RuntimeConfig*> retired_;
+  std::atomic<std::size_t> n_retired_{0};     // retired_.size(), read without the lock
+  std::uint64_t next_generation_{1};
+};
+
+// Reloads the config file into a ConfigStore on SIGHUP (see
+// request_config_reload) and, on Linux, whenever inotify reports the file
+// was rewritten or replaced. Parsing happens on the watcher's own thread.
+class ConfigWatcher {
+public:
+  ConfigWatcher(std::string path, ConfigStore& store);
+  ~ConfigWatcher();
+
+  // What a key missing from the file reverts to (compiled-in defaults plus
+  // any command-line overrides); call before start()
+  void set_defaults(const RuntimeConfig& defaults) { defaults_ = defaults; }
+
+  bool start();
+  void stop();
+
+private:
+  void run();
+  void reload();
+
+  std::string path_;
+  ConfigStore& store_;
+  RuntimeConfig defaults_;
+  std::thread thread_;
+  int inotify_fd_{-1};
+  int stop_pipe_[2]{-1, -1};
+};
+
+// Async-signal-safe: ask running watchers to reload (call from SIGHUP handler)
+void request_config_reload();
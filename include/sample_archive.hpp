@@ -0,0 +1,157 @@
+#pragma once
+#include "config.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Columnar sample archive. The file is a header followed by self-describing
+// blocks of up to ARCHIVE_BLOCK_ROWS rows; each block holds a timestamp
+// column and one column per stream, each compressed on its own and carrying
+// its min/max so a reader can skip blocks without decoding them. A torn
+// block at the end (crash mid-write) is ignored by readers and dropped when
+// the writer reopens the file.
+//
+//   timestamps: first value in the block header, then zigzag varint
+//               delta-of-delta (one byte per row at a steady rate)
+//   values:     XOR with the previous value; a 4-bit length per value
+//               followed by its significant low bytes. Constant columns
+//               store nothing; incompressible ones are stored raw.
+
+struct ArchiveFileHeader {
+  char magic[8];                  // "ANOMARC1"
+  std::uint32_t columns;          // value columns (timestamps not counted)
+  std::uint32_t block_rows;
+};
+
+struct ArchiveBlockHeader {
+  std::uint32_t magic;            // ARCHIVE_BLOCK_MAGIC
+  std::uint32_t rows;
+  std::uint32_t bytes;            // whole block including this header
+  std::uint32_t time_bytes;       // encoded timestamp column
+  std::int64_t first_ms;
+  std::int64_t last_ms;
+};
+
+enum class ArchiveEncoding : std::uint32_t { RAW = 0, CONST = 1, XOR = 2 };
+
+// Precedes each value column's payload (payloads start 8-byte aligned)
+struct ArchiveColumnHeader {
+  ArchiveEncoding encoding;
+  std::uint32_t bytes;            // payload, excluding padding
+  float min;
+  float max;
+};
+
+constexpr std::uint32_t ARCHIVE_BLOCK_MAGIC = 0x4B4C4241;   // "ABLK"
+
+// Appends rows, one compressed block at a time
+class ArchiveWriter {
+public:
+  ArchiveWriter() = default;
+  ~ArchiveWriter();
+  ArchiveWriter(const ArchiveWriter&) = delete;
+  ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+  // Create `path`, or append to it if it holds an archive with the same
+  // number of columns
+  bool open(const std::string& path, std::size_t columns, std::string& error);
+  void close();
+  bool is_open() const { return fd_ >= 0; }
+
+  // Buffer one row; a block is written when full or ARCHIVE_FLUSH_MS old
+  bool append(std::int64_t t_ms, const float* values);
+  // Write buffered rows now
+  bool flush();
+
+private:
+  std::size_t columns_{0};
+  int fd_{-1};
+  std::vector<std::int64_t> times_;
+  std::vector<std::vector<float>> values_;   // per column
+  std::vector<unsigned char> block_;          // encode buffer
+};
+
+// Read-only view of an archive through mmap
+class ArchiveReader {
+public:
+  // One block; columns are decoded on first access into 64-byte aligned
+  // scratch owned by the reader (raw columns point straight into the map)
+  class Block {
+  public:
+    std::size_t rows() const { return header_->rows; }
+    std::int64_t first_ms() const { return header_->first_ms; }
+    std::int64_t last_ms() const { return header_->last_ms; }
+    float min(std::size_t column) const { return columns_[column]->min; }
+    float max(std::size_t column) const { return columns_[column]->max; }
+
+    const std::int64_t* timestamps() const;
+    const float* column(std::size_t c) const;
+
+  private:
+    friend class ArchiveReader;
+    const ArchiveReader* reader_{nullptr};
+    const ArchiveBlockHeader* header_{nullptr};
+    const unsigned char* time_data_{nullptr};
+    std::vector<const ArchiveColumnHeader*> columns_;
+  };
+
+  ArchiveReader() = default;
+  ~ArchiveReader();
+  ArchiveReader(const ArchiveReader&) = delete;
+  ArchiveReader& operator=(const ArchiveReader&) = delete;
+
+  bool open(const std::string& path, std::string& error);
+  void close();
+
+  std::size_t columns() const { return columns_; }
+  std::size_t blocks() const { return blocks_.size(); }
+  std::uint64_t rows() const { return rows_; }
+  std::uint64_t file_bytes() const { return bytes_; }
+
+  // f(const Block&) for blocks overlapping [from_ms, to_ms], in order;
+  // return false from f to stop
+  template <class F>
+  void for_each_block(std::int64_t from_ms, std::int64_t to_ms, F&& f) const {
+    for (std::size_t b = 0; b < blocks_.size(); ++b) {
+      const ArchiveBlockHeader& h = blocks_[b].header;
+      if (h.last_ms < from_ms) continue;
+      if (h.first_ms > to_ms) break;
+      if (!f(block(b))) break;
+    }
+  }
+
+  template <class F>
+  void for_each_block(F&& f) const {
+    for_each_block(INT64_MIN, INT64_MAX, f);
+  }
+
+  const Block& block(std::size_t b) const;
+
+private:
+  void decode_times(const Block& b) const;
+  void decode_column(const Block& b, std::size_t c) const;
+
+  const unsigned char* map_{nullptr};
+  std::size_t bytes_{0};
+  std::size_t columns_{0};
+  std::size_t block_rows_{0};
+  std::uint64_t rows_{0};
+  struct IndexEntry {
+    ArchiveBlockHeader header;
+    std::size_t offset;           // of the block in the file
+  };
+  std::vector<IndexEntry> blocks_;
+
+  // Decoded state for the current block
+  mutable Block current_;
+  mutable std::size_t current_index_{SIZE_MAX};
+  mutable bool times_ready_{false};
+  mutable std::vector<std::uint8_t> column_ready_;
+  unsigned char* scratch_{nullptr};           // times, then one slot per column
+  std::int64_t* times_{nullptr};
+  mutable std::vector<const float*> column_ptr_;
+  // Mapped pages before this offset have been handed back, so a sequential
+  // scan holds only about one block of the file resident
+  mutable std::size_t released_{0};
+};
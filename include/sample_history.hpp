@@ -0,0 +1,137 @@
+#pragma once
+#include "config.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Compressed per-stream sample history in the style of Facebook's Gorilla
+// (Pelkonen et al., VLDB 2015): timestamps as delta-of-delta, values XORed
+// with their predecessor. A regular sampling interval costs one bit per
+// timestamp and an unchanged value one bit, so a point takes a few bytes.
+//
+// Each stream is a ring of fixed-size blocks that each start from a raw
+// timestamp and value and decode independently; when the ring is full the
+// oldest block is reused, so memory per stream is bounded by
+// HISTORY_BLOCK_BYTES * HISTORY_MAX_BLOCKS (HISTORY_COLLECTOR_BLOCKS for
+// streams from cap_from() on).
+class SampleHistory {
+  static constexpr std::size_t BLOCK_WORDS = HISTORY_BLOCK_BYTES / sizeof(std::uint64_t);
+
+  struct Block {
+    std::unique_ptr<std::uint64_t[]> words;   // BLOCK_WORDS + 1 (reader lookahead)
+    std::size_t bits{0};
+    std::uint32_t count{0};
+    std::int64_t first_ms{0};
+    std::int64_t last_ms{0};
+  };
+
+  struct Stream {
+    std::vector<Block> ring;
+    std::size_t head{0};                      // oldest block
+    std::size_t used{0};                      // blocks in use
+    // Encoder state for the newest block
+    std::int64_t prev_ms{0};
+    std::int64_t prev_delta{0};
+    std::uint32_t prev_bits{0};
+    unsigned prev_leading{0};
+    unsigned prev_trailing{0};
+  };
+
+public:
+  // Sequential decoder over one stream, oldest point first
+  class Cursor {
+  public:
+    bool next(std::int64_t& t_ms, float& value);
+
+  private:
+    friend class SampleHistory;
+    Cursor(const Stream* s, std::size_t block, std::int64_t from_ms);
+    bool open_block();
+    std::uint64_t read(unsigned n);
+
+    const Stream* stream_;
+    std::size_t block_;          // ring position relative to head
+    std::int64_t from_ms_;
+    const std::uint64_t* words_{nullptr};
+    std::size_t pos_{0};
+    std::uint32_t left_{0};      // points still to decode in this block
+    std::int64_t t_{0};
+    std::int64_t delta_{0};
+    std::uint32_t bits_{0};
+    unsigned leading_{0};
+    unsigned trailing_{0};
+    bool first_{true};
+  };
+
+  explicit SampleHistory(std::size_t n_streams = N_METRICS) : streams_(n_streams) {}
+
+  std::size_t size() const { return streams_.size(); }
+  void resize(std::size_t n) { streams_.resize(n); }
+  // Forget one stream's history (e.g. its slot is being reused)
+  void reset(std::size_t stream) { streams_[stream] = Stream{}; }
+  // Streams from `first` on keep at most HISTORY_COLLECTOR_BLOCKS
+  void cap_from(std::size_t first) { capped_from_ = first; }
+
+  // Append one point; timestamps must not decrease
+  void append(std::size_t stream, std::int64_t t_ms, float value);
+
+  // Append a row sampled at the same instant for streams [0, n)
+  void append(std::int64_t t_ms, const float* values, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) append(i, t_ms, values[i]);
+  }
+
+  // Points with t >= from_ms, oldest first
+  Cursor read(std::size_t stream, std::int64_t from_ms = INT64_MIN) const;
+
+  // Decode every row (all streams at one timestamp) with t >= from_ms, e.g.
+  // to replay history into a detector: f(t_ms, const float* row, n)
+  template <class F>
+  void for_each_row(std::int64_t from_ms, F&& f) const;
+
+  std::size_t points(std::size_t stream) const;
+  std::size_t encoded_bytes(std::size_t stream) const;     // compressed data
+  std::size_t allocated_bytes(std::size_t stream) const;   // blocks held
+  std::int64_t oldest_ms(std::size_t stream) const;        // INT64_MAX if empty
+
+private:
+  void start_block(Stream& s, std::int64_t t_ms, std::uint32_t bits, std::size_t max_blocks);
+  static const Block& block_at(const Stream& s, std::size_t k) {
+    return s.ring[(s.head + k) % s.ring.size()];
+  }
+
+  std::vector<Stream> streams_;
+  std::size_t capped_from_{SIZE_MAX};
+};
+
+template <class F>
+void SampleHistory::for_each_row(std::int64_t from_ms, F&& f) const {
+  const std::size_t n = streams_.size();
+  std::vector<Cursor> cursors;
+  std::vector<std::int64_t> t(n);
+  std::vector<float> row(n);
+  std::vector<std::uint8_t> live(n, 0);
+  cursors.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    cursors.push_back(read(i, from_ms));
+    live[i] = cursors[i].next(t[i], row[i]);
+  }
+  // Merge-join on timestamp: emit when every stream has a point at the
+  // latest pending time, otherwise advance the ones behind it
+  for (;;) {
+    std::int64_t target = INT64_MIN;
+    for (std::size_t i = 0; i < n; ++i) {
+      if (!live[i]) return;
+      if (t[i] > target) target = t[i];
+    }
+    bool aligned = true;
+    for (std::size_t i = 0; i < n; ++i) {
+      while (live[i] && t[i] < target) live[i] = cursors[i].next(t[i], row[i]);
+      if (!live[i]) return;
+      aligned = aligned && t[i] == target;
+    }
+    if (!aligned) continue;
+    f(target, static_cast<const float*>(row.data()), n);
+    for (std::size_t i = 0; i < n; ++i) live[i] = cursors[i].next(t[i], row[i]);
+  }
+}
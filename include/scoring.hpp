@@ -0,0 +1,833 @@
+#pragma once
+#include "config.hpp"
+#include "runtime_config.hpp"
+#include "stats.hpp"
+#include "bf16.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Scoring policies for BasicAnomalyDetector.
+//
+// A scoring policy owns the per-stream baseline in structure-of-arrays form
+// and exposes one batch call:
+//
+//   void score(const float* x, float* z, std::size_t n, std::int64_t now_ms,
+//              const std::uint8_t* fresh);
+//
+// which folds x[i] into the baseline of each stream i with fresh[i] set and
+// writes its z-score to z[i]; streams not fresh this feed (sampled at a
+// slower rate) keep their baseline and z[i]. Plus resize(n), reset(i),
+// apply(const RuntimeConfig&) to pick up reloaded tunables,
+// stage_counter(i, reading) to hand over an exact 64-bit counter reading for
+// the next score (ignored by policies that only work on floats),
+// set_quantum(i, q) for the integer step of stream i (ignored likewise) and
+// onset_ms(i), when the change stream i is scoring began (NO_CHANGE_ONSET
+// from policies that only score deviations).
+// Loops use selects instead of data-dependent branches so every
+// instantiation inlines into the detector and vectorizes.
+
+constexpr std::int64_t NO_CHANGE_ONSET = INT64_MIN;
+
+// Per-stream smoothing factors for one feed. Normally ewma_alpha per sample;
+// with adaptive sampling or multi-rate collectors it is the weight of one
+// nominal sample_ms interval, and a stream updated dt ms after its previous
+// update gets 1 - (1 - alpha)^(dt / sample_ms), so every baseline forgets at
+// the same wall-clock pace whatever its rate. Streams sharing an interval
+// hit a one-entry cache, so the transcendental (and, for the fixed-point
+// policy, the Q.16 conversion) runs about once per distinct rate and feed,
+// outside the per-stream loops.
+//
+// Per-stream state exists only while enabled: the time of each stream's
+// last update as the low 32 bits of its steady ms (intervals are taken
+// modulo 2^32, exact up to 49 days), plus the array handed out by alphas()
+// or alphas_q() to the policies that use one. Disabled, those return null
+// and every stream takes nominal().
+class RateNormalizer {
+  static constexpr std::uint32_t UNSEEN = 0;
+
+  float alpha_{EWMA_ALPHA};
+  double nominal_ms_{double(SAMPLE_MS)};
+  bool enabled_{false};
+  std::size_t n_{0};
+  std::vector<std::uint32_t> last_;
+  std::vector<float> alphas_;
+  std::vector<std::int32_t> alphas_q_;   // Q.16
+  std::uint32_t cached_dt_{0};
+  float cached_alpha_{EWMA_ALPHA};
+  std::int32_t cached_alpha_q_{std::int32_t(fixed_alpha(EWMA_ALPHA))};
+
+  // Advance stream i's last update to now_ms; false on its first, else the
+  // cache holds the factor for the interval since the previous one
+  bool advance(std::size_t i, std::int64_t now_ms) {
+    std::uint32_t t = std::uint32_t(now_ms);
+    t = t == UNSEEN ? 1u : t;
+    const std::uint32_t prev = last_[i];
+    last_[i] = t;
+    if (prev == UNSEEN) return false;
+    std::uint32_t dt = t - prev;
+    dt = dt < 1 ? 1 : dt;
+    if (dt != cached_dt_) {
+      cached_dt_ = dt;
+      cached_alpha_ = float(-std::expm1(double(dt) / nominal_ms_ * std::log1p(-double(alpha_))));
+      cached_alpha_q_ = std::int32_t(fixed_alpha(cached_alpha_));
+    }
+    return true;
+  }
+
+public:
+  void resize(std::size_t n) {
+    n_ = n;
+    if (enabled_) last_.resize(n, UNSEEN);
+  }
+
+  void reset(std::size_t i) {
+    if (enabled_) last_[i] = UNSEEN;
+  }
+
+  void apply(const RuntimeConfig& cfg) {
+    bool enabled = cfg.adaptive_sampling || cfg.multi_rate;
+    if (enabled && !enabled_) {
+      last_.assign(n_, UNSEEN);
+    } else if (!enabled) {
+      // Intervals measured before would be stale when re-enabled
+      std::vector<std::uint32_t>().swap(last_);
+      std::vector<float>().swap(alphas_);
+      std::vector<std::int32_t>().swap(alphas_q_);
+    }
+    alpha_ = cfg.ewma_alpha;
+    nominal_ms_ = double(cfg.sample_ms);
+    enabled_ = enabled;
+    cached_dt_ = 0;
+  }
+
+  float nominal() const { return alpha_; }
+  std::int32_t nominal_q() const { return std::int32_t(fixed_alpha(alpha_)); }
+
+  // Smoothing factor of one fresh stream updated at now_ms, for policies
+  // without a per-stream array of them
+  float alpha(std::size_t i, std::int64_t now_ms) {
+    return enabled_ && advance(i, now_ms) ? cached_alpha_ : alpha_;
+  }
+
+  // Smoothing factor per stream for the streams marked fresh at now_ms;
+  // null while disabled (nominal() for every stream)
+  const float* alphas(std::int64_t now_ms, const std::uint8_t* fresh, std::size_t n) {
+    if (!enabled_) return nullptr;
+    if (alphas_.size() != n_) alphas_.resize(n_, alpha_);
+    float* a = alphas_.data();
+    for (std::size_t i = 0; i < n; ++i) {
+      if (fresh[i]) a[i] = advance(i, now_ms) ? cached_alpha_ : alpha_;
+    }
+    return a;
+  }
+
+  // The same as Q.16 multipliers (fixed_alpha), for the fixed-point policy;
+  // null while disabled (nominal_q())
+  const std::int32_t* alphas_q(std::int64_t now_ms, const std::uint8_t* fresh, std::size_t n) {
+    if (!enabled_) return nullptr;
+    const std::int32_t nominal_q = this->nominal_q();
+    if (alphas_q_.size() != n_) alphas_q_.resize(n_, nominal_q);
+    std::int32_t* a = alphas_q_.data();
+    for (std::size_t i = 0; i < n; ++i) {
+      if (fresh[i]) a[i] = advance(i, now_ms) ? cached_alpha_q_ : nominal_q;
+    }
+    return a;
+  }
+
+  // Bytes held per stream
+  std::size_t bytes_per_stream() const {
+    if (n_ == 0) return 0;
+    return (last_.size() * sizeof(std::uint32_t) + alphas_.size() * sizeof(float) +
+            alphas_q_.size() * sizeof(std::int32_t)) / n_;
+  }
+};
+
+// EWMA mean & variance (same model as stats.hpp's EWMA)
+class EWMAScoring {
+  std::vector<float> mean_;
+  std::vector<float> var_;
+  std::vector<std::uint8_t> init_;
+  RateNormalizer rate_;
+
+public:
+  explicit EWMAScoring(std::size_t n = N_METRICS) { resize(n); }
+
+  void resize(std::size_t n) {
+    mean_.resize(n, 0.0f);
+    var_.resize(n, 0.0f);
+    init_.resize(n, 0);
+    rate_.resize(n);
+  }
+
+  void reset(std::size_t i) {
+    mean_[i] = 0.0f;
+    var_[i]  = 0.0f;
+    init_[i] = 0;
+    rate_.reset(i);
+  }
+
+  void apply(const RuntimeConfig& cfg) { rate_.apply(cfg); }
+  void stage_counter(std::size_t, std::uint64_t) {}
+  std::int64_t onset_ms(std::size_t) const { return NO_CHANGE_ONSET; }
+  void set_quantum(std::size_t, float) {}
+
+  const float* mean_data() const { return mean_.data(); }
+  const float* var_data() const { return var_.data(); }
+
+  void score(const float* x, float* z, std::size_t n, std::int64_t now_ms,
+             const std::uint8_t* fresh) {
+    float* mean = mean_.data();
+    float* var  = var_.data();
+    std::uint8_t* init = init_.data();
+    const float* alphas = rate_.alphas(now_ms, fresh, n);   // null: nominal for all
+    const float nominal = rate_.nominal();
+    for (std::size_t i = 0; i < n; ++i) {
+      const float alpha = alphas ? alphas[i] : nominal;
+      float delta = x[i] - mean[i];
+      float m = mean[i] + alpha * delta;
+      float v = alpha * (delta*delta) + (1.0f - alpha) * var[i];
+      // First sample seeds the baseline
+      bool seeded = init[i] != 0;
+      m = seeded ? m : x[i];
+      v = seeded ? v : 0.0f;
+      bool f = fresh[i] != 0;
+      mean[i] = f ? m : mean[i];
+      var[i]  = f ? v : var[i];
+      init[i] = std::uint8_t(init[i] | fresh[i]);
+
+      float zz = (x[i] - m) / std::sqrt(v + EPSILON);
+      zz = (v < EPSILON) ? 0.0f : zz;
+      z[i] = f ? zz : z[i];
+    }
+  }
+};
+
+// Median / mean-absolute-deviation baseline. The median follows the sample
+// by a step proportional to the current spread, so a single outlier moves it
+// no more than an ordinary sample does.
+class RobustScoring {
+  std::vector<float> median_;
+  std::vector<float> mad_;
+  std::vector<std::uint8_t> init_;
+  RateNormalizer rate_;
+
+  // Scales mean absolute deviation to a normal-equivalent sigma
+  static constexpr float MAD_TO_SIGMA = 1.2533f;
+
+public:
+  explicit RobustScoring(std::size_t n = N_METRICS) { resize(n); }
+
+  void resize(std::size_t n) {
+    median_.resize(n, 0.0f);
+    mad_.resize(n, 0.0f);
+    init_.resize(n, 0);
+    rate_.resize(n);
+  }
+
+  void reset(std::size_t i) {
+    median_[i] = 0.0f;
+    mad_[i]    = 0.0f;
+    init_[i]   = 0;
+    rate_.reset(i);
+  }
+
+  void apply(const RuntimeConfig& cfg) { rate_.apply(cfg); }
+  void stage_counter(std::size_t, std::uint64_t) {}
+  std::int64_t onset_ms(std::size_t) const { return NO_CHANGE_ONSET; }
+  void set_quantum(std::size_t, float) {}
+
+  void score(const float* x, float* z, std::size_t n, std::int64_t now_ms,
+             const std::uint8_t* fresh) {
+    float* median = median_.data();
+    float* mad    = mad_.data();
+    std::uint8_t* init = init_.data();
+    const float* alphas = rate_.alphas(now_ms, fresh, n);   // null: nominal for all
+    const float nominal = rate_.nominal();
+    // The median step is per nominal sample too
+    const float step_scale = ROBUST_STEP / nominal;
+    for (std::size_t i = 0; i < n; ++i) {
+      const float alpha = alphas ? alphas[i] : nominal;
+      float d = x[i] - median[i];
+      float sign = float(d > 0.0f) - float(d < 0.0f);
+      float m = median[i] + step_scale * alpha * (mad[i] + EPSILON) * sign;
+      float a = mad[i] + alpha * (std::fabs(d) - mad[i]);
+      bool seeded = init[i] != 0;
+      m = seeded ? m : x[i];
+      a = seeded ? a : 0.0f;
+      bool f = fresh[i] != 0;
+      median[i] = f ? m : median[i];
+      mad[i]    = f ? a : mad[i];
+      init[i]   = std::uint8_t(init[i] | fresh[i]);
+
+      float sigma = MAD_TO_SIGMA * a;
+      float zz = (x[i] - m) / (sigma + EPSILON);
+      zz = (sigma * sigma < EPSILON) ? 0.0f : zz;
+      z[i] = f ? zz : z[i];
+    }
+  }
+};
+
+// EWMA baseline kept per phase of a repeating period (SEASONAL_PERIOD_MS
+// split into SEASONAL_BUCKETS), so a nightly batch job is compared with
+// previous nights rather than with the afternoon. A phase bucket visited for
+// the first time is seeded from the stream's overall EWMA.
+class SeasonalScoring {
+  std::size_t n_{0};
+  EWMAScoring overall_;
+  std::vector<float> mean_;   // [bucket * n_ + stream]
+  std::vector<float> var_;
+  std::vector<std::uint8_t> init_;
+  std::vector<float> overall_z_;
+  RateNormalizer rate_;
+
+  static constexpr std::int64_t BUCKET_MS =
+      std::int64_t(SEASONAL_PERIOD_MS) / SEASONAL_BUCKETS;
+
+public:
+  explicit SeasonalScoring(std::size_t n = N_METRICS) { resize(n); }
+
+  void resize(std::size_t n) {
+    // Bucket-major layout: re-stride existing state to the new width
+    std::vector<float> mean(n * SEASONAL_BUCKETS, 0.0f);
+    std::vector<float> var(n * SEASONAL_BUCKETS, 0.0f);
+    std::vector<std::uint8_t> init(n * SEASONAL_BUCKETS, 0);
+    std::size_t keep = (n < n_) ? n : n_;
+    for (std::size_t b = 0; b < SEASONAL_BUCKETS; ++b) {
+      for (std::size_t i = 0; i < keep; ++i) {
+        mean[b * n + i] = mean_[b * n_ + i];
+        var[b * n + i]  = var_[b * n_ + i];
+        init[b * n + i] = init_[b * n_ + i];
+      }
+    }
+    mean_.swap(mean);
+    var_.swap(var);
+    init_.swap(init);
+    overall_.resize(n);
+    overall_z_.resize(n, 0.0f);
+    rate_.resize(n);
+    n_ = n;
+  }
+
+  void reset(std::size_t i) {
+    overall_.reset(i);
+    for (std::size_t b = 0; b < SEASONAL_BUCKETS; ++b) {
+      mean_[b * n_ + i] = 0.0f;
+      var_[b * n_ + i]  = 0.0f;
+      init_[b * n_ + i] = 0;
+    }
+    rate_.reset(i);
+  }
+
+  void apply(const RuntimeConfig& cfg) {
+    overall_.apply(cfg);
+    rate_.apply(cfg);
+  }
+  void stage_counter(std::size_t, std::uint64_t) {}
+  std::int64_t onset_ms(std::size_t) const { return NO_CHANGE_ONSET; }
+  void set_quantum(std::size_t, float) {}
+
+  void score(const float* x, float* z, std::size_t n, std::int64_t now_ms,
+             const std::uint8_t* fresh) {
+    overall_.score(x, overall_z_.data(), n, now_ms, fresh);
+    const float* seed_mean = overall_.mean_data();
+    const float* seed_var  = overall_.var_data();
+
+    std::size_t bucket = std::size_t((now_ms / BUCKET_MS) % SEASONAL_BUCKETS);
+    float* mean = mean_.data() + bucket * n_;
+    float* var  = var_.data() + bucket * n_;
+    std::uint8_t* init = init_.data() + bucket * n_;
+    const float* alphas = rate_.alphas(now_ms, fresh, n);   // null: nominal for all
+    const float nominal = rate_.nominal();
+    for (std::size_t i = 0; i < n; ++i) {
+      const float alpha = alphas ? alphas[i] : nominal;
+      bool seeded = init[i] != 0;
+      float m0 = seeded ? mean[i] : seed_mean[i];
+      float v0 = seeded ? var[i] : seed_var[i];
+      float delta = x[i] - m0;
+      float m = m0 + alpha * delta;
+      float v = alpha * (delta*delta) + (1.0f - alpha) * v0;
+      bool f = fresh[i] != 0;
+      mean[i] = f ? m : mean[i];
+      var[i]  = f ? v : var[i];
+      init[i] = std::uint8_t(init[i] | fresh[i]);
+
+      float zz = (x[i] - m) / std::sqrt(v + EPSILON);
+      zz = (v < EPSILON) ? 0.0f : zz;
+      z[i] = f ? zz : z[i];
+    }
+  }
+};
+
+// Default fixed-point step per metric (see FixedPointScoring)
+inline float default_quantum(std::size_t metric_idx) {
+  switch (metric_idx) {
+    case 0: return CPU_QUANTUM;    // CPU_UTIL
+    case 1: return RAM_QUANTUM;    // RAM_USED
+    case 2: return DISK_QUANTUM;   // DISK_IO_RATE
+    case 3: return HEAP_QUANTUM;   // HEAP_FREE
+    default: return DEFAULT_QUANTUM;
+  }
+}
+
+// Integer EWMA (see fixed_ewma_step in stats.hpp): 32-bit Q.8 mean and
+// variance per stream, deterministic and free of float drift. A stream for
+// which an exact reading is staged with stage_counter() is scored instead on
+// the increase of that 64-bit counter (CounterEWMA), so UPTIME_MS stays exact
+// after months rather than losing millisecond resolution at 2^24 ms.
+// The loop stays scalar under the default flags (the clamped float-to-int
+// quantize may trap, so GCC will not if-convert it): about 10 ns per stream
+// and feed, against about 5 ns for EWMAScoring.
+class FixedPointScoring {
+  std::vector<std::int32_t> mean_;        // Q.8 quanta
+  std::vector<std::uint32_t> var_;        // Q.8 quanta^2
+  std::vector<float> inv_quantum_;
+  std::vector<std::uint8_t> init_;
+  std::int64_t alpha_q_{fixed_alpha(EWMA_ALPHA)};
+  RateNormalizer rate_;
+
+  // Counter streams: slot per stream (-1 for gauges) and pending readings
+  std::vector<std::int32_t> counter_slot_;
+  std::vector<CounterEWMA> counters_;
+  std::vector<std::size_t> counter_stream_;
+  std::vector<std::uint64_t> staged_;
+  std::vector<std::uint8_t> has_staged_;
+
+public:
+  explicit FixedPointScoring(std::size_t n = N_METRICS) { resize(n); }
+
+  void resize(std::size_t n) {
+    std::size_t old = inv_quantum_.size();
+    mean_.resize(n, 0);
+    var_.resize(n, 0);
+    init_.resize(n, 0);
+    inv_quantum_.resize(n);
+    counter_slot_.resize(n, -1);
+    rate_.resize(n);
+    for (std::size_t i = old; i < n; ++i) inv_quantum_[i] = 1.0f / default_quantum(i);
+    // Drop counters of streams that no longer exist
+    for (std::size_t c = 0; c < counters_.size(); ) {
+      if (counter_stream_[c] >= n) {
+        counters_.erase(counters_.begin() + c);
+        counter_stream_.erase(counter_stream_.begin() + c);
+        staged_.erase(staged_.begin() + c);
+        has_staged_.erase(has_staged_.begin() + c);
+        for (std::size_t k = c; k < counters_.size(); ++k) {
+          counter_slot_[counter_stream_[k]] = std::int32_t(k);
+        }
+      } else {
+        ++c;
+      }
+    }
+  }
+
+  void reset(std::size_t i) {
+    mean_[i] = 0;
+    var_[i]  = 0;
+    init_[i] = 0;
+    rate_.reset(i);
+    std::int32_t c = counter_slot_[i];
+    if (c >= 0) {
+      counters_[c] = CounterEWMA();
+      counters_[c].alpha_q = alpha_q_;
+      has_staged_[c] = 0;
+    }
+  }
+
+  void apply(const RuntimeConfig& cfg) {
+    alpha_q_ = fixed_alpha(cfg.ewma_alpha);
+    rate_.apply(cfg);
+    // Counter streams stay per sample: their increase already scales with
+    // the interval
+    for (auto& c : counters_) c.alpha_q = alpha_q_;
+  }
+
+  std::int64_t onset_ms(std::size_t) const { return NO_CHANGE_ONSET; }
+
+  // Size of one integer step for stream i (values beyond 2^22 steps clamp)
+  void set_quantum(std::size_t i, float quantum) { inv_quantum_[i] = 1.0f / quantum; }
+
+  void stage_counter(std::size_t i, std::uint64_t reading) {
+    std::int32_t c = counter_slot_[i];
+    if (c < 0) {
+      c = std::int32_t(counters_.size());
+      counter_slot_[i] = c;
+      counters_.emplace_back();
+      counters_.back().alpha_q = alpha_q_;
+      counter_stream_.push_back(i);
+      staged_.push_back(0);
+      has_staged_.push_back(0);
+    }
+    staged_[c] = reading;
+    has_staged_[c] = 1;
+  }
+
+  void score(const float* x, float* z, std::size_t n, std::int64_t now_ms,
+             const std::uint8_t* fresh) {
+    std::int32_t* mean = mean_.data();
+    std::uint32_t* var = var_.data();
+    std::uint8_t* init = init_.data();
+    const float* inv_q = inv_quantum_.data();
+    const std::int32_t* alphas_q = rate_.alphas_q(now_ms, fresh, n);   // null: nominal for all
+    const std::int32_t nominal_q = rate_.nominal_q();
+    for (std::size_t i = 0; i < n; ++i) {
+      std::int32_t xq = fixed_quantize(x[i], inv_q[i]);
+      // First sample seeds the baseline
+      bool seeded = init[i] != 0;
+      std::int32_t m = seeded ? mean[i] : xq * (1 << FIXED_MEAN_FRAC);
+      std::uint32_t v = seeded ? var[i] : 0u;
+      std::int32_t dev = fixed_ewma_step(xq, m, v, alphas_q ? alphas_q[i] : nominal_q);
+      bool f = fresh[i] != 0;
+      mean[i] = f ? m : mean[i];
+      var[i]  = f ? v : var[i];
+      init[i] = std::uint8_t(init[i] | fresh[i]);
+      z[i] = f ? fixed_z_score(dev, v) : z[i];
+    }
+
+    for (std::size_t c = 0; c < counters_.size(); ++c) {
+      std::size_t i = counter_stream_[c];
+      if (i >= n || !has_staged_[c] || !fresh[i]) continue;
+      z[i] = counters_[c].update(staged_[c]);
+      has_staged_[c] = 0;
+    }
+  }
+};
+
+// EWMA with 6 bytes of state per stream for very large stream counts (10
+// with adaptive or multi-rate sampling, for the last update's time). The
+// mean is a quantized pair (int16 mantissa, int8 power-of-two exponent, ~15
+// significant bits) and the variance a bfloat16; both are widened to float
+// only inside the loop and written back with stochastic rounding, so updates
+// far below their resolution (alpha = 0.005) still move them on average.
+class CompactEWMAScoring {
+  std::vector<std::int16_t> mean_;    // mean = mean_ * 2^exp_
+  std::vector<std::int8_t> exp_;
+  std::vector<std::uint16_t> var_;    // bfloat16
+  std::vector<std::uint8_t> init_;
+  RateNormalizer rate_;
+  std::uint32_t tick_{0};
+
+  // Smallest magnitude given its own exponent; keeps exp within int8
+  static constexpr float MIN_MAGNITUDE = 1e-30f;
+
+public:
+  explicit CompactEWMAScoring(std::size_t n = N_METRICS) { resize(n); }
+
+  void resize(std::size_t n) {
+    mean_.resize(n, 0);
+    exp_.resize(n, 0);
+    var_.resize(n, 0);
+    init_.resize(n, 0);
+    rate_.resize(n);
+  }
+
+  void reset(std::size_t i) {
+    mean_[i] = 0;
+    exp_[i]  = 0;
+    var_[i]  = 0;
+    init_[i] = 0;
+    rate_.reset(i);
+  }
+
+  void apply(const RuntimeConfig& cfg) { rate_.apply(cfg); }
+  void stage_counter(std::size_t, std::uint64_t) {}
+  std::int64_t onset_ms(std::size_t) const { return NO_CHANGE_ONSET; }
+  void set_quantum(std::size_t, float) {}
+
+  std::size_t state_bytes_per_stream() const {
+    return sizeof(std::int16_t) + sizeof(std::int8_t) + sizeof(std::uint16_t) + sizeof(std::uint8_t) +
+           rate_.bytes_per_stream();
+  }
+
+  void score(const float* x, float* z, std::size_t n, std::int64_t now_ms,
+             const std::uint8_t* fresh) {
+    std::int16_t* mean = mean_.data();
+    std::int8_t* exps = exp_.data();
+    std::uint16_t* var = var_.data();
+    std::uint8_t* init = init_.data();
+    const float nominal = rate_.nominal();
+    const std::uint32_t tick = tick_++;
+    for (std::size_t i = 0; i < n; ++i) {
+      // Derived per feed from the stream's last update, not kept per stream
+      const float alpha = fresh[i] ? rate_.alpha(i, now_ms) : nominal;
+      float m0 = float(mean[i]) * exp2i(exps[i]);
+      float v0 = bf16_to_float(var[i]);
+      float delta = x[i] - m0;
+      float m = m0 + alpha * delta;
+      float v = alpha * (delta*delta) + (1.0f - alpha) * v0;
+      // First sample seeds the baseline
+      bool seeded = init[i] != 0;
+      m = seeded ? m : x[i];
+      v = seeded ? v : 0.0f;
+      bool f = fresh[i] != 0;
+
+      float zz = (x[i] - m) / std::sqrt(v + EPSILON);
+      zz = (v < EPSILON) ? 0.0f : zz;
+      z[i] = f ? zz : z[i];
+
+      // Re-encode: pick the exponent that puts |m| in [2^14, 2^15)
+      std::uint32_t r = mix_bits(std::uint32_t(i), tick);
+      float mag = std::fabs(m);
+      mag = mag < MIN_MAGNITUDE ? MIN_MAGNITUDE : mag;
+      int e = ilog2f(mag) - 14;
+      float q = m * exp2i(-e) + float(r >> 16) * (1.0f / 65536.0f);
+      std::int32_t qi = std::int32_t(q + 65536.0f) - 65536;   // floor
+      qi = qi > 32767 ? 32767 : qi;
+      mean[i] = f ? std::int16_t(qi) : mean[i];
+      exps[i] = f ? std::int8_t(e) : exps[i];
+      var[i]  = f ? bf16_from_float_sr(v, r) : var[i];
+      init[i] = std::uint8_t(init[i] | fresh[i]);
+    }
+  }
+};
+
+// Two-sided change statistics shared by the change-point policies, in
+// standard deviations: each side accumulates the residual beyond the slack
+// and floors at zero, so a shift of more than CHANGE_SLACK_SIGMA adds up
+// sample by sample however slowly it arrived. A second pair with the
+// smaller CHANGE_ONSET_SLACK_SIGMA times the change: its onset is the last
+// time that side was at zero, well before a slow ramp outgrows the full
+// slack. Structure of arrays like the baselines.
+class ChangeStatistics {
+  std::vector<float> up_;
+  std::vector<float> down_;
+  std::vector<float> early_up_;
+  std::vector<float> early_down_;
+  std::vector<std::int64_t> up_onset_;
+  std::vector<std::int64_t> down_onset_;
+
+public:
+  void resize(std::size_t n) {
+    up_.resize(n, 0.0f);
+    down_.resize(n, 0.0f);
+    early_up_.resize(n, 0.0f);
+    early_down_.resize(n, 0.0f);
+    up_onset_.resize(n, 0);
+    down_onset_.resize(n, 0);
+  }
+
+  void reset(std::size_t i) {
+    up_[i] = 0.0f;
+    down_[i] = 0.0f;
+    early_up_[i] = 0.0f;
+    early_down_[i] = 0.0f;
+  }
+
+  float* up() { return up_.data(); }
+  float* down() { return down_.data(); }
+  float* early_up() { return early_up_.data(); }
+  float* early_down() { return early_down_.data(); }
+  std::int64_t* up_onset() { return up_onset_.data(); }
+  std::int64_t* down_onset() { return down_onset_.data(); }
+
+  // When the larger side's change began; NO_CHANGE_ONSET if neither is under way
+  std::int64_t onset_ms(std::size_t i) const {
+    if (up_[i] <= 0.0f && down_[i] <= 0.0f) return NO_CHANGE_ONSET;
+    return up_[i] >= down_[i] ? up_onset_[i] : down_onset_[i];
+  }
+};
+
+// CUSUM (Page 1954) against a slow reference. The EWMA z-score learns a
+// slow leak into its mean and never crosses a threshold; here the residual
+// is taken from a reference that adapts CHANGE_REFERENCE_RATIO times as fast
+// and stands still while either side exceeds CHANGE_HOLD_SIGMA, scaled by
+// the spread of the ordinary EWMA (which follows the drift, so does not
+// absorb it). The score is the larger side, negative for a fall: a steady
+// shift of k + d standard deviations reaches a threshold h after about
+// h / d samples. Past CHANGE_RESTART_SIGMA the EWMA mean, which has
+// followed the new level, becomes the reference and both sides start over,
+// so the alert can clear.
+class CusumScoring {
+  std::vector<float> mean_;             // fast EWMA, for the spread
+  std::vector<float> var_;
+  std::vector<float> ref_;
+  std::vector<std::uint32_t> count_;    // samples, up to CHANGE_WARMUP_SAMPLES
+  ChangeStatistics change_;
+  RateNormalizer rate_;
+
+public:
+  explicit CusumScoring(std::size_t n = N_METRICS) { resize(n); }
+
+  void resize(std::size_t n) {
+    mean_.resize(n, 0.0f);
+    var_.resize(n, 0.0f);
+    ref_.resize(n, 0.0f);
+    count_.resize(n, 0);
+    change_.resize(n);
+    rate_.resize(n);
+  }
+
+  void reset(std::size_t i) {
+    mean_[i] = 0.0f;
+    var_[i] = 0.0f;
+    ref_[i] = 0.0f;
+    count_[i] = 0;
+    change_.reset(i);
+    rate_.reset(i);
+  }
+
+  void apply(const RuntimeConfig& cfg) { rate_.apply(cfg); }
+  void stage_counter(std::size_t, std::uint64_t) {}
+  std::int64_t onset_ms(std::size_t i) const { return change_.onset_ms(i); }
+  void set_quantum(std::size_t, float) {}
+
+  void score(const float* x, float* z, std::size_t n, std::int64_t now_ms,
+             const std::uint8_t* fresh) {
+    float* mean = mean_.data();
+    float* var  = var_.data();
+    float* ref  = ref_.data();
+    std::uint32_t* count = count_.data();
+    float* up   = change_.up();
+    float* down = change_.down();
+    float* early_up   = change_.early_up();
+    float* early_down = change_.early_down();
+    std::int64_t* up_onset   = change_.up_onset();
+    std::int64_t* down_onset = change_.down_onset();
+    const float* alphas = rate_.alphas(now_ms, fresh, n);   // null: nominal for all
+    const float nominal = rate_.nominal();
+    for (std::size_t i = 0; i < n; ++i) {
+      const float alpha = alphas ? alphas[i] : nominal;
+      // First sample seeds the baseline; until armed the reference is the
+      // plain mean of the samples so far, which the EWMA is still far from
+      bool seeded = count[i] != 0;
+      float delta = x[i] - mean[i];
+      float m = seeded ? mean[i] + alpha * delta : x[i];
+      float v = seeded ? alpha * (delta*delta) + (1.0f - alpha) * var[i] : 0.0f;
+      bool armed = count[i] >= CHANGE_WARMUP_SAMPLES;
+      float r0 = armed ? ref[i] : ref[i] + (x[i] - ref[i]) / float(count[i] + 1);
+
+      float u = (x[i] - r0) / std::sqrt(v + EPSILON);
+      u = (v < EPSILON) ? 0.0f : u;
+      float su = armed ? std::fmax(0.0f, up[i] + u - CHANGE_SLACK_SIGMA) : 0.0f;
+      float sd = armed ? std::fmax(0.0f, down[i] - u - CHANGE_SLACK_SIGMA) : 0.0f;
+      float eu = armed ? std::fmax(0.0f, early_up[i] + u - CHANGE_ONSET_SLACK_SIGMA) : 0.0f;
+      float ed = armed ? std::fmax(0.0f, early_down[i] - u - CHANGE_ONSET_SLACK_SIGMA) : 0.0f;
+      float zz = su >= sd ? su : -sd;
+
+      bool hold = std::fmax(su, sd) > CHANGE_HOLD_SIGMA;
+      float r = hold ? r0 : r0 + CHANGE_REFERENCE_RATIO * alpha * (x[i] - r0);
+      bool restart = std::fmax(su, sd) > CHANGE_RESTART_SIGMA;
+      r  = restart ? m : r;
+      su = restart ? 0.0f : su;
+      sd = restart ? 0.0f : sd;
+      eu = restart ? 0.0f : eu;
+      ed = restart ? 0.0f : ed;
+
+      bool f = fresh[i] != 0;
+      mean[i] = f ? m : mean[i];
+      var[i]  = f ? v : var[i];
+      ref[i]  = f ? r : ref[i];
+      up[i]   = f ? su : up[i];
+      down[i] = f ? sd : down[i];
+      early_up[i]   = f ? eu : early_up[i];
+      early_down[i] = f ? ed : early_down[i];
+      up_onset[i]   = (f && eu <= 0.0f) ? now_ms : up_onset[i];
+      down_onset[i] = (f && ed <= 0.0f) ? now_ms : down_onset[i];
+      count[i] = count[i] + std::uint32_t(f && count[i] < CHANGE_WARMUP_SAMPLES);
+      z[i] = f ? zz : z[i];
+    }
+  }
+};
+
+// Page-Hinkley test (Page 1954, Hinkley 1971): the same two-sided
+// accumulation, against the mean of every sample since the last change
+// (up to PH_MAX_SAMPLES) rather than an adapting reference, with the
+// spread from the ordinary EWMA. Nothing is learned away between changes,
+// so it is the more sensitive of the two to very slow drift, and suits
+// streams that should hold a level; one with a daily cycle alerts on it.
+// Restarts past CHANGE_RESTART_SIGMA like CusumScoring.
+class PageHinkleyScoring {
+  std::vector<float> mean_;             // fast EWMA, for the spread
+  std::vector<float> var_;
+  std::vector<float> ref_;              // mean since the last change
+  std::vector<float> weight_;           // samples in ref_
+  std::vector<std::uint32_t> count_;    // samples, up to CHANGE_WARMUP_SAMPLES
+  ChangeStatistics change_;
+  RateNormalizer rate_;
+
+public:
+  explicit PageHinkleyScoring(std::size_t n = N_METRICS) { resize(n); }
+
+  void resize(std::size_t n) {
+    mean_.resize(n, 0.0f);
+    var_.resize(n, 0.0f);
+    ref_.resize(n, 0.0f);
+    weight_.resize(n, 0.0f);
+    count_.resize(n, 0);
+    change_.resize(n);
+    rate_.resize(n);
+  }
+
+  void reset(std::size_t i) {
+    mean_[i] = 0.0f;
+    var_[i] = 0.0f;
+    ref_[i] = 0.0f;
+    weight_[i] = 0.0f;
+    count_[i] = 0;
+    change_.reset(i);
+    rate_.reset(i);
+  }
+
+  void apply(const RuntimeConfig& cfg) { rate_.apply(cfg); }
+  void stage_counter(std::size_t, std::uint64_t) {}
+  std::int64_t onset_ms(std::size_t i) const { return change_.onset_ms(i); }
+  void set_quantum(std::size_t, float) {}
+
+  void score(const float* x, float* z, std::size_t n, std::int64_t now_ms,
+             const std::uint8_t* fresh) {
+    float* mean = mean_.data();
+    float* var  = var_.data();
+    float* ref  = ref_.data();
+    float* weight = weight_.data();
+    std::uint32_t* count = count_.data();
+    float* up   = change_.up();
+    float* down = change_.down();
+    float* early_up   = change_.early_up();
+    float* early_down = change_.early_down();
+    std::int64_t* up_onset   = change_.up_onset();
+    std::int64_t* down_onset = change_.down_onset();
+    const float* alphas = rate_.alphas(now_ms, fresh, n);   // null: nominal for all
+    const float nominal = rate_.nominal();
+    for (std::size_t i = 0; i < n; ++i) {
+      const float alpha = alphas ? alphas[i] : nominal;
+      bool seeded = count[i] != 0;
+      float delta = x[i] - mean[i];
+      float m = seeded ? mean[i] + alpha * delta : x[i];
+      float v = seeded ? alpha * (delta*delta) + (1.0f - alpha) * var[i] : 0.0f;
+      float w = std::fmin(weight[i] + 1.0f, PH_MAX_SAMPLES);
+      float r = ref[i] + (x[i] - ref[i]) / w;
+
+      float u = (x[i] - r) / std::sqrt(v + EPSILON);
+      u = (v < EPSILON) ? 0.0f : u;
+      bool armed = count[i] >= CHANGE_WARMUP_SAMPLES;
+      float su = armed ? std::fmax(0.0f, up[i] + u - CHANGE_SLACK_SIGMA) : 0.0f;
+      float sd = armed ? std::fmax(0.0f, down[i] - u - CHANGE_SLACK_SIGMA) : 0.0f;
+      float eu = armed ? std::fmax(0.0f, early_up[i] + u - CHANGE_ONSET_SLACK_SIGMA) : 0.0f;
+      float ed = armed ? std::fmax(0.0f, early_down[i] - u - CHANGE_ONSET_SLACK_SIGMA) : 0.0f;
+      float zz = su >= sd ? su : -sd;
+
+      bool restart = std::fmax(su, sd) > CHANGE_RESTART_SIGMA;
+      r  = restart ? x[i] : r;
+      w  = restart ? 1.0f : w;
+      su = restart ? 0.0f : su;
+      sd = restart ? 0.0f : sd;
+      eu = restart ? 0.0f : eu;
+      ed = restart ? 0.0f : ed;
+
+      bool f = fresh[i] != 0;
+      mean[i]   = f ? m : mean[i];
+      var[i]    = f ? v : var[i];
+      ref[i]    = f ? r : ref[i];
+      weight[i] = f ? w : weight[i];
+      up[i]     = f ? su : up[i];
+      down[i]   = f ? sd : down[i];
+      early_up[i]   = f ? eu : early_up[i];
+      early_down[i] = f ? ed : early_down[i];
+      up_onset[i]   = (f && eu <= 0.0f) ? now_ms : up_onset[i];
+      down_onset[i] = (f && ed <= 0.0f) ? now_ms : down_onset[i];
+      count[i] = count[i] + std::uint32_t(f && count[i] < CHANGE_WARMUP_SAMPLES);
+      z[i] = f ? zz : z[i];
+    }
+  }
+};
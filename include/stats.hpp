@@ -1,6 +1,7 @@
 #pragma once
 #include "config.hpp"
 #include <cmath>
+#include <cstdint>
 
 // Exponentially‐weighted moving average & variance
 struct EWMA {
@@ -27,4 +28,138 @@ struct EWMA {
     if (!initialized || var < EPSILON) return 0.0f;
     return (x - mean) / std::sqrt(var + EPSILON);
   }
-};
\ No newline at end of file
+};
+
+// ---------------------------------------------------------------------------
+// Fixed-point EWMA
+//
+// Samples are quantized to integer multiples of a per-stream quantum. The
+// mean is kept in Q.8 (1/256 quantum) and the variance in Q.8 quantum^2, both
+// in 32-bit fields; updates use 64-bit intermediates and round symmetrically,
+// so the baseline is deterministic and cannot creep the way a float mean does
+// when alpha * delta falls below the mean's ulp. Valid for |x| < 2^22 quanta
+// and a standard deviation below 2896 quanta (the variance saturates above).
+// ---------------------------------------------------------------------------
+
+constexpr int FIXED_MEAN_FRAC = 8;
+constexpr int FIXED_VAR_FRAC = 8;
+constexpr int FIXED_ALPHA_FRAC = 16;
+constexpr std::int32_t FIXED_MAX_QUANTA = (1 << 22) - 1;
+
+// alpha as a Q.16 multiplier
+inline std::int64_t fixed_alpha(float alpha) {
+  return std::int64_t(alpha * float(1 << FIXED_ALPHA_FRAC) + 0.5f);
+}
+
+// t * alpha_q / 2^16 rounded to nearest, ties toward zero (no bias in either
+// direction), for t anywhere in int64 range: the product is split at 2^16 so
+// neither part can overflow whatever alpha is
+inline std::int64_t fixed_mul_alpha_wide(std::int64_t t, std::int64_t alpha_q) {
+  std::int64_t hi = t >> FIXED_ALPHA_FRAC;
+  std::int64_t lo = t - hi * (std::int64_t(1) << FIXED_ALPHA_FRAC);   // 0 <= lo < 2^16
+  return hi * alpha_q +
+         ((lo * alpha_q + ((std::int64_t(1) << (FIXED_ALPHA_FRAC - 1)) - 1) + (t < 0)) >> FIXED_ALPHA_FRAC);
+}
+
+// Quantize a sample to the stream's integer grid (round half away from
+// zero), clamped to the valid range. Written as clamp + truncating convert so
+// it stays a vector instruction sequence without SSE4.1 rounding.
+inline std::int32_t fixed_quantize(float x, float inv_quantum) {
+  float q = x * inv_quantum;
+  q = q > float(FIXED_MAX_QUANTA) ? float(FIXED_MAX_QUANTA) : q;
+  q = q < -float(FIXED_MAX_QUANTA) ? -float(FIXED_MAX_QUANTA) : q;
+  q += (q < 0.0f) ? -0.5f : 0.5f;
+  return std::int32_t(q);
+}
+
+// One update of a Q.8 mean / Q.8 variance pair with a quantized sample;
+// returns the sample's deviation from the updated mean in Q.8 (|dev| < 2^31).
+// The variance saturates at INT32_MAX so both fields convert to float
+// through signed 32-bit lanes, which every SIMD level supports.
+inline std::int32_t fixed_ewma_step(std::int32_t xq, std::int32_t& mean, std::uint32_t& var,
+                                    std::int64_t alpha_q) {
+  std::int64_t x = std::int64_t(xq) * (1 << FIXED_MEAN_FRAC);
+  std::int64_t delta = x - mean;
+  std::int64_t m = mean + fixed_mul_alpha_wide(delta, alpha_q);
+  // delta^2 in Q.16 quantum^2 -> Q.8
+  std::int64_t d2 = (delta * delta) >> (2 * FIXED_MEAN_FRAC - FIXED_VAR_FRAC);
+  std::int64_t v = std::int64_t(var) + fixed_mul_alpha_wide(d2 - std::int64_t(var), alpha_q);
+  v = v > std::int64_t(INT32_MAX) ? std::int64_t(INT32_MAX) : v;
+  v = v < 0 ? 0 : v;
+  mean = std::int32_t(m);
+  var = std::uint32_t(v);
+  return std::int32_t(x - m);
+}
+
+// z-score from a Q.8 deviation and Q.8 variance
+inline float fixed_z_score(std::int32_t dev, std::uint32_t var) {
+  float v = float(std::int32_t(var)) * (1.0f / float(1 << FIXED_VAR_FRAC));
+  float z = float(dev) * (1.0f / float(1 << FIXED_MEAN_FRAC)) / std::sqrt(v + EPSILON);
+  return (v < EPSILON) ? 0.0f : z;
+}
+
+// Scalar fixed-point counterpart of EWMA for one stream
+struct FixedEWMA {
+  std::int32_t mean{0};    // Q.8 quanta
+  std::uint32_t var{0};    // Q.8 quanta^2
+  bool initialized{false};
+  float inv_quantum{1.0f};
+  std::int64_t alpha_q{fixed_alpha(EWMA_ALPHA)};
+
+  explicit FixedEWMA(float quantum = 1.0f) : inv_quantum(1.0f / quantum) {}
+
+  // Update with new sample; returns its z-score against the updated baseline
+  float update(float x) {
+    std::int32_t xq = fixed_quantize(x, inv_quantum);
+    if (!initialized) {
+      mean = xq * (1 << FIXED_MEAN_FRAC);
+      var  = 0;
+      initialized = true;
+      return 0.0f;
+    }
+    return fixed_z_score(fixed_ewma_step(xq, mean, var, alpha_q), var);
+  }
+};
+
+// EWMA over the per-sample increase of a 64-bit counter (uptime, byte and
+// tick counters). The reading itself is never rounded; increases are taken
+// modulo 2^64 so a wrapped counter still yields the right delta. Mean and
+// variance of the increase are kept in 64-bit Q.8; deviations beyond 2^27
+// units saturate the variance.
+struct CounterEWMA {
+  std::uint64_t prev{0};
+  std::int64_t mean{0};    // Q.8
+  std::uint64_t var{0};    // Q.8
+  unsigned samples{0};
+  std::int64_t alpha_q{fixed_alpha(EWMA_ALPHA)};
+
+  // Update with the counter's current reading; returns the z-score of the
+  // increase since the previous reading
+  float update(std::uint64_t reading) {
+    std::uint64_t inc = reading - prev;
+    prev = reading;
+    if (samples < 2) {
+      // First reading has no increase; the first increase seeds the mean
+      if (samples == 1) mean = std::int64_t(inc << FIXED_MEAN_FRAC);
+      ++samples;
+      return 0.0f;
+    }
+    std::int64_t x = std::int64_t(inc << FIXED_MEAN_FRAC);
+    std::int64_t delta = x - mean;
+    mean += fixed_mul_alpha_wide(delta, alpha_q);
+
+    constexpr std::int64_t DQ_MAX = std::int64_t(1) << 27;
+    std::int64_t dq = delta >> FIXED_MEAN_FRAC;
+    dq = dq > DQ_MAX ? DQ_MAX : (dq < -DQ_MAX ? -DQ_MAX : dq);
+    std::int64_t ad = delta < 0 ? -delta : delta;
+    std::int64_t d2 = (ad < (std::int64_t(1) << 31))
+      ? (delta * delta) >> (2 * FIXED_MEAN_FRAC - FIXED_VAR_FRAC)
+      : (dq * dq) << FIXED_VAR_FRAC;
+    std::int64_t v = std::int64_t(var) + fixed_mul_alpha_wide(d2 - std::int64_t(var), alpha_q);
+    var = v < 0 ? 0 : std::uint64_t(v);
+
+    float vf = float(var) * (1.0f / float(1 << FIXED_VAR_FRAC));
+    float z = float(x - mean) * (1.0f / float(1 << FIXED_MEAN_FRAC)) / std::sqrt(vf + EPSILON);
+    return (vf < EPSILON) ? 0.0f : z;
+  }
+};
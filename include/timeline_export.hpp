@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// One anomaly as written by the exporter (also the binary record layout)
+struct TimelineRecord {
+  std::int64_t unix_ms;
+  std::uint32_t metric_index;
+  float value;
+  float z_score;
+  std::uint32_t incident;        // IncidentCorrelator id, 0 for none
+};
+static_assert(sizeof(TimelineRecord) == 24, "binary export record layout");
+
+enum class ExportFormat { CSV, JSONL, BINARY };
+
+// Format from the file extension: .jsonl/.json, .bin/.anom, anything else CSV
+ExportFormat export_format_for(const std::string& filename);
+
+// Binary files: this header, then `count` TimelineRecords in host byte order
+struct TimelineFileHeader {
+  char magic[8];                 // "ANOMTL1\0"
+  std::uint32_t record_size;     // sizeof(TimelineRecord)
+  std::uint32_t flags;           // 0
+  std::uint64_t count;
+};
+static_assert(sizeof(TimelineFileHeader) == 24, "binary export header layout");
+
+// Streams a timeline to disk on a background thread. Records are pulled
+// from the caller in small chunks and encoded straight into a 1 MiB
+// block buffer that is written whole, so memory stays constant however long
+// the timeline is. On Linux full blocks go out with O_DIRECT where the
+// filesystem supports it, keeping a large export out of the page cache.
+// The file is written as `filename`.tmp and renamed into place on success.
+// JSONL writes a NaN or infinite value or z-score as null.
+class TimelineExporter {
+public:
+  // Copy up to `max` records starting at `offset` into `out`; return how many
+  using Source = std::function<std::size_t(std::size_t offset, TimelineRecord* out, std::size_t max)>;
+  // Display name for a metric index
+  using NameFn = std::function<std::string(std::uint32_t metric_index)>;
+
+  enum class State { IDLE, RUNNING, DONE, FAILED };
+
+  TimelineExporter() = default;
+  ~TimelineExporter();
+  TimelineExporter(const TimelineExporter&) = delete;
+  TimelineExporter& operator=(const TimelineExporter&) = delete;
+
+  // Start exporting `count` records; false if an export is already running
+  bool start(const std::string& filename, ExportFormat format, std::size_t count,
+             Source source, NameFn name);
+
+  // Stop a running export (the partial file is removed) and wait for it
+  void cancel();
+
+  State state() const { return state_.load(std::memory_order_acquire); }
+  std::size_t written() const { return written_.load(std::memory_order_relaxed); }
+  std::size_t total() const { return total_; }
+  std::uint64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+  const std::string& filename() const { return filename_; }
+  // Valid once state() is FAILED
+  std::string error() const;
+
+private:
+  void run(ExportFormat format, Source source, NameFn name);
+  void fail(const std::string& message);
+
+  std::thread thread_;
+  std::atomic<State> state_{State::IDLE};
+  std::atomic<bool> cancel_{false};
+  std::atomic<std::size_t> written_{0};
+  std::atomic<std::uint64_t> bytes_{0};
+  std::size_t total_{0};
+  std::string filename_;
+  mutable std::mutex error_mutex_;
+  std::string error_;
+};
@@ -0,0 +1,316 @@
+#include "anomaly_journal.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::size_t PAGE_BYTES = 4096;
+
+std::size_t round_up(std::size_t n, std::size_t to) {
+    return (n + to - 1) / to * to;
+}
+
+std::size_t index_entries() {
+    return (JOURNAL_SEGMENT_RECORDS + JOURNAL_INDEX_STRIDE - 1) / JOURNAL_INDEX_STRIDE;
+}
+
+// Header page, index pages, record pages
+std::size_t index_offset() { return PAGE_BYTES; }
+std::size_t records_offset() {
+    return index_offset() + round_up(index_entries() * sizeof(JournalIndexEntry), PAGE_BYTES);
+}
+std::size_t segment_bytes() {
+    return records_offset() + round_up(JOURNAL_SEGMENT_RECORDS * sizeof(TimelineRecord), PAGE_BYTES);
+}
+
+// "journal-000042.seg" -> 42, anything else -> 0
+std::uint64_t parse_segment_name(const char* name) {
+    static const char prefix[] = "journal-";
+    static const char suffix[] = ".seg";
+    std::size_t len = std::strlen(name);
+    if (len <= sizeof(prefix) - 1 + sizeof(suffix) - 1) return 0;
+    if (std::strncmp(name, prefix, sizeof(prefix) - 1) != 0) return 0;
+    if (std::strcmp(name + len - (sizeof(suffix) - 1), suffix) != 0) return 0;
+    std::uint64_t number = 0;
+    for (const char* c = name + sizeof(prefix) - 1; c < name + len - (sizeof(suffix) - 1); ++c) {
+        if (*c < '0' || *c > '9') return 0;
+        number = number * 10 + static_cast<std::uint64_t>(*c - '0');
+    }
+    return number;
+}
+
+} // namespace
+
+AnomalyJournal::~AnomalyJournal() {
+    close();
+}
+
+std::string AnomalyJournal::segment_path(std::uint64_t number) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "journal-%06llu.seg", static_cast<unsigned long long>(number));
+    return dir_ + "/" + name;
+}
+
+bool AnomalyJournal::open(const std::string& dir, std::string& error) {
+    close();
+    if (dir.empty()) return true;
+
+#ifdef _WIN32
+    error = "persistent journal is not supported on this platform";
+    return false;
+#else
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        error = dir + ": " + std::strerror(errno);
+        return false;
+    }
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        error = dir + ": " + std::strerror(errno);
+        return false;
+    }
+    std::vector<std::uint64_t> numbers;
+    while (dirent* entry = readdir(d)) {
+        std::uint64_t number = parse_segment_name(entry->d_name);
+        if (number != 0) numbers.push_back(number);
+    }
+    closedir(d);
+    std::sort(numbers.begin(), numbers.end());
+
+    dir_ = dir;
+    for (std::uint64_t number : numbers) {
+        Segment seg;
+        if (!map_segment(number, false, seg, error)) {
+            close();
+            return false;
+        }
+        seg.first_seq = size_;
+        segments_.push_back(seg);
+        size_ += seg.header->count;
+        next_number_ = number + 1;
+    }
+    while (segments_.size() > JOURNAL_MAX_SEGMENTS) {
+        size_ -= segments_.front().header->count;
+        first_seq_ += segments_.front().header->count;
+        unmap_segment(segments_.front());
+        std::remove(segment_path(segments_.front().number).c_str());
+        segments_.erase(segments_.begin());
+    }
+    return true;
+#endif
+}
+
+void AnomalyJournal::close() {
+    for (Segment& seg : segments_) unmap_segment(seg);
+    for (Segment& seg : retired_) unmap_segment(seg);
+    segments_.clear();
+    retired_.clear();
+    size_ = 0;
+    first_seq_ = 0;
+    dir_.clear();
+    next_number_ = 1;
+}
+
+bool AnomalyJournal::map_segment(std::uint64_t number, bool create, Segment& out, std::string& error) {
+    const std::size_t bytes = segment_bytes();
+    void* base = nullptr;
+
+    if (dir_.empty()) {
+        base = std::calloc(1, bytes);
+        if (!base) {
+            error = "out of memory";
+            return false;
+        }
+    } else {
+#ifndef _WIN32
+        std::string path = segment_path(number);
+        int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0644);
+        if (fd < 0) {
+            error = path + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat st{};
+        bool ok = fstat(fd, &st) == 0;
+        if (ok && create) {
+            // Reserve the blocks now so appends never hit ENOSPC through a page fault
+#ifdef __linux__
+            ok = posix_fallocate(fd, 0, static_cast<off_t>(bytes)) == 0 ||
+                 ftruncate(fd, static_cast<off_t>(bytes)) == 0;
+#else
+            ok = ftruncate(fd, static_cast<off_t>(bytes)) == 0;
+#endif
+        } else if (ok && static_cast<std::size_t>(st.st_size) != bytes) {
+            ::close(fd);
+            error = path + ": unexpected segment size";
+            return false;
+        }
+        if (ok) {
+            base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ok = base != MAP_FAILED;
+        }
+        if (!ok) {
+            error = path + ": " + std::strerror(errno);
+            ::close(fd);
+            if (create) std::remove(path.c_str());
+            return false;
+        }
+        ::close(fd);
+#endif
+    }
+
+    char* p = static_cast<char*>(base);
+    out.base = base;
+    out.bytes = bytes;
+    out.number = number;
+    out.header = reinterpret_cast<JournalSegmentHeader*>(p);
+    out.index = reinterpret_cast<JournalIndexEntry*>(p + index_offset());
+    out.records = reinterpret_cast<TimelineRecord*>(p + records_offset());
+
+    JournalSegmentHeader& h = *out.header;
+    if (create || dir_.empty()) {
+        std::memcpy(h.magic, "ANOMJRN1", 8);
+        h.record_size = sizeof(TimelineRecord);
+        h.index_stride = JOURNAL_INDEX_STRIDE;
+        h.capacity = JOURNAL_SEGMENT_RECORDS;
+        h.count = 0;
+        h.first_ms = 0;
+        h.last_ms = 0;
+    } else if (std::memcmp(h.magic, "ANOMJRN1", 8) != 0 ||
+               h.record_size != sizeof(TimelineRecord) ||
+               h.index_stride != JOURNAL_INDEX_STRIDE ||
+               h.capacity != JOURNAL_SEGMENT_RECORDS || h.count > h.capacity) {
+        error = segment_path(number) + ": not a journal segment of this version";
+        unmap_segment(out);
+        return false;
+    }
+    return true;
+}
+
+void AnomalyJournal::unmap_segment(Segment& seg) {
+    if (!seg.base) return;
+#ifndef _WIN32
+    if (!dir_.empty()) {
+        munmap(seg.base, seg.bytes);
+    } else {
+        std::free(seg.base);
+    }
+#else
+    std::free(seg.base);
+#endif
+    seg.base = nullptr;
+    seg.header = nullptr;
+}
+
+bool AnomalyJournal::add_segment(std::string& error) {
+    if (segments_.size() >= JOURNAL_MAX_SEGMENTS) {
+        Segment& oldest = segments_.front();
+        size_ -= oldest.header->count;
+        first_seq_ += oldest.header->count;
+        // An unlinked file stays readable through its mapping
+        if (!dir_.empty()) std::remove(segment_path(oldest.number).c_str());
+        if (pins_ != 0) {
+            retired_.push_back(oldest);
+        } else {
+            unmap_segment(oldest);
+        }
+        segments_.erase(segments_.begin());
+    }
+    Segment seg;
+    if (!map_segment(next_number_, true, seg, error)) return false;
+    seg.first_seq = first_seq_ + size_;
+    ++next_number_;
+    segments_.push_back(seg);
+    return true;
+}
+
+bool AnomalyJournal::append(std::int64_t unix_ms, std::uint32_t metric_index,
+                            float value, float z_score, std::uint32_t incident) {
+    // Each segment stays in time order for its index. A small step back
+    // (NTP slewing, a leap second) is recorded at the segment's latest
+    // time; a larger one starts a new segment so records keep their real
+    // time, without every step pushing a fresh segment through eviction
+    const JournalSegmentHeader* cur = segments_.empty() ? nullptr : segments_.back().header;
+    if (cur && cur->count != 0 && unix_ms < cur->last_ms &&
+        cur->last_ms - unix_ms <= std::int64_t(JOURNAL_CLOCK_STEP_MS)) {
+        unix_ms = cur->last_ms;
+    }
+    if (!cur || cur->count == cur->capacity || (cur->count != 0 && unix_ms < cur->last_ms)) {
+        std::string error;
+        if (!add_segment(error)) return false;
+    }
+
+    Segment& seg = segments_.back();
+    JournalSegmentHeader& h = *seg.header;
+    const std::uint64_t n = h.count;
+    seg.records[n] = TimelineRecord{unix_ms, metric_index, value, z_score, incident};
+
+    JournalIndexEntry& entry = seg.index[n / JOURNAL_INDEX_STRIDE];
+    if (n % JOURNAL_INDEX_STRIDE == 0) {
+        entry.first_ms = unix_ms;
+        entry.metric_mask = 0;
+    }
+    entry.metric_mask |= metric_bit(metric_index);
+    if (n == 0) h.first_ms = unix_ms;
+    h.last_ms = unix_ms;
+    h.count = n + 1;   // commits the record
+    ++size_;
+    return true;
+}
+
+const TimelineRecord& AnomalyJournal::at(std::size_t i) const {
+    // Most lookups are recent events, so walk from the newest segment
+    std::size_t end = size_;
+    for (std::size_t s = segments_.size(); s-- > 0;) {
+        std::size_t count = segments_[s].header->count;
+        if (i >= end - count) return segments_[s].records[i - (end - count)];
+        end -= count;
+    }
+    return segments_.front().records[0];   // out of range
+}
+
+void AnomalyJournal::clear() {
+    for (Segment& seg : segments_) {
+        unmap_segment(seg);
+        if (!dir_.empty()) std::remove(segment_path(seg.number).c_str());
+    }
+    for (Segment& seg : retired_) unmap_segment(seg);
+    segments_.clear();
+    retired_.clear();
+    first_seq_ += size_;
+    size_ = 0;
+}
+
+void AnomalyJournal::unpin() {
+    if (pins_ == 0 || --pins_ != 0) return;
+    for (Segment& seg : retired_) unmap_segment(seg);
+    retired_.clear();
+}
+
+std::size_t AnomalyJournal::read(std::uint64_t seq, TimelineRecord* out, std::size_t max) const {
+    std::size_t n = 0;
+    auto copy = [&](const std::vector<Segment>& list) {
+        for (const Segment& seg : list) {
+            std::uint64_t count = seg.header->count;
+            if (n == max || seq < seg.first_seq) return;
+            if (seq >= seg.first_seq + count) continue;
+            std::size_t from = static_cast<std::size_t>(seq - seg.first_seq);
+            std::size_t k = std::min<std::size_t>(max - n, count - from);
+            std::memcpy(out + n, seg.records + from, k * sizeof(TimelineRecord));
+            n += k;
+            seq += k;
+        }
+    };
+    copy(retired_);
+    copy(segments_);
+    return n;
+}
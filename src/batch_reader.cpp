@@ -0,0 +1,399 @@
+#include "batch_reader.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <atomic>
+#define HAVE_IO_URING 1
+#endif
+
+namespace {
+
+constexpr std::uint32_t MIN_BUFFER = 256;
+
+// Smallest power-of-two class (MIN_BUFFER << class) holding `bytes`
+std::uint32_t size_class_of(std::size_t bytes) {
+    std::uint32_t c = 0;
+    while ((std::size_t(MIN_BUFFER) << c) < bytes) ++c;
+    return c;
+}
+
+double elapsed_us(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - since).count();
+}
+
+#ifdef HAVE_IO_URING
+int uring_setup(unsigned entries, io_uring_params* p) {
+    return int(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int uring_enter(int fd, unsigned submit, unsigned wait, unsigned flags) {
+    return int(syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0));
+}
+
+int uring_register(int fd, unsigned op, const void* arg, unsigned n) {
+    return int(syscall(__NR_io_uring_register, fd, op, arg, n));
+}
+
+template <typename T>
+T* at(void* base, std::uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+#endif
+
+}  // namespace
+
+#ifdef HAVE_IO_URING
+struct BatchReader::Ring {
+    int fd{-1};
+    io_uring_params params;
+    void* sq_ring{nullptr};
+    std::size_t sq_ring_bytes{0};
+    void* cq_ring{nullptr};
+    std::size_t cq_ring_bytes{0};
+    io_uring_sqe* sqes{nullptr};
+    std::size_t sqes_bytes{0};
+    std::size_t file_table{0};          // registered fixed-file table size
+    bool buffers_registered{false};
+    bool buffers_dirty{false};
+    bool fixed_buffers{true};           // false once registration has failed
+};
+#else
+struct BatchReader::Ring {};
+#endif
+
+BatchReader::BatchReader(Engine engine)
+    : engine_(engine), active_(engine) {
+    free_buffers_.resize(size_class_of(BATCH_READ_BLOCK_BYTES) + 1);
+    if (engine_ != Engine::PREAD && !uring_open()) active_ = Engine::PREAD;
+}
+
+BatchReader::~BatchReader() {
+    uring_close();
+    for (char* b : blocks_) std::free(b);
+}
+
+const char* BatchReader::engine_name() const {
+    if (engine_ == Engine::AUTO && (calib_batches_[0] < BATCH_READ_CALIBRATE ||
+                                    calib_batches_[1] < BATCH_READ_CALIBRATE) && ring_) {
+        return "auto";
+    }
+    return active_ == Engine::URING ? "io_uring" : "pread";
+}
+
+bool BatchReader::take_buffer(std::uint32_t size_class, SlotInfo& s) {
+    std::vector<std::uint64_t>& free = free_buffers_[size_class];
+    if (!free.empty()) {
+        s.block = std::uint32_t(free.back() >> 32);
+        s.offset = std::uint32_t(free.back());
+        free.pop_back();
+        return true;
+    }
+    const std::uint32_t bytes = MIN_BUFFER << size_class;
+    if (bytes > BATCH_READ_BLOCK_BYTES) return false;
+    if (block_used_ + bytes > BATCH_READ_BLOCK_BYTES) {
+        // Page aligned, as fixed buffers are pinned by page
+        char* block = static_cast<char*>(std::aligned_alloc(4096, BATCH_READ_BLOCK_BYTES));
+        if (!block) return false;
+        blocks_.push_back(block);
+        block_used_ = 0;
+#ifdef HAVE_IO_URING
+        if (ring_) ring_->buffers_dirty = true;
+#endif
+    }
+    s.block = std::uint32_t(blocks_.size() - 1);
+    s.offset = block_used_;
+    block_used_ += bytes;
+    return true;
+}
+
+BatchReader::Slot BatchReader::attach(int fd, std::size_t bytes) {
+    if (fd < 0) return NONE;
+    SlotInfo s;
+    s.size_class = size_class_of(bytes);
+    if (s.size_class >= free_buffers_.size() || !take_buffer(s.size_class, s)) return NONE;
+    s.fd = fd;
+    s.live = true;
+
+    Slot id;
+    if (!free_slots_.empty()) {
+        id = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        id = Slot(slots_.size());
+        slots_.emplace_back();
+    }
+#ifdef HAVE_IO_URING
+    // Into the fixed-file table at the slot's own index
+    if (ring_ && id < ring_->file_table) {
+        io_uring_files_update up;
+        std::memset(&up, 0, sizeof(up));
+        std::int32_t f = fd;
+        up.offset = id;
+        up.fds = reinterpret_cast<std::uint64_t>(&f);
+        s.fixed_file = uring_register(ring_->fd, IORING_REGISTER_FILES_UPDATE, &up, 1) == 1;
+        ++syscalls_;
+    }
+#endif
+    buffer(s)[0] = '\0';
+    slots_[id] = s;
+    return id;
+}
+
+void BatchReader::detach(Slot slot) {
+    if (slot >= slots_.size() || !slots_[slot].live) return;
+    SlotInfo& s = slots_[slot];
+#ifdef HAVE_IO_URING
+    if (s.fixed_file) {
+        io_uring_files_update up;
+        std::memset(&up, 0, sizeof(up));
+        std::int32_t f = -1;
+        up.offset = slot;
+        up.fds = reinterpret_cast<std::uint64_t>(&f);
+        uring_register(ring_->fd, IORING_REGISTER_FILES_UPDATE, &up, 1);
+        ++syscalls_;
+    }
+#endif
+    free_buffers_[s.size_class].push_back(std::uint64_t(s.block) << 32 | s.offset);
+    s = SlotInfo();
+    free_slots_.push_back(slot);
+}
+
+void BatchReader::queue(Slot slot) {
+    if (slot < slots_.size() && slots_[slot].live) queue_.push_back(slot);
+}
+
+void BatchReader::submit() {
+    if (queue_.empty()) return;
+    ++batches_;
+    reads_ += queue_.size();
+
+    // AUTO: alternate engines until both have BATCH_READ_CALIBRATE batches
+    // timed, then keep the faster per read
+    Engine use = active_;
+    bool timing = false;
+    if (engine_ == Engine::AUTO && ring_) {
+        unsigned done_uring = calib_batches_[0], done_pread = calib_batches_[1];
+        if (done_uring < BATCH_READ_CALIBRATE || done_pread < BATCH_READ_CALIBRATE) {
+            use = done_uring <= done_pread ? Engine::URING : Engine::PREAD;
+            timing = true;
+        }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (use == Engine::URING && !submit_uring()) {
+        // The ring failed us (e.g. resources): pread from here on
+        uring_close();
+        active_ = use = Engine::PREAD;
+        timing = false;
+    }
+    if (use == Engine::PREAD) submit_pread();
+
+    if (timing) {
+        int k = use == Engine::URING ? 0 : 1;
+        calib_us_[k] += elapsed_us(t0);
+        calib_reads_[k] += queue_.size();
+        if (++calib_batches_[k] == BATCH_READ_CALIBRATE && calib_batches_[1 - k] >= BATCH_READ_CALIBRATE) {
+            double uring = calib_us_[0] / double(calib_reads_[0]);
+            double pread = calib_us_[1] / double(calib_reads_[1]);
+            active_ = uring < pread ? Engine::URING : Engine::PREAD;
+        }
+    }
+    queue_.clear();
+}
+
+void BatchReader::submit_pread() {
+#ifndef _WIN32
+    for (Slot id : queue_) {
+        SlotInfo& s = slots_[id];
+        char* buf = buffer(s);
+        ssize_t n = pread(s.fd, buf, (std::size_t(MIN_BUFFER) << s.size_class) - 1, 0);
+        s.result = n < 0 ? -long(errno) : long(n);
+        buf[n > 0 ? n : 0] = '\0';
+    }
+    syscalls_ += queue_.size();
+#endif
+}
+
+#ifdef HAVE_IO_URING
+
+bool BatchReader::uring_open() {
+    Ring* r = new Ring();
+    ring_ = r;
+    io_uring_params& p = r->params;
+    std::memset(&p, 0, sizeof(p));
+    r->fd = uring_setup(BATCH_READ_RING_ENTRIES, &p);
+    if (r->fd < 0) {
+        uring_close();
+        return false;
+    }
+
+    r->sq_ring_bytes = p.sq_off.array + p.sq_entries * sizeof(std::uint32_t);
+    r->cq_ring_bytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && r->cq_ring_bytes > r->sq_ring_bytes) r->sq_ring_bytes = r->cq_ring_bytes;
+    void* sq = mmap(nullptr, r->sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    r->fd, IORING_OFF_SQ_RING);
+    void* cq = single ? sq : mmap(nullptr, r->cq_ring_bytes, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    r->sqes_bytes = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, r->sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      r->fd, IORING_OFF_SQES);
+    r->sq_ring = sq == MAP_FAILED ? nullptr : sq;
+    r->cq_ring = cq == MAP_FAILED ? nullptr : cq;
+    r->sqes = sqes == MAP_FAILED ? nullptr : static_cast<io_uring_sqe*>(sqes);
+    if (!r->sq_ring || !r->cq_ring || !r->sqes) {
+        uring_close();
+        return false;
+    }
+
+    // Sparse fixed-file table, filled in as files are attached; the kernel
+    // caps it at RLIMIT_NOFILE
+#ifdef IORING_RSRC_REGISTER_SPARSE
+    std::size_t table = BATCH_READ_MAX_FILES;
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < table) {
+        table = std::size_t(rl.rlim_cur);
+    }
+    io_uring_rsrc_register reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.nr = unsigned(table);
+    reg.flags = IORING_RSRC_REGISTER_SPARSE;
+    if (uring_register(r->fd, IORING_REGISTER_FILES2, &reg, sizeof(reg)) == 0) r->file_table = table;
+#endif
+    return true;
+}
+
+void BatchReader::uring_close() {
+    Ring* r = ring_;
+    if (!r) return;
+    if (r->sqes) munmap(r->sqes, r->sqes_bytes);
+    if (r->cq_ring && r->cq_ring != r->sq_ring) munmap(r->cq_ring, r->cq_ring_bytes);
+    if (r->sq_ring) munmap(r->sq_ring, r->sq_ring_bytes);
+    if (r->fd >= 0) close(r->fd);
+    delete r;
+    ring_ = nullptr;
+    for (SlotInfo& s : slots_) s.fixed_file = false;
+}
+
+// All arena blocks as fixed buffers (re-registered when the arena grew);
+// false if they cannot be, e.g. over RLIMIT_MEMLOCK
+bool BatchReader::register_buffers() {
+    Ring* r = ring_;
+    if (!r->fixed_buffers || blocks_.empty()) return false;
+    if (!r->buffers_dirty && r->buffers_registered) return true;
+    if (r->buffers_registered) {
+        uring_register(r->fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        ++syscalls_;
+        r->buffers_registered = false;
+    }
+    std::vector<iovec> iov(blocks_.size());
+    for (std::size_t b = 0; b < blocks_.size(); ++b) {
+        iov[b].iov_base = blocks_[b];
+        iov[b].iov_len = BATCH_READ_BLOCK_BYTES;
+    }
+    ++syscalls_;
+    r->buffers_dirty = false;
+    if (uring_register(r->fd, IORING_REGISTER_BUFFERS, iov.data(), unsigned(iov.size())) != 0) {
+        r->fixed_buffers = false;
+        return false;
+    }
+    r->buffers_registered = true;
+    return true;
+}
+
+bool BatchReader::submit_uring() {
+    Ring* r = ring_;
+    const io_uring_params& p = r->params;
+    const bool fixed_bufs = register_buffers();
+    auto* sq_head = at<std::atomic<std::uint32_t>>(r->sq_ring, p.sq_off.head);
+    auto* sq_tail = at<std::atomic<std::uint32_t>>(r->sq_ring, p.sq_off.tail);
+    const std::uint32_t sq_mask = *at<std::uint32_t>(r->sq_ring, p.sq_off.ring_mask);
+    std::uint32_t* sq_array = at<std::uint32_t>(r->sq_ring, p.sq_off.array);
+    auto* cq_head = at<std::atomic<std::uint32_t>>(r->cq_ring, p.cq_off.head);
+    auto* cq_tail = at<std::atomic<std::uint32_t>>(r->cq_ring, p.cq_off.tail);
+    const std::uint32_t cq_mask = *at<std::uint32_t>(r->cq_ring, p.cq_off.ring_mask);
+    io_uring_cqe* cqes = at<io_uring_cqe>(r->cq_ring, p.cq_off.cqes);
+    io_uring_sqe* sqes = r->sqes;
+
+    for (std::size_t done = 0; done < queue_.size(); ) {
+        const unsigned k = unsigned(std::min<std::size_t>(p.sq_entries, queue_.size() - done));
+        std::uint32_t tail = sq_tail->load(std::memory_order_relaxed);
+        for (unsigned j = 0; j < k; ++j) {
+            const Slot id = queue_[done + j];
+            const SlotInfo& s = slots_[id];
+            const std::uint32_t idx = (tail + j) & sq_mask;
+            io_uring_sqe& e = sqes[idx];
+            std::memset(&e, 0, sizeof(e));
+            e.opcode = fixed_bufs ? IORING_OP_READ_FIXED : IORING_OP_READ;
+            e.fd = s.fixed_file ? int(id) : s.fd;
+            e.flags = s.fixed_file ? IOSQE_FIXED_FILE : 0;
+            e.addr = reinterpret_cast<std::uint64_t>(buffer(s));
+            e.len = (MIN_BUFFER << s.size_class) - 1;
+            e.off = 0;
+            e.buf_index = fixed_bufs ? std::uint16_t(s.block) : 0;
+            e.user_data = id;
+            sq_array[idx] = idx;
+        }
+        sq_tail->store(tail + k, std::memory_order_release);
+
+        // Submit the chunk and wait for all of it in the same call
+        unsigned submitted = 0, completed = 0;
+        auto reap = [&]() {
+            std::uint32_t head = cq_head->load(std::memory_order_relaxed);
+            const std::uint32_t ctail = cq_tail->load(std::memory_order_acquire);
+            for (; head != ctail; ++head, ++completed) {
+                const io_uring_cqe& c = cqes[head & cq_mask];
+                SlotInfo& s = slots_[Slot(c.user_data)];
+                s.result = c.res;
+                buffer(s)[c.res > 0 ? c.res : 0] = '\0';
+            }
+            cq_head->store(head, std::memory_order_release);
+        };
+        while (completed < k) {
+            int n = uring_enter(r->fd, k - submitted, k - completed, IORING_ENTER_GETEVENTS);
+            ++syscalls_;
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                // Take back what the kernel has not consumed, so the next
+                // batch does not submit it again, and wait out what it has:
+                // those reads would land in buffers the pread fallback and
+                // later batches reuse. Only a ring that cannot even be
+                // waited on any more is given up with reads in flight.
+                sq_tail->store(sq_head->load(std::memory_order_acquire), std::memory_order_release);
+                while (completed < submitted) {
+                    n = uring_enter(r->fd, 0, submitted - completed, IORING_ENTER_GETEVENTS);
+                    ++syscalls_;
+                    if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) break;
+                    reap();
+                }
+                return false;
+            }
+            submitted += unsigned(n);
+            reap();
+        }
+        done += k;
+    }
+    return true;
+}
+
+#else
+
+bool BatchReader::uring_open() { return false; }
+void BatchReader::uring_close() {}
+bool BatchReader::register_buffers() { return false; }
+bool BatchReader::submit_uring() { return false; }
+
+#endif
@@ -1,4 +1,5 @@
 #include "cli_monitor.hpp"
+#include "collector.hpp"
 #include <iostream>
 #include <iomanip>
 #include <sstream>
@@ -7,6 +8,9 @@
 #include <thread>
 #include <chrono>
 
+// Streams registered by collectors, for names past the host metrics
+static const StreamTable* g_streams = nullptr;
+
 // Get metric name for display
 std::string AnomalyEvent::get_metric_name(std::size_t idx) {
     static const std::string names[] = {
@@ -16,7 +20,19 @@ std::string AnomalyEvent::get_metric_name(std::size_t idx) {
         "Heap Free",
         "Uptime"
     };
-    return (idx < N_METRICS) ? names[idx] : "Unknown";
+    if (idx < N_METRICS) return names[idx];
+    if (g_streams && g_streams->live(std::uint32_t(idx))) return g_streams->name(std::uint32_t(idx));
+    return "Stream " + std::to_string(idx);
+}
+
+void CLIMonitor::set_streams(const StreamTable* streams) {
+    g_streams = streams;
+}
+
+// Current config snapshot, or the compiled-in defaults
+const RuntimeConfig& CLIMonitor::config() const {
+    static const RuntimeConfig defaults;
+    return config_ ? *config_->current() : defaults;
 }
 
 // Setup display - clear screen and draw initial layout
@@ -61,7 +77,7 @@ void CLIMonitor::draw_metrics_panel(const float vals[N_METRICS],
                                    bool warming_up) {
     std::cout << BOLD << BLUE << "┌─ METRICS PANEL " << RESET;
     if (warming_up) {
-        std::cout << YELLOW << " [WARMING UP: " << sample_count << "/" << WARMUP_SAMPLES << "]" << RESET;
+        std::cout << YELLOW << " [WARMING UP: " << sample_count << "/" << config().warmup_samples << "]" << RESET;
     } else {
         std::cout << GREEN << " [ACTIVE MONITORING]" << RESET;
     }
@@ -115,14 +131,38 @@ void CLIMonitor::draw_status_bar() {
     std::cout << BOLD << MAGENTA << "┌─ STATUS BAR" << RESET << "\n";
     
     // Alarm status
-    if (alarm_active_) {
-        std::cout << "│ " << RED << BLINK << "🚨 ALARM ACTIVE - " << alarm_count_ << " anomalies detected" << RESET << "\n";
+    if (incidents_.active()) {
+        const Incident& incident = incidents_.current();
+        const IncidentMember& peak = incident.peak();
+        std::cout << "│ " << RED << BLINK << "🚨 INCIDENT #" << incident.id << " ACTIVE - " << incident.members.size()
+                  << (incident.members.size() == 1 ? " stream" : " streams") << ", peak z=" << std::fixed
+                  << std::setprecision(2) << peak.peak_z << " (" << AnomalyEvent::get_metric_name(peak.stream) << ")"
+                  << RESET << CLEAR_LINE << "\n";
+    } else if (alarm_active_) {
+        std::cout << "│ " << RED << BLINK << "🚨 ALARM ACTIVE - " << alarm_count_ << " incidents" << RESET << "\n";
     } else {
         std::cout << "│ " << GREEN << "✅ System Normal - No anomalies detected" << RESET << "\n";
     }
     
     // Timeline info
-    std::cout << "│ " << CYAN << "📊 Anomaly Timeline: " << anomaly_timeline_.size() << " events recorded" << RESET << "\n";
+    std::cout << "│ " << CYAN << "📊 Anomaly Timeline: " << journal_.size() << " events recorded" << RESET << "\n";
+    if (sample_interval_ms_) {
+        std::cout << "│ " << CYAN << "⏱  Adaptive sampling: every " << sample_interval_ms_ << " ms" << RESET << CLEAR_LINE << "\n";
+    }
+    if (realtime_) {
+        const RealtimeSampler::Status& st = realtime_->status();
+        std::cout << "│ " << CYAN << "⚡ Real-time sampler:";
+        if (st.cpu >= 0) std::cout << " CPU " << st.cpu;
+        std::cout << (st.priority ? " SCHED_FIFO " + std::to_string(st.priority) : std::string(" SCHED_OTHER"));
+        std::cout << (st.memory_locked ? ", memory locked" : ", memory not locked");
+        if (realtime_->wakeups()) {
+            std::cout << std::fixed << std::setprecision(0) << " | wakeup latency p50 " << realtime_->latency_p50_us()
+                      << " us, p99 " << realtime_->latency_p99_us()
+                      << " us, max " << realtime_->latency_max_us() << " us";
+        }
+        std::cout << RESET << CLEAR_LINE << "\n";
+    }
+    draw_export_status();
     
     std::cout << "└─────────────────────────────────────────────────────────────────────────────\n";
 }
@@ -131,50 +171,136 @@ void CLIMonitor::draw_status_bar() {
 void CLIMonitor::draw_timeline_panel() {
     std::cout << BOLD << YELLOW << "┌─ ANOMALY TIMELINE" << RESET << "\n";
     
-    if (anomaly_timeline_.empty()) {
+    if (journal_.empty()) {
         std::cout << "│ " << GREEN << "No anomalies detected yet" << RESET << "\n";
     } else {
         // Show last 10 events (most recent first)
-        auto start = anomaly_timeline_.rbegin();
-        auto end = anomaly_timeline_.rend();
-        int count = 0;
-        
-        for (auto it = start; it != end && count < 10; ++it, ++count) {
-            std::string timestamp = format_timestamp(it->timestamp);
-            std::string status_color = get_status_color(it->z_score);
+        std::size_t total = journal_.size();
+        for (std::size_t k = 0; k < total && k < 10; ++k) {
+            const TimelineRecord& event = journal_.at(total - 1 - k);
+            std::string timestamp = format_timestamp_ms(event.unix_ms);
+            std::string status_color = get_status_color(event.z_score);
             
             std::cout << "│ " << timestamp << " ";
-            std::cout << status_color << it->metric_name << RESET;
-            std::cout << " = " << std::fixed << std::setprecision(2) << it->value;
-            std::cout << " (z=" << it->z_score << ")\n";
+            std::cout << status_color << AnomalyEvent::get_metric_name(event.metric_index) << RESET;
+            std::cout << " = " << std::fixed << std::setprecision(2) << event.value;
+            std::cout << " (z=" << event.z_score << ")";
+            if (event.incident) std::cout << " [#" << event.incident << "]";
+            std::cout << CLEAR_LINE << "\n";
         }
         
-        if (anomaly_timeline_.size() > 10) {
-            std::cout << "│ " << CYAN << "... and " << (anomaly_timeline_.size() - 10) << " more events" << RESET << "\n";
+        if (total > 10) {
+            std::cout << "│ " << CYAN << "... and " << (total - 10) << " more events" << RESET << "\n";
         }
     }
     
     std::cout << "└─────────────────────────────────────────────────────────────────────────────\n";
 }
 
-// Handle anomaly detection with alarm effects
-void CLIMonitor::handle_anomaly(std::size_t metric_idx, float value, float z_score) {
+// Open the journal and seed the running statistics from what it holds
+bool CLIMonitor::open_journal(const std::string& dir, std::string& error) {
+    bool ok = journal_.open(dir, error);
+    stats_.reset();
+    std::uint32_t last_incident = 0;
+    journal_.for_each([&](const TimelineRecord& rec) {
+        stats_.add(rec.unix_ms, rec.metric_index, rec.z_score);
+        last_incident = std::max(last_incident, rec.incident);
+    });
+    // Incident numbers carry on from the previous run's
+    incidents_.resume(last_incident);
+    return ok;
+}
+
+// Handle anomaly detection: alarm effects once per incident, one timeline
+// event per stream in it
+void CLIMonitor::handle_anomaly(std::size_t metric_idx, float value, float z_score, std::int64_t now_ms,
+                                std::int64_t onset_ms) {
+    expire_incidents(now_ms);
+    AnomalyEvent event(metric_idx, value, z_score);
+    if (onset_ms != INT64_MIN && onset_ms <= now_ms) event.change_age_ms = now_ms - onset_ms;
+    std::int64_t unix_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        event.timestamp.time_since_epoch()).count();
+    IncidentCorrelator::Change change =
+        incidents_.observe(now_ms, unix_ms, static_cast<std::uint32_t>(metric_idx), value, z_score);
+    // Still firing: already reported, only its peak moves
+    if (change == IncidentCorrelator::REPEAT) return;
+    
+    // Which streams moved first, while the history still holds the onset.
+    // Many streams joining in one round would stall sampling, so only the
+    // first few get them; the incident's opening is always among them.
+    if (now_ms != lead_round_ms_) {
+        lead_round_ms_ = now_ms;
+        lead_left_ = LEAD_MAX_PER_ROUND;
+    }
+    if (history_ && metric_idx < history_->size() && lead_left_ > 0) {
+        --lead_left_;
+        event.leaders = lead_lag_.leaders(*history_, metric_idx, unix_ms, LEAD_TOP);
+    }
+    
     // Add to timeline
-    anomaly_timeline_.emplace_back(metric_idx, value, z_score);
+    const std::uint32_t incident = incidents_.current().id;
+    {
+        std::lock_guard<std::mutex> lock(timeline_mutex_);
+        journal_.append(unix_ms, static_cast<std::uint32_t>(metric_idx), value, z_score, incident);
+    }
+    stats_.add(unix_ms, metric_idx, z_score);
+    
+    // Another stream in the open incident, or one firing again: one line,
+    // no alarm
+    if (change == IncidentCorrelator::JOINED) {
+        const IncidentMember* member = incidents_.member(static_cast<std::uint32_t>(metric_idx));
+        std::cout << "\n" << YELLOW << "Incident #" << incident << " + " << RESET << BOLD
+                  << AnomalyEvent::get_metric_name(metric_idx) << RESET << " = " << std::fixed << std::setprecision(2)
+                  << value << " " << get_metric_unit(metric_idx) << " (z=" << z_score << ")";
+        if (member && member->fired > 1) std::cout << ", again";
+        if (event.change_age_ms >= 0) std::cout << ", changing for " << format_duration(event.change_age_ms);
+        if (!event.leaders.empty()) std::cout << ", after " << format_leader(event.leaders.front());
+        std::cout << "\n";
+        return;
+    }
     
     // Trigger alarm effects
     trigger_alarm();
     
     // Print detailed alert
     std::cout << "\n" << RED << BLINK << "🚨 ANOMALY DETECTED! 🚨" << RESET << "\n";
+    std::cout << "Incident: #" << incident << "\n";
     std::cout << "Metric: " << BOLD << AnomalyEvent::get_metric_name(metric_idx) << RESET << "\n";
     std::cout << "Value: " << std::fixed << std::setprecision(2) << value << " " << get_metric_unit(metric_idx) << "\n";
     std::cout << "Z-Score: " << std::fixed << std::setprecision(2) << z_score << "\n";
-    std::cout << "Threshold: " << Z_THRESHOLD << "\n";
+    std::cout << "Threshold: " << get_metric_threshold(metric_idx) << " (per-metric)\n";
     std::cout << "Timestamp: " << format_timestamp(std::chrono::system_clock::now()) << "\n";
+    if (event.change_age_ms >= 0) {
+        std::cout << "Change began: "
+                  << format_timestamp(event.timestamp - std::chrono::milliseconds(event.change_age_ms))
+                  << " (" << format_duration(event.change_age_ms) << " earlier)\n";
+    }
+    if (!event.leaders.empty()) {
+        std::cout << "Moved first: ";
+        for (std::size_t k = 0; k < event.leaders.size(); ++k) {
+            std::cout << (k ? ", " : "") << format_leader(event.leaders[k]);
+        }
+        std::cout << "\n";
+    }
     std::cout << "\n";
 }
 
+// "45 s", "12 min", "3 h 20 min"
+std::string CLIMonitor::format_duration(std::int64_t ms) {
+    const std::int64_t s = ms / 1000;
+    if (s < 120) return std::to_string(s) + " s";
+    if (s < 7200) return std::to_string(s / 60) + " min";
+    return std::to_string(s / 3600) + " h " + std::to_string(s % 3600 / 60) + " min";
+}
+
+// "Disk I/O Rate 4.5 s earlier (r=0.81)"
+std::string CLIMonitor::format_leader(const LeadingIndicator& leader) {
+    std::ostringstream oss;
+    oss << AnomalyEvent::get_metric_name(leader.stream) << " " << std::fixed << std::setprecision(1)
+        << leader.lead_ms / 1000.0 << " s earlier (r=" << std::setprecision(2) << leader.r << ")";
+    return oss.str();
+}
+
 // Trigger alarm effects
 void CLIMonitor::trigger_alarm() {
     alarm_active_ = true;
@@ -200,6 +326,39 @@ void CLIMonitor::clear_alarm() {
     alarm_active_ = false;
 }
 
+void CLIMonitor::expire_incidents(std::int64_t now_ms) {
+    if (!incidents_.expire(now_ms)) return;
+    clear_alarm();
+    print_incident_summary(incidents_.last_closed());
+}
+
+// One line per member, largest peak first
+void CLIMonitor::print_incident_summary(const Incident& incident) {
+    std::vector<const IncidentMember*> members;
+    std::uint64_t samples = 0;
+    for (const IncidentMember& m : incident.members) {
+        members.push_back(&m);
+        samples += m.samples;
+    }
+    std::sort(members.begin(), members.end(), [](const IncidentMember* a, const IncidentMember* b) {
+        return std::fabs(a->peak_z) > std::fabs(b->peak_z);
+    });
+    std::cout << "\n" << GREEN << "✅ Incident #" << incident.id
+              << (incident.split ? " closed while still firing after " : " over after ")
+              << (incident.last_ms - incident.start_ms + 999) / 1000 << " s: " << members.size()
+              << (members.size() == 1 ? " stream, " : " streams, ") << samples << " anomalous samples" << RESET << "\n";
+    for (std::size_t k = 0; k < members.size() && k < 10; ++k) {
+        const IncidentMember& m = *members[k];
+        std::cout << "   " << std::left << std::setw(28) << AnomalyEvent::get_metric_name(m.stream) << std::right
+                  << " peak z=" << std::fixed << std::setprecision(2) << m.peak_z << " ("
+                  << m.peak_value << " " << get_metric_unit(m.stream) << "), +"
+                  << (m.first_ms - incident.start_ms) / 1000 << " s";
+        if (m.fired > 1) std::cout << ", fired " << m.fired << " times";
+        std::cout << "\n";
+    }
+    if (members.size() > 10) std::cout << "   ... and " << (members.size() - 10) << " more\n";
+}
+
 // Format value for display
 std::string CLIMonitor::format_value(float val, std::size_t metric_idx) {
     std::ostringstream oss;
@@ -285,7 +444,7 @@ void CLIMonitor::draw_progress_bar(float percentage, int width) {
 }
 
 // Format timestamp for display
-std::string CLIMonitor::format_timestamp(const std::chrono::system_clock::time_point& tp) {
+std::string CLIMonitor::format_timestamp(const std::chrono::system_clock::time_point& tp, bool with_date) {
     auto time_t = std::chrono::system_clock::to_time_t(tp);
     
 #ifdef _WIN32
@@ -296,34 +455,207 @@ std::string CLIMonitor::format_timestamp(const std::chrono::system_clock::time_p
 #endif
     
     std::ostringstream oss;
-    oss << std::put_time(&tm, "%H:%M:%S");
+    oss << std::put_time(&tm, with_date ? "%Y-%m-%d %H:%M:%S" : "%H:%M:%S");
     return oss.str();
 }
 
+std::string CLIMonitor::format_timestamp_ms(std::int64_t unix_ms, bool with_date) {
+    return format_timestamp(std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::milliseconds(unix_ms))), with_date);
+}
+
 // Show detailed timeline
 void CLIMonitor::show_timeline() {
+    show_timeline(0, AnomalyJournal::ANY_METRIC);
+}
+
+void CLIMonitor::show_timeline(unsigned minutes, std::uint32_t metric) {
     std::cout << CLEAR_SCREEN << CURSOR_HOME;
     std::cout << BOLD << CYAN << "ANOMALY TIMELINE - Detailed View\n";
     std::cout << "══════════════════════════════════════════════════════════════════════════════\n" << RESET;
     
-    if (anomaly_timeline_.empty()) {
+    if (journal_.empty()) {
         std::cout << GREEN << "No anomalies detected in the timeline.\n" << RESET;
         return;
     }
     
-    // Show all events in chronological order
-    for (const auto& event : anomaly_timeline_) {
-        std::string timestamp = format_timestamp(event.timestamp);
+    std::int64_t from_ms = INT64_MIN;
+    if (minutes > 0) {
+        std::int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        from_ms = now_ms - static_cast<std::int64_t>(minutes) * 60000;
+        std::cout << CYAN << "Last " << minutes << " minutes";
+        if (metric != AnomalyJournal::ANY_METRIC) std::cout << ", " << AnomalyEvent::get_metric_name(metric);
+        std::cout << RESET << "\n";
+    }
+    
+    // Matching events in chronological order, located through the journal index
+    std::size_t shown = 0;
+    journal_.for_each(from_ms, INT64_MAX, metric, [&](const TimelineRecord& event) {
+        std::string timestamp = format_timestamp_ms(event.unix_ms, true);
         std::string status_color = get_status_color(event.z_score);
         
         std::cout << timestamp << " | ";
-        std::cout << status_color << event.metric_name << RESET;
+        std::cout << status_color << AnomalyEvent::get_metric_name(event.metric_index) << RESET;
         std::cout << " = " << std::fixed << std::setprecision(2) << event.value;
         std::cout << " " << get_metric_unit(event.metric_index);
-        std::cout << " (z=" << std::fixed << std::setprecision(2) << event.z_score << ")\n";
+        std::cout << " (z=" << std::fixed << std::setprecision(2) << event.z_score << ")";
+        if (event.incident) std::cout << " incident #" << event.incident;
+        std::cout << "\n";
+        ++shown;
+    });
+    
+    if (shown != journal_.size()) {
+        std::cout << "\n" << CYAN << "Matching anomalies: " << shown << RESET << "\n";
+    }
+    std::cout << "\n" << CYAN << "Total anomalies: " << journal_.size() << RESET << "\n";
+    if (journal_.persistent()) {
+        std::cout << CYAN << "Journal: " << journal_.directory() << RESET << "\n";
     }
+}
+
+// Show the last few minutes of raw samples per metric, decoded from history
+void CLIMonitor::show_history(unsigned minutes) {
+    std::cout << CLEAR_SCREEN << CURSOR_HOME;
+    std::cout << BOLD << CYAN << "SAMPLE HISTORY - Last " << minutes << " minutes\n";
+    std::cout << "══════════════════════════════════════════════════════════════════════════════\n" << RESET;
     
-    std::cout << "\n" << CYAN << "Total anomalies: " << anomaly_timeline_.size() << RESET << "\n";
+    if (!history_) {
+        std::cout << YELLOW << "No sample history available.\n" << RESET;
+        return;
+    }
+    
+    static const char* levels[] = { "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█" };
+    constexpr std::size_t COLUMNS = 60;
+    std::int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::int64_t from_ms = now_ms - static_cast<std::int64_t>(minutes) * 60000;
+    std::int64_t span_ms = std::max<std::int64_t>(now_ms - from_ms, 1);
+    
+    for (std::size_t i = 0; i < history_->size() && i < N_METRICS; ++i) {
+        // One pass: overall stats plus the mean of each display column
+        float lo = 0.0f, hi = 0.0f, last = 0.0f;
+        double sum = 0.0;
+        std::size_t count = 0;
+        double col_sum[COLUMNS] = {};
+        std::size_t col_n[COLUMNS] = {};
+        
+        SampleHistory::Cursor cur = history_->read(i, from_ms);
+        std::int64_t t;
+        float v;
+        while (cur.next(t, v)) {
+            if (count == 0 || v < lo) lo = v;
+            if (count == 0 || v > hi) hi = v;
+            last = v;
+            sum += v;
+            ++count;
+            std::size_t col = static_cast<std::size_t>((t - from_ms) * static_cast<std::int64_t>(COLUMNS) / span_ms);
+            col = std::min(col, COLUMNS - 1);
+            col_sum[col] += v;
+            ++col_n[col];
+        }
+        
+        std::cout << "\n" << BOLD << AnomalyEvent::get_metric_name(i) << RESET;
+        if (count == 0) {
+            std::cout << ": no samples\n";
+            continue;
+        }
+        std::cout << "  min " << format_value(lo, i) << "  avg " << format_value(static_cast<float>(sum / count), i)
+                  << "  max " << format_value(hi, i) << "  last " << format_value(last, i) << "\n";
+        
+        std::cout << "  ";
+        for (std::size_t c = 0; c < COLUMNS; ++c) {
+            if (col_n[c] == 0) {
+                std::cout << " ";
+                continue;
+            }
+            float mean = static_cast<float>(col_sum[c] / col_n[c]);
+            int level = (hi > lo) ? static_cast<int>((mean - lo) / (hi - lo) * 7.0f + 0.5f) : 0;
+            std::cout << levels[std::max(0, std::min(level, 7))];
+        }
+        std::cout << "\n  " << CYAN << count << " samples, "
+                  << std::fixed << std::setprecision(2)
+                  << static_cast<double>(history_->encoded_bytes(i)) / std::max<std::size_t>(history_->points(i), 1)
+                  << " bytes/sample stored" << RESET << "\n";
+    }
+}
+
+// Bucket means scaled between the lowest and highest mean; gaps stay blank
+void CLIMonitor::draw_sparkline(const std::vector<RollupSummary>& buckets) {
+    static const char* levels[] = { "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█" };
+    double lo = 0.0, hi = 0.0;
+    bool any = false;
+    for (const RollupSummary& b : buckets) {
+        if (b.count == 0) continue;
+        double m = b.mean();
+        lo = any ? std::min(lo, m) : m;
+        hi = any ? std::max(hi, m) : m;
+        any = true;
+    }
+    for (const RollupSummary& b : buckets) {
+        if (b.count == 0) {
+            std::cout << " ";
+            continue;
+        }
+        int level = (hi > lo) ? static_cast<int>((b.mean() - lo) / (hi - lo) * 7.0 + 0.5) : 0;
+        std::cout << levels[std::max(0, std::min(level, 7))];
+    }
+}
+
+// Per metric: the current second against hour, day and 30-day baselines.
+// Every figure comes from rollup buckets, so the cost is independent of how
+// many samples those periods held.
+void CLIMonitor::show_rollups() {
+    std::cout << CLEAR_SCREEN << CURSOR_HOME;
+    std::cout << BOLD << CYAN << "LONG-RANGE VIEW - Rollups\n";
+    std::cout << "══════════════════════════════════════════════════════════════════════════════\n" << RESET;
+    
+    if (!rollups_) {
+        std::cout << YELLOW << "No rollups available.\n" << RESET;
+        return;
+    }
+    
+    // Range covered by `buckets` buckets of `level`, drawn `group` buckets per column
+    struct Range { const char* label; std::size_t level; std::size_t buckets; std::size_t group; };
+    static const Range ranges[] = {
+        { "hour   ", 1, 60, 1 },     // 1-minute buckets
+        { "day    ", 2, 24, 1 },     // 1-hour buckets
+        { "30 days", 2, 720, 12 },   // half-day columns
+    };
+    std::int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::vector<RollupSummary> buckets, columns;
+    
+    for (std::size_t i = 0; i < rollups_->size() && i < N_METRICS; ++i) {
+        RollupSummary current = rollups_->summarize(i, 0, now_ms - 1000, now_ms);
+        std::cout << "\n" << BOLD << AnomalyEvent::get_metric_name(i) << RESET;
+        if (current.count == 0) {
+            std::cout << ": no recent samples\n";
+            continue;
+        }
+        std::cout << "  now " << format_value(static_cast<float>(current.mean()), i) << "\n";
+        
+        for (const Range& r : ranges) {
+            rollups_->series(i, r.level, now_ms, r.buckets, buckets);
+            RollupSummary s;
+            columns.assign((buckets.size() + r.group - 1) / r.group, RollupSummary{});
+            for (std::size_t b = 0; b < buckets.size(); ++b) {
+                s.merge(buckets[b]);
+                columns[b / r.group].merge(buckets[b]);
+            }
+            if (s.count == 0) continue;
+            double sd = s.stddev();
+            double z = sd > 0.0 ? (current.mean() - s.mean()) / sd : 0.0;
+            std::cout << "  " << r.label << " mean " << format_value(static_cast<float>(s.mean()), i)
+                      << "  range " << format_value(s.min, i) << ".." << format_value(s.max, i)
+                      << "  z=" << get_status_color(static_cast<float>(z))
+                      << std::fixed << std::setprecision(2) << z << RESET << "\n";
+            std::cout << "          ";
+            draw_sparkline(columns);
+            std::cout << "\n";
+        }
+    }
 }
 
 // Interactive menu system
@@ -335,7 +667,9 @@ void CLIMonitor::show_interactive_menu() {
     
     std::cout << BOLD << "Available Commands:\n" << RESET;
     std::cout << "  " << GREEN << "h" << RESET << " - Show this help menu\n";
-    std::cout << "  " << GREEN << "t" << RESET << " - View detailed anomaly timeline\n";
+    std::cout << "  " << GREEN << "t" << RESET << " - View detailed anomaly timeline (t MIN [METRIC#]: last MIN minutes)\n";
+    std::cout << "  " << GREEN << "r" << RESET << " - Recent samples (r MIN: last MIN minutes, default 5)\n";
+    std::cout << "  " << GREEN << "l" << RESET << " - Long-range view (hour / day / 30 days)\n";
     std::cout << "  " << GREEN << "s" << RESET << " - Show statistics\n";
     std::cout << "  " << GREEN << "c" << RESET << " - Clear timeline\n";
     std::cout << "  " << GREEN << "e" << RESET << " - Export timeline to file\n";
@@ -360,7 +694,29 @@ void CLIMonitor::handle_user_input() {
             show_help();
             break;
         case 't':
-            show_timeline();
+            {
+                // "t [minutes [metric#]]"
+                std::istringstream args(input.substr(1));
+                unsigned minutes = 0;
+                std::uint32_t metric = AnomalyJournal::ANY_METRIC;
+                args >> minutes >> metric;
+                show_timeline(minutes, metric);
+            }
+            std::cout << "\n" << YELLOW << "Press Enter to continue..." << RESET;
+            std::cin.get();
+            break;
+        case 'r':
+            {
+                std::istringstream args(input.substr(1));
+                unsigned minutes = 5;
+                args >> minutes;
+                show_history(minutes);
+                std::cout << "\n" << YELLOW << "Press Enter to continue..." << RESET;
+                std::cin.get();
+            }
+            break;
+        case 'l':
+            show_rollups();
             std::cout << "\n" << YELLOW << "Press Enter to continue..." << RESET;
             std::cin.get();
             break;
@@ -412,13 +768,15 @@ void CLIMonitor::show_help() {
     std::cout << "• Heap Free Memory (bytes)\n";
     std::cout << "• System Uptime (hours)\n\n";
     
+    const RuntimeConfig& cfg = config();
     std::cout << BOLD << "Configuration:\n" << RESET;
-    std::cout << "• EWMA Alpha: " << EWMA_ALPHA << " (smoothing factor)\n";
-    std::cout << "• Z-Score Threshold: " << Z_THRESHOLD << " (anomaly detection)\n";
-    std::cout << "• Hysteresis Threshold: " << HYSTERESIS_THRESHOLD << " (alert clearing)\n";
-    std::cout << "• Min Quiet Time: " << MIN_QUIET_TIME_MS << "ms (between alerts)\n";
-    std::cout << "• Warm-up Samples: " << WARMUP_SAMPLES << " (baseline learning)\n";
-    std::cout << "• Sample Interval: " << SAMPLE_MS << "ms\n\n";
+    std::cout << "• EWMA Alpha: " << cfg.ewma_alpha << " (smoothing factor)\n";
+    std::cout << "• Z-Score Threshold: " << cfg.z_threshold << " (anomaly detection)\n";
+    std::cout << "• Hysteresis Threshold: " << cfg.hysteresis_threshold << " (alert clearing)\n";
+    std::cout << "• Min Quiet Time: " << cfg.min_quiet_time_ms << "ms (between alerts)\n";
+    std::cout << "• Warm-up Samples: " << cfg.warmup_samples << " (baseline learning)\n";
+    std::cout << "• Sample Interval: " << cfg.sample_ms << "ms\n";
+    std::cout << "• Config Generation: " << cfg.generation << " (reload with SIGHUP)\n\n";
     
     std::cout << BOLD << "Alarm System:\n" << RESET;
     std::cout << "• Visual alarms with blinking indicators\n";
@@ -435,44 +793,74 @@ void CLIMonitor::show_statistics() {
     std::cout << BOLD << CYAN << "STATISTICS - System Anomaly Detector\n";
     std::cout << "══════════════════════════════════════════════════════════════════════════════\n" << RESET;
     
+    const AnomalyStats::Metric& total = stats_.total();
     std::cout << "\n" << BOLD << "Timeline Statistics:\n" << RESET;
-    std::cout << "• Total Anomalies: " << anomaly_timeline_.size() << "\n";
+    std::cout << "• Total Anomalies: " << total.records << " (" << total.episodes << " episodes)\n";
     std::cout << "• Alarm Count: " << alarm_count_ << "\n";
+    std::cout << "• Incidents: " << incidents_.opened() << " (" << incidents_.repeats()
+              << " repeated alerts folded in)\n";
     std::cout << "• Current Alarm Status: " << (alarm_active_ ? "ACTIVE" : "INACTIVE") << "\n\n";
     
-    if (!anomaly_timeline_.empty()) {
-        // Calculate statistics
-        float max_z_score = 0.0f;
-        float avg_z_score = 0.0f;
-        std::vector<int> metric_counts(N_METRICS, 0);
-        
-        for (const auto& event : anomaly_timeline_) {
-            max_z_score = std::max(max_z_score, std::fabs(event.z_score));
-            avg_z_score += std::fabs(event.z_score);
-            metric_counts[event.metric_index]++;
-        }
-        avg_z_score /= anomaly_timeline_.size();
+    if (total.records > 0) {
+        std::int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
         
         std::cout << BOLD << "Anomaly Analysis:\n" << RESET;
-        std::cout << "• Maximum Z-Score: " << std::fixed << std::setprecision(2) << max_z_score << "\n";
-        std::cout << "• Average Z-Score: " << std::fixed << std::setprecision(2) << avg_z_score << "\n";
+        std::cout << "• Maximum Z-Score: " << std::fixed << std::setprecision(2) << total.max_abs_z << "\n";
+        std::cout << "• Average Z-Score: " << std::fixed << std::setprecision(2) << total.mean_abs_z() << "\n";
+        std::cout << "• Z-Score p50/p90/p99: " << total.abs_z[0].value() << " / "
+                  << total.abs_z[1].value() << " / " << total.abs_z[2].value() << "\n";
+        std::cout << "• Last Minute / Hour: " << stats_.recent(now_ms, 1, stats_.size()) << " / "
+                  << stats_.recent(now_ms, 60, stats_.size()) << " records\n";
+        if (total.episodes > 1) {
+            std::cout << "• Mean Time Between Anomalies: " << std::setprecision(1)
+                      << total.mtba_ms() / 1000.0 << "s\n";
+        }
         std::cout << "• Most Anomalous Metric: ";
         
-        auto max_it = std::max_element(metric_counts.begin(), metric_counts.end());
-        std::size_t max_idx = std::distance(metric_counts.begin(), max_it);
-        std::cout << AnomalyEvent::get_metric_name(max_idx) << " (" << *max_it << " events)\n\n";
+        std::size_t max_idx = 0;
+        for (std::size_t i = 1; i < stats_.size(); ++i) {
+            if (stats_.metric(i).records > stats_.metric(max_idx).records) max_idx = i;
+        }
+        std::cout << AnomalyEvent::get_metric_name(max_idx) << " (" << stats_.metric(max_idx).records << " events)\n\n";
         
         std::cout << BOLD << "Anomalies by Metric:\n" << RESET;
-        for (std::size_t i = 0; i < N_METRICS; ++i) {
-            if (metric_counts[i] > 0) {
-                std::cout << "• " << AnomalyEvent::get_metric_name(i) << ": " << metric_counts[i] << " events\n";
+        std::cout << "  " << std::left << std::setw(18) << "Metric" << std::right
+                  << std::setw(8) << "events" << std::setw(9) << "episodes"
+                  << std::setw(7) << "last h" << std::setw(8) << "max|z|" << std::setw(8) << "avg|z|"
+                  << std::setw(8) << "p50" << std::setw(8) << "p90" << std::setw(8) << "p99"
+                  << std::setw(10) << "MTBA" << "\n";
+        auto row = [&](const std::string& name, const AnomalyStats::Metric& m, std::size_t recent_idx) {
+            if (m.records == 0) return;
+            std::cout << "• " << std::left << std::setw(18) << name << std::right
+                      << std::setw(8) << m.records << std::setw(9) << m.episodes
+                      << std::setw(7) << stats_.recent(now_ms, 60, recent_idx)
+                      << std::setprecision(2) << std::setw(8) << m.max_abs_z << std::setw(8) << m.mean_abs_z()
+                      << std::setw(8) << m.abs_z[0].value() << std::setw(8) << m.abs_z[1].value()
+                      << std::setw(8) << m.abs_z[2].value();
+            if (m.episodes > 1) {
+                std::cout << std::setprecision(1) << std::setw(9) << m.mtba_ms() / 1000.0 << "s";
+            } else {
+                std::cout << std::setw(10) << "-";
             }
-        }
+            std::cout << "\n";
+        };
+        for (std::size_t i = 0; i < stats_.size(); ++i) row(AnomalyEvent::get_metric_name(i), stats_.metric(i), i);
+        // Process, cgroup, device and log streams, together
+        row("Collector streams", stats_.others(), stats_.size() + 1);
     }
 }
 
 void CLIMonitor::clear_timeline() {
-    anomaly_timeline_.clear();
+    if (exporter_.state() == TimelineExporter::State::RUNNING) {
+        exporter_.cancel();
+        std::cout << YELLOW << "Export to " << exporter_.filename() << " cancelled.\n" << RESET;
+    }
+    {
+        std::lock_guard<std::mutex> lock(timeline_mutex_);
+        journal_.clear();
+    }
+    stats_.reset();
     alarm_count_ = 0;
     alarm_active_ = false;
     std::cout << GREEN << "Timeline cleared!\n" << RESET;
@@ -480,33 +868,81 @@ void CLIMonitor::clear_timeline() {
 }
 
 void CLIMonitor::export_timeline(const std::string& filename) {
-    // This would implement file export functionality
-    // For now, just show a message
-    std::cout << YELLOW << "Export functionality would save timeline to: " << filename << "\n" << RESET;
-    std::cout << "This feature can be implemented to save anomalies to CSV/JSON format.\n";
-    std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+    if (exporter_.state() == TimelineExporter::State::RUNNING) {
+        std::cout << YELLOW << "An export to " << exporter_.filename() << " is still running.\n" << RESET;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        return;
+    }
+
+    // Events recorded from here on are not part of this export. The ones
+    // it covers are read by sequence number and stay mapped until the
+    // exporter thread lets go of the source, even if their segments are
+    // dropped meanwhile.
+    struct Pin {
+        CLIMonitor* monitor;
+        ~Pin() {
+            std::lock_guard<std::mutex> lock(monitor->timeline_mutex_);
+            monitor->journal_.unpin();
+        }
+    };
+    std::size_t count;
+    std::uint64_t first;
+    {
+        std::lock_guard<std::mutex> lock(timeline_mutex_);
+        journal_.pin();
+        count = journal_.size();
+        first = journal_.first_seq();
+    }
+    std::shared_ptr<Pin> pin(new Pin{this});
+    auto source = [this, first, pin](std::size_t offset, TimelineRecord* out, std::size_t max) {
+        std::lock_guard<std::mutex> lock(timeline_mutex_);
+        return journal_.read(first + offset, out, max);
+    };
+    // The stream table keeps changing on this thread: name from a copy
+    std::vector<std::string> names;
+    for (std::uint32_t i = 0; g_streams && i < g_streams->size(); ++i) names.push_back(g_streams->name(i));
+    auto name = [names](std::uint32_t idx) {
+        if (idx < N_METRICS) return AnomalyEvent::get_metric_name(idx);
+        return idx < names.size() && !names[idx].empty() ? names[idx] : "Stream " + std::to_string(idx);
+    };
+
+    exporter_.start(filename, export_format_for(filename), count, source, name);
+    std::cout << GREEN << "Exporting " << count << " events to " << filename
+              << " in the background.\n" << RESET;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+}
+
+// Progress or result of the last export, if any
+void CLIMonitor::draw_export_status() {
+    switch (exporter_.state()) {
+        case TimelineExporter::State::IDLE:
+            break;
+        case TimelineExporter::State::RUNNING: {
+            std::size_t total = exporter_.total();
+            std::size_t pct = total ? exporter_.written() * 100 / total : 100;
+            std::cout << "│ " << YELLOW << "💾 Exporting to " << exporter_.filename() << ": "
+                      << pct << "% (" << exporter_.written() << "/" << total << ")" << RESET << "\n";
+            break;
+        }
+        case TimelineExporter::State::DONE:
+            std::cout << "│ " << GREEN << "💾 Exported " << exporter_.written() << " events to "
+                      << exporter_.filename() << " (" << exporter_.bytes() << " bytes)" << RESET << "\n";
+            break;
+        case TimelineExporter::State::FAILED:
+            std::cout << "│ " << RED << "💾 Export to " << exporter_.filename() << " failed: "
+                      << exporter_.error() << RESET << "\n";
+            break;
+    }
 }
 
 // Get threshold for a specific metric
 float CLIMonitor::get_metric_threshold(std::size_t metric_idx) {
-    switch (metric_idx) {
-        case 0: return CPU_THRESHOLD;      // CPU_UTIL
-        case 1: return RAM_THRESHOLD;      // RAM_USED
-        case 2: return DISK_THRESHOLD;     // DISK_IO_RATE
-        case 3: return HEAP_THRESHOLD;     // HEAP_FREE
-        case 4: return UPTIME_THRESHOLD;   // UPTIME_MS
-        default: return Z_THRESHOLD;
-    }
+    const RuntimeConfig& cfg = config();
+    return (metric_idx < N_METRICS) ? cfg.thresholds[metric_idx] : cfg.z_threshold;
 }
 
 // Get hysteresis threshold for a specific metric
 float CLIMonitor::get_hysteresis_threshold(std::size_t metric_idx) {
-    switch (metric_idx) {
-        case 0: return CPU_HYSTERESIS;
-        case 1: return RAM_HYSTERESIS;
-        case 2: return DISK_HYSTERESIS;
-        case 3: return HEAP_HYSTERESIS;
-        case 4: return UPTIME_HYSTERESIS;
-        default: return HYSTERESIS_THRESHOLD;
-    }
-} 
\ No newline at end of file
+    const RuntimeConfig& cfg = config();
+    return (metric_idx < N_METRICS) ? cfg.hysteresis[metric_idx] : cfg.hysteresis_threshold;
+}
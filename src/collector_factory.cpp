@@ -0,0 +1,86 @@
+#include "collector.hpp"
+
+// Per-metric collectors where the platform has them
+#if defined(__linux__)
+    #include "collectors_linux.cpp"
+    #include "collectors_process_linux.cpp"
+    #include "collectors_cgroup_linux.cpp"
+    #include "collectors_device_linux.cpp"
+    #include "collectors_percpu_linux.cpp"
+    #include "collectors_pressure_linux.cpp"
+    #include "collectors_memory_linux.cpp"
+    #include "collectors_log_linux.cpp"
+#endif
+
+std::vector<std::unique_ptr<Collector>> create_platform_collectors(PlatformMetrics& platform,
+                                                                   unsigned sample_ms) {
+    std::vector<std::unique_ptr<Collector>> out;
+#if defined(__linux__)
+    (void)platform;
+    (void)sample_ms;
+    add_linux_collectors(out);
+#else
+    out.emplace_back(new PlatformCollector(platform, sample_ms));
+#endif
+    return out;
+}
+
+std::unique_ptr<Collector> create_process_collector() {
+#if defined(__linux__)
+    return std::unique_ptr<Collector>(new ProcessCollector());
+#else
+    return nullptr;
+#endif
+}
+
+std::unique_ptr<Collector> create_cgroup_collector() {
+#if defined(__linux__)
+    return std::unique_ptr<Collector>(new CgroupCollector());
+#else
+    return nullptr;
+#endif
+}
+
+std::unique_ptr<Collector> create_device_collector() {
+#if defined(__linux__)
+    return std::unique_ptr<Collector>(new DeviceIoCollector());
+#else
+    return nullptr;
+#endif
+}
+
+std::unique_ptr<Collector> create_percpu_collector() {
+#if defined(__linux__)
+    return std::unique_ptr<Collector>(new PerCpuCollector());
+#else
+    return nullptr;
+#endif
+}
+
+std::unique_ptr<Collector> create_pressure_collector() {
+#if defined(__linux__)
+    return std::unique_ptr<Collector>(new PressureCollector());
+#else
+    return nullptr;
+#endif
+}
+
+std::unique_ptr<Collector> create_memory_collector(const std::vector<std::string>& targets) {
+#if defined(__linux__)
+    return std::unique_ptr<Collector>(new MemoryCollector(targets));
+#else
+    (void)targets;
+    return nullptr;
+#endif
+}
+
+std::unique_ptr<Collector> create_log_collector(const std::vector<std::string>& paths,
+                                                const std::vector<std::pair<std::string, std::string>>& patterns) {
+#if defined(__linux__)
+    return std::unique_ptr<Collector>(new LogCollector(paths, patterns));
+#else
+    (void)paths;
+    (void)patterns;
+    return nullptr;
+#endif
+}
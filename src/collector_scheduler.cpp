@@ -0,0 +1,173 @@
+#include "collector_scheduler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+std::size_t slot_of(std::int64_t tick) {
+    return std::size_t(tick % std::int64_t(SCHEDULER_WHEEL_SLOTS));
+}
+
+// Weight of the newest run in Stats::mean_us
+constexpr float COST_SMOOTHING = 0.1f;
+
+}  // namespace
+
+CollectorScheduler::CollectorScheduler(std::int64_t now_ms, BatchReader::Engine io)
+    : io_(io),
+      slots_(SCHEDULER_WHEEL_SLOTS),
+      slot_cost_(SCHEDULER_WHEEL_SLOTS, 0),
+      tick_(now_ms / SCHEDULER_TICK_MS) {}
+
+std::int64_t CollectorScheduler::interval_ticks(const Entry& e) const {
+    double ms = double(e.collector->interval_ms()) * scale_;
+    std::int64_t ticks = std::llround(ms / double(SCHEDULER_TICK_MS));
+    return ticks < 1 ? 1 : ticks;
+}
+
+void CollectorScheduler::arm(std::uint32_t id, std::int64_t due_tick) {
+    Entry& e = entries_[id];
+    std::size_t s = slot_of(due_tick);
+    e.due_tick = due_tick;
+    e.slot_pos = slots_[s].size();
+    e.armed = true;
+    e.stats.interval_ms = unsigned(interval_ticks(e) * SCHEDULER_TICK_MS);
+    slots_[s].push_back(id);
+    slot_cost_[s] += e.collector->cost_us();
+}
+
+void CollectorScheduler::disarm(std::uint32_t id) {
+    Entry& e = entries_[id];
+    if (!e.armed) return;
+    std::size_t s = slot_of(e.due_tick);
+    std::vector<std::uint32_t>& slot = slots_[s];
+    std::uint32_t moved = slot.back();
+    slot[e.slot_pos] = moved;
+    entries_[moved].slot_pos = e.slot_pos;
+    slot.pop_back();
+    slot_cost_[s] -= e.collector->cost_us();
+    e.armed = false;
+}
+
+bool CollectorScheduler::add(std::unique_ptr<Collector> collector, StreamTable& streams) {
+    if (!collector || !collector->open(streams)) return false;
+    std::uint32_t id = std::uint32_t(entries_.size());
+    entries_.emplace_back();
+    Entry& e = entries_.back();
+    e.collector = std::move(collector);
+    e.stats.name = e.collector->name();
+    int fd = e.collector->wake_fd();
+    if (fd >= 0) {
+        wake_fds_.push_back(fd);
+        wake_ids_.push_back(id);
+    }
+
+    // Least loaded phase within the first interval (or revolution)
+    std::int64_t iv = interval_ticks(e);
+    std::int64_t span = std::min<std::int64_t>(iv, SCHEDULER_WHEEL_SLOTS);
+    std::int64_t best = 0;
+    for (std::int64_t k = 1; k < span; ++k) {
+        if (slot_cost_[slot_of(tick_ + 1 + k)] < slot_cost_[slot_of(tick_ + 1 + best)]) best = k;
+    }
+    std::int64_t due = tick_ + 1 + best;
+    e.last_tick = due - iv;
+    arm(id, due);
+    return true;
+}
+
+std::size_t CollectorScheduler::run_due(std::int64_t now_ms, SampleSink& sink) {
+    std::int64_t target = now_ms / SCHEDULER_TICK_MS;
+    if (target <= tick_) return 0;
+
+    // Expired entries of every slot passed since the last round; a slot
+    // visited once per revolution covers a gap longer than the wheel
+    due_.clear();
+    std::int64_t span = std::min<std::int64_t>(target - tick_, SCHEDULER_WHEEL_SLOTS);
+    for (std::int64_t k = 1; k <= span; ++k) {
+        for (std::uint32_t id : slots_[slot_of(tick_ + k)]) {
+            if (entries_[id].due_tick <= target) due_.push_back(id);
+        }
+    }
+    for (std::uint32_t id : due_) disarm(id);
+    tick_ = target;
+
+    // Cheap collectors first, so the fast streams are read closest to the tick
+    std::sort(due_.begin(), due_.end(), [this](std::uint32_t a, std::uint32_t b) {
+        unsigned ca = entries_[a].collector->cost_us(), cb = entries_[b].collector->cost_us();
+        return ca != cb ? ca < cb : a < b;
+    });
+
+    // Everyone's reads in one batch; a collector's cost includes its
+    // prepare() but not the shared batch
+    prepare_us_.assign(due_.size(), 0);
+    for (std::size_t k = 0; k < due_.size(); ++k) {
+        auto t0 = std::chrono::steady_clock::now();
+        entries_[due_[k]].collector->prepare(io_);
+        prepare_us_[k] = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+    }
+    io_.submit();
+
+    for (std::size_t k = 0; k < due_.size(); ++k) {
+        const std::uint32_t id = due_[k];
+        Entry& e = entries_[id];
+        auto t0 = std::chrono::steady_clock::now();
+        e.collector->collect(now_ms, sink);
+        auto us = prepare_us_[k] + std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+
+        Stats& st = e.stats;
+        st.late += target > e.due_tick && !e.woken;
+        st.woken += e.woken;
+        e.woken = false;
+        st.mean_us = st.runs == 0 ? float(us) : st.mean_us + COST_SMOOTHING * (float(us) - st.mean_us);
+        st.max_us = std::max(st.max_us, unsigned(us));
+        ++st.runs;
+
+        // Next tick on the collector's own grid, skipping any it overran
+        std::int64_t iv = interval_ticks(e);
+        std::int64_t next = e.due_tick + ((target - e.due_tick) / iv + 1) * iv;
+        e.last_tick = target;
+        arm(id, next);
+    }
+    return due_.size();
+}
+
+void CollectorScheduler::set_rate_scale(double scale) {
+    if (scale == scale_) return;
+    scale_ = scale;
+    for (std::uint32_t id = 0; id < entries_.size(); ++id) {
+        Entry& e = entries_[id];
+        if (!e.armed) continue;
+        disarm(id);
+        arm(id, std::max(e.last_tick + interval_ticks(e), tick_ + 1));
+    }
+}
+
+void CollectorScheduler::wake(const std::vector<std::uint8_t>& woken) {
+    for (std::size_t k = 0; k < woken.size() && k < wake_ids_.size(); ++k) {
+        const std::uint32_t id = wake_ids_[k];
+        Entry& e = entries_[id];
+        if (!woken[k] || !e.armed || e.due_tick <= tick_ + 1) continue;
+        disarm(id);
+        e.woken = true;
+        arm(id, tick_ + 1);
+    }
+}
+
+std::int64_t CollectorScheduler::next_due_ms() const {
+    // First armed slot within one revolution...
+    for (std::int64_t k = 1; k <= std::int64_t(SCHEDULER_WHEEL_SLOTS); ++k) {
+        std::int64_t t = tick_ + k;
+        for (std::uint32_t id : slots_[slot_of(t)]) {
+            if (entries_[id].due_tick == t) return t * SCHEDULER_TICK_MS;
+        }
+    }
+    // ...else everything is further out than the wheel spans
+    std::int64_t due = tick_ + 1 + std::int64_t(SCHEDULER_WHEEL_SLOTS);
+    for (const Entry& e : entries_) {
+        if (e.armed && e.due_tick < due) due = e.due_tick;
+    }
+    return due * SCHEDULER_TICK_MS;
+}
@@ -0,0 +1,319 @@
+#ifdef __linux__
+#include "collector.hpp"
+#include "proc_text.hpp"
+#include "fd_budget.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+// Per-cgroup CPU, memory, memory pressure and block I/O from the cgroup v2
+// hierarchy (--cgroups), for container hosts where the whole-host figures
+// hide which container is misbehaving. Each cgroup gets up to four streams,
+// "cgroup.<path>.cpu|mem|mempsi|io", one per interface file its enabled
+// controllers provide:
+//
+//  - cpu.stat usage_usec, as % of one core over the interval
+//  - memory.current, bytes
+//  - memory.pressure "some" total, as % of the interval some task stalled
+//  - io.stat rbytes + wbytes over all devices, bytes/s
+//
+// The files are opened relative to each cgroup's directory fd and held
+// open to be re-read from offset 0, in the scheduler's shared batch read
+// (BatchReader) once prepare() has given them slots. A removed cgroup's held fds fail with ENODEV, which drops it at once; new
+// cgroups are found by walking the hierarchy again, which is only done
+// when the root's cgroup.stat descendant count moves, or every
+// CGROUP_RESCAN_MS in case one cgroup came and another went in between.
+
+namespace {
+
+enum CgroupFile { CG_CPU, CG_MEM, CG_PSI, CG_IO, CG_FILES };
+const char* const CGROUP_FILE_NAMES[CG_FILES] = { "cpu.stat", "memory.current", "memory.pressure", "io.stat" };
+const char* const CGROUP_STREAM_SUFFIX[CG_FILES] = { "cpu", "mem", "mempsi", "io" };
+const float CGROUP_STREAM_QUANTUM[CG_FILES] = { CPU_QUANTUM, MEMORY_QUANTUM, DEFAULT_QUANTUM, DISK_QUANTUM };
+
+}  // namespace
+
+class CgroupCollector : public Collector {
+    struct Group {
+        int fd[CG_FILES]{-1, -1, -1, -1};
+        BatchReader::Slot slot[CG_FILES]{BatchReader::NONE, BatchReader::NONE,
+                                         BatchReader::NONE, BatchReader::NONE};
+        bool batched[CG_FILES]{};     // slot read in this collection's batch
+        std::uint32_t stream[CG_FILES]{StreamTable::NONE, StreamTable::NONE,
+                                      StreamTable::NONE, StreamTable::NONE};
+        std::uint64_t prev[CG_FILES]{};
+        double prev_s{0.0};
+        std::uint32_t seen{0};
+        bool first_scan{true};
+    };
+
+    int root_fd_ = -1;
+    int root_stat_fd_ = -1;
+    StreamTable* streams_ = nullptr;
+    BatchReader* io_ = nullptr;
+    std::unordered_map<std::string, Group> groups_;   // by path below the mount
+    std::uint32_t generation_ = 0;
+    std::uint64_t descendants_ = 0;
+    double last_walk_s_ = 0.0;
+    std::size_t fds_held_ = 0;
+    std::size_t fd_budget_ = 0;
+    std::string path_;
+    char buf_[4096];
+
+    static double monotonic_now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return double(ts.tv_sec) + double(ts.tv_nsec) / 1e9;
+    }
+
+    // The cgroup v2 mount from /proc/self/mountinfo (a hybrid host mounts
+    // it below /sys/fs/cgroup); empty if there is none
+    static std::string find_mount() {
+        std::FILE* f = std::fopen("/proc/self/mountinfo", "re");
+        if (!f) return std::string();
+        std::string found;
+        char line[1024];
+        while (std::fgets(line, sizeof(line), f)) {
+            // "id parent maj:min root mount-point options ... - fstype source ..."
+            const char* sep = std::strstr(line, " - cgroup2 ");
+            if (!sep) continue;
+            char mount[512];
+            if (std::sscanf(line, "%*s %*s %*s %*s %511s", mount) == 1) {
+                found = mount;
+                break;
+            }
+        }
+        std::fclose(f);
+        return found;
+    }
+
+    ssize_t read_held(int fd) {
+        ssize_t n = pread(fd, buf_, sizeof(buf_) - 1, 0);
+        buf_[n > 0 ? n : 0] = '\0';
+        return n;
+    }
+
+    // Descendant count from the root's cgroup.stat; true if it moved
+    bool hierarchy_changed() {
+        if (root_stat_fd_ < 0 || read_held(root_stat_fd_) <= 0) return true;
+        std::uint64_t n = field_after(buf_, "nr_descendants");
+        bool moved = n != descendants_;
+        descendants_ = n;
+        return moved;
+    }
+
+    // Open one interface file of a cgroup and register its stream if it is
+    // readable. Held if the budget allows, otherwise re-opened (relative to
+    // the mount) each collection.
+    void open_file(Group& g, int dir, CgroupFile file, const std::string& base) {
+        int fd = openat(dir, CGROUP_FILE_NAMES[file], O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;                       // controller not enabled here
+        if (read_held(fd) < 0) {
+            close(fd);
+            return;
+        }
+        g.stream[file] = streams_->add(base + CGROUP_STREAM_SUFFIX[file], CGROUP_STREAM_QUANTUM[file]);
+        if (fds_held_ < fd_budget_) {
+            g.fd[file] = fd;
+            ++fds_held_;
+        } else {
+            close(fd);
+        }
+    }
+
+    void track(const std::string& path, int dir) {
+        auto ins = groups_.emplace(path, Group());
+        Group& g = ins.first->second;
+        g.seen = generation_;
+        if (!ins.second) return;
+        std::string base = "cgroup." + (path.empty() ? std::string("/") : path) + ".";
+        for (int f = 0; f < CG_FILES; ++f) open_file(g, dir, CgroupFile(f), base);
+    }
+
+    // Depth-first over the directories below `dir` (path_ is its path)
+    void walk(int dir) {
+        int dup_fd = dup(dir);
+        DIR* d = dup_fd >= 0 ? fdopendir(dup_fd) : nullptr;
+        if (!d) {
+            if (dup_fd >= 0) close(dup_fd);
+            return;
+        }
+        rewinddir(d);                             // the dup shares the root fd's offset
+        while (struct dirent* de = readdir(d)) {
+            if (de->d_type != DT_DIR || de->d_name[0] == '.') continue;
+            int child = openat(dir, de->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (child < 0) continue;              // removed meanwhile
+            std::size_t len = path_.size();
+            path_ += '/';
+            path_ += de->d_name;
+            track(path_, child);
+            walk(child);
+            path_.resize(len);
+            close(child);
+        }
+        closedir(d);
+    }
+
+    void rescan(double now_s) {
+        ++generation_;
+        path_.clear();
+        track(path_, root_fd_);
+        walk(root_fd_);
+        last_walk_s_ = now_s;
+        for (auto it = groups_.begin(); it != groups_.end(); ) {
+            if (it->second.seen != generation_) {
+                release(it->second);
+                it = groups_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void release(Group& g) {
+        for (int f = 0; f < CG_FILES; ++f) {
+            if (g.slot[f] != BatchReader::NONE) io_->detach(g.slot[f]);
+            if (g.fd[f] >= 0) {
+                close(g.fd[f]);
+                --fds_held_;
+            }
+            streams_->release(g.stream[f]);
+        }
+    }
+
+    // Counter (or level) reading of one file, from the batch if its slot
+    // was read in it; false if gone
+    bool read_file(const std::string& path, Group& g, CgroupFile file, std::uint64_t& out) {
+        const char* text = buf_;
+        ssize_t n;
+        if (g.batched[file]) {
+            g.batched[file] = false;
+            n = io_->result(g.slot[file]);
+            text = io_->data(g.slot[file]);
+        } else if (g.fd[file] >= 0) {
+            n = read_held(g.fd[file]);
+        } else {
+            std::string rel = (path.empty() ? std::string(".") : path.substr(1)) + "/" + CGROUP_FILE_NAMES[file];
+            int fd = openat(root_fd_, rel.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return false;
+            n = read_held(fd);
+            close(fd);
+        }
+        if (n < 0) return false;                  // ENODEV: removed (an empty io.stat is fine)
+        switch (file) {
+            case CG_CPU:
+                out = field_after(text, "usage_usec");
+                break;
+            case CG_MEM: {
+                const char* p = text;
+                out = next_field(p);
+                break;
+            }
+            case CG_PSI:
+                // "some avg10=.. avg60=.. avg300=.. total=<us>"
+                out = field_after(text, "total=");
+                break;
+            case CG_IO: {
+                // "maj:min rbytes=.. wbytes=.. rios=.. ..." per device
+                std::uint64_t sum = 0;
+                for (const char* p = text; (p = std::strstr(p, "bytes=")) != nullptr; ) {
+                    bool rw = p > text && (p[-1] == 'r' || p[-1] == 'w');
+                    p += 6;
+                    std::uint64_t v = next_field(p);
+                    sum += rw ? v : 0;                // not dbytes (discards)
+                }
+                out = sum;
+                break;
+            }
+            default:
+                return false;
+        }
+        return true;
+    }
+
+    // One cgroup; false if it has been removed
+    bool sample(const std::string& path, Group& g, double now_s, SampleSink& sink) {
+        const double dt = now_s - g.prev_s;
+        for (int f = 0; f < CG_FILES; ++f) {
+            if (g.stream[f] == StreamTable::NONE) continue;
+            std::uint64_t v;
+            if (!read_file(path, g, CgroupFile(f), v)) return false;
+            if (f == CG_MEM) {
+                sink.put(g.stream[f], float(v));
+            } else if (!g.first_scan && dt > 0.0 && v >= g.prev[f]) {
+                double per_s = double(v - g.prev[f]) / dt;
+                // usage and stall times are in microseconds
+                sink.put(g.stream[f], float(f == CG_IO ? per_s : per_s / 1e4));
+            }
+            g.prev[f] = v;
+        }
+        g.prev_s = now_s;
+        g.first_scan = false;
+        return true;
+    }
+
+public:
+    ~CgroupCollector() override {
+        for (auto& kv : groups_) {
+            for (int fd : kv.second.fd) {
+                if (fd >= 0) close(fd);
+            }
+        }
+        if (root_stat_fd_ >= 0) close(root_stat_fd_);
+        if (root_fd_ >= 0) close(root_fd_);
+    }
+
+    const char* name() const override { return "cgroups"; }
+    unsigned interval_ms() const override { return CGROUP_COLLECT_MS; }
+    unsigned cost_us() const override { return CGROUP_COLLECT_COST_US; }
+
+    // Held files get a slot on first sight and go into the scheduler's batch
+    void prepare(BatchReader& io) override {
+        io_ = &io;
+        for (auto& kv : groups_) {
+            Group& g = kv.second;
+            for (int f = 0; f < CG_FILES; ++f) {
+                if (g.fd[f] < 0) continue;
+                if (g.slot[f] == BatchReader::NONE) g.slot[f] = io.attach(g.fd[f], sizeof(buf_));
+                if (g.slot[f] == BatchReader::NONE) continue;
+                io.queue(g.slot[f]);
+                g.batched[f] = true;
+            }
+        }
+    }
+
+    bool open(StreamTable& streams) override {
+        streams_ = &streams;
+        std::string mount = find_mount();
+        if (mount.empty()) return false;
+        root_fd_ = ::open(mount.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (root_fd_ < 0) return false;
+        root_stat_fd_ = openat(root_fd_, "cgroup.stat", O_RDONLY | O_CLOEXEC);
+        fd_budget_ = fd_budget(CGROUP_MAX_HELD_FDS, PROCESS_RESERVED_FDS);
+        hierarchy_changed();
+        rescan(monotonic_now());
+        return true;
+    }
+
+    void collect(std::int64_t, SampleSink& sink) override {
+        const double now_s = monotonic_now();
+        if (hierarchy_changed() || now_s - last_walk_s_ >= CGROUP_RESCAN_MS / 1000.0) rescan(now_s);
+        for (auto it = groups_.begin(); it != groups_.end(); ) {
+            if (!sample(it->first, it->second, now_s, sink)) {
+                release(it->second);
+                it = groups_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    std::size_t tracked() const { return groups_.size(); }
+};
+#endif
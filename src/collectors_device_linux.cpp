@@ -0,0 +1,171 @@
+#ifdef __linux__
+#include "collector.hpp"
+#include "diskstats.hpp"
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+// Per-device disk and network I/O for the whole host (--devices), from
+// /proc/diskstats and /proc/net/dev:
+//
+//   disk.<dev>.rbytes|wbytes   bytes/s read and written
+//   disk.<dev>.iops            reads + writes completed per second
+//   disk.<dev>.latency         ms per completed I/O over the interval
+//   disk.<dev>.queue           mean I/Os in flight (weighted busy time)
+//   net.<if>.rx|tx             bytes/s received and sent
+//   net.<if>.pkts              packets/s both ways
+//   net.<if>.drops             errors + drops per second both ways
+//
+// Each file is one held fd and one pread per collection, parsed in place;
+// devices are matched to their state by line order (DeviceList), so a
+// collection allocates nothing while no device comes or goes. Partitions
+// (counted in their disk) and the loopback interface are skipped, and a
+// device gets its streams on its first I/O, so the idle loop devices of a
+// typical host cost nothing but their line. Rates go through
+// counter_delta: a 32-bit counter that wrapped still gives the right
+// rate, a reset one (device re-created) gives none that interval.
+
+namespace {
+
+enum DiskStream { DISK_RBYTES, DISK_WBYTES, DISK_IOPS, DISK_LATENCY, DISK_QUEUE, DISK_STREAMS };
+const char* const DISK_STREAM_SUFFIX[DISK_STREAMS] = { "rbytes", "wbytes", "iops", "latency", "queue" };
+const float DISK_STREAM_QUANTUM[DISK_STREAMS] = { DISK_QUANTUM, DISK_QUANTUM, COUNT_RATE_QUANTUM,
+                                                  DEFAULT_QUANTUM, DEFAULT_QUANTUM };
+
+enum NetStream { NET_RX, NET_TX, NET_PKTS, NET_DROPS, NET_STREAMS };
+const char* const NET_STREAM_SUFFIX[NET_STREAMS] = { "rx", "tx", "pkts", "drops" };
+const float NET_STREAM_QUANTUM[NET_STREAMS] = { DISK_QUANTUM, DISK_QUANTUM, COUNT_RATE_QUANTUM, DEFAULT_QUANTUM };
+
+}  // namespace
+
+class DeviceIoCollector : public Collector {
+    struct Device {
+        std::string name;
+        std::uint64_t prev[ND_FIELDS]{};
+        std::uint32_t stream[DISK_STREAMS]{StreamTable::NONE, StreamTable::NONE, StreamTable::NONE,
+                                           StreamTable::NONE, StreamTable::NONE};
+        bool skip{false};           // partition or loopback
+        bool active{false};         // has streams
+    };
+
+    int disk_fd_ = -1;
+    int net_fd_ = -1;
+    StreamTable* streams_ = nullptr;
+    DeviceList<Device> disks_;
+    DeviceList<Device> nets_;
+    std::vector<char> buf_;
+    double prev_s_ = 0.0;
+
+    void release(Device& d) {
+        for (std::uint32_t& s : d.stream) {
+            streams_->release(s);
+            s = StreamTable::NONE;
+        }
+    }
+
+    void activate(Device& d, const char* prefix, const char* const* suffix, const float* quantum, int n) {
+        std::string base = prefix + d.name + ".";
+        for (int k = 0; k < n; ++k) d.stream[k] = streams_->add(base + suffix[k], quantum[k]);
+        d.active = true;
+    }
+
+    // Deltas of the `n` counters in `idx` since the last reading; false if
+    // any was reset
+    static bool deltas(const Device& d, const DeviceLine& line, const int* idx, int n, std::uint64_t* out) {
+        for (int k = 0; k < n; ++k) {
+            if (!counter_delta(d.prev[idx[k]], line.field[idx[k]], out[k])) return false;
+        }
+        return true;
+    }
+
+    void collect_disks(double dt, SampleSink& sink) {
+        if (disk_fd_ < 0 || read_whole(disk_fd_, buf_) < 0) return;
+        static const int USED[] = { DS_READS, DS_SECTORS_READ, DS_MS_READING, DS_WRITES,
+                                    DS_SECTORS_WRITTEN, DS_MS_WRITING, DS_MS_WEIGHTED };
+        const char* p = buf_.data();
+        DeviceLine line;
+        bool added;
+        disks_.begin();
+        while (next_diskstats(p, line)) {
+            Device& d = disks_.match(line.name, line.name_len, added);
+            if (added) d.skip = disk_kind(line.name, line.name_len) == DiskKind::PARTITION;
+            if (d.skip) continue;
+            std::uint64_t v[7];
+            bool ok = !added && d.active && dt > 0.0 && deltas(d, line, USED, 7, v);
+            if (!d.active && line.field[DS_READS] + line.field[DS_WRITES] > 0) {
+                activate(d, "disk.", DISK_STREAM_SUFFIX, DISK_STREAM_QUANTUM, DISK_STREAMS);
+            }
+            if (ok) {
+                const std::uint64_t ios = v[0] + v[3];
+                sink.put(d.stream[DISK_RBYTES], float(double(v[1] * DISK_SECTOR_BYTES) / dt));
+                sink.put(d.stream[DISK_WBYTES], float(double(v[4] * DISK_SECTOR_BYTES) / dt));
+                sink.put(d.stream[DISK_IOPS], float(double(ios) / dt));
+                sink.put(d.stream[DISK_LATENCY], ios ? float(double(v[2] + v[5]) / double(ios)) : 0.0f);
+                sink.put(d.stream[DISK_QUEUE], float(double(v[6]) / (dt * 1000.0)));
+            }
+            for (int k = 0; k < DS_FIELDS; ++k) d.prev[k] = line.field[k];
+        }
+        disks_.end([this](Device& d) { release(d); });
+    }
+
+    void collect_nets(double dt, SampleSink& sink) {
+        if (net_fd_ < 0 || read_whole(net_fd_, buf_) < 0) return;
+        static const int USED[] = { ND_RX_BYTES, ND_TX_BYTES, ND_RX_PACKETS, ND_TX_PACKETS,
+                                    ND_RX_ERRS, ND_RX_DROP, ND_TX_ERRS, ND_TX_DROP };
+        const char* p = buf_.data();
+        DeviceLine line;
+        bool added;
+        nets_.begin();
+        while (next_netdev(p, line)) {
+            Device& d = nets_.match(line.name, line.name_len, added);
+            if (added) d.skip = d.name == "lo";
+            if (d.skip) continue;
+            std::uint64_t v[8];
+            bool ok = !added && d.active && dt > 0.0 && deltas(d, line, USED, 8, v);
+            if (!d.active && line.field[ND_RX_PACKETS] + line.field[ND_TX_PACKETS] > 0) {
+                activate(d, "net.", NET_STREAM_SUFFIX, NET_STREAM_QUANTUM, NET_STREAMS);
+            }
+            if (ok) {
+                sink.put(d.stream[NET_RX], float(double(v[0]) / dt));
+                sink.put(d.stream[NET_TX], float(double(v[1]) / dt));
+                sink.put(d.stream[NET_PKTS], float(double(v[2] + v[3]) / dt));
+                sink.put(d.stream[NET_DROPS], float(double(v[4] + v[5] + v[6] + v[7]) / dt));
+            }
+            for (int k = 0; k < ND_FIELDS; ++k) d.prev[k] = line.field[k];
+        }
+        nets_.end([this](Device& d) { release(d); });
+    }
+
+public:
+    ~DeviceIoCollector() override {
+        if (disk_fd_ >= 0) close(disk_fd_);
+        if (net_fd_ >= 0) close(net_fd_);
+    }
+
+    const char* name() const override { return "devices"; }
+    unsigned interval_ms() const override { return DEVICE_COLLECT_MS; }
+    unsigned cost_us() const override { return DEVICE_COLLECT_COST_US; }
+
+    bool open(StreamTable& streams) override {
+        streams_ = &streams;
+        disk_fd_ = ::open("/proc/diskstats", O_RDONLY | O_CLOEXEC);
+        net_fd_ = ::open("/proc/net/dev", O_RDONLY | O_CLOEXEC);
+        return disk_fd_ >= 0 || net_fd_ >= 0;
+    }
+
+    void collect(std::int64_t, SampleSink& sink) override {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        const double now_s = double(ts.tv_sec) + double(ts.tv_nsec) / 1e9;
+        const double dt = prev_s_ > 0.0 ? now_s - prev_s_ : 0.0;
+        collect_disks(dt, sink);
+        collect_nets(dt, sink);
+        prev_s_ = now_s;
+    }
+
+    std::size_t tracked() const { return disks_.size() + nets_.size(); }
+};
+#endif
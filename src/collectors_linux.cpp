@@ -0,0 +1,171 @@
+#ifdef __linux__
+#include "collector.hpp"
+#include "metrics.hpp"
+#include "diskstats.hpp"
+#include "heap_stats.hpp"
+
+#include <sys/sysinfo.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+
+// Per-metric collectors for --multi-rate. Each keeps its own previous
+// reading and timestamp, so a rate is always over its own interval. Proc
+// files are opened once and re-read with pread, which is all a 10 ms
+// collector can afford.
+
+namespace {
+
+// Read a whole (small) proc file from offset 0 into buf, NUL-terminated
+ssize_t read_proc(int fd, char* buf, std::size_t size) {
+    if (fd < 0) return -1;
+    ssize_t n = pread(fd, buf, size - 1, 0);
+    buf[n > 0 ? n : 0] = '\0';
+    return n;
+}
+
+double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return double(ts.tv_sec) + double(ts.tv_nsec) / 1e9;
+}
+
+}  // namespace
+
+// Aggregate CPU utilization from the first line of /proc/stat
+class CpuCollector : public Collector {
+    int fd_ = -1;
+    unsigned long long prev_total_ = 0;
+    unsigned long long prev_idle_ = 0;
+    bool have_prev_ = false;
+
+public:
+    ~CpuCollector() override { if (fd_ >= 0) close(fd_); }
+
+    const char* name() const override { return "cpu"; }
+    unsigned interval_ms() const override { return CPU_COLLECT_MS; }
+    unsigned cost_us() const override { return CPU_COLLECT_COST_US; }
+
+    bool open(StreamTable&) override {
+        fd_ = ::open("/proc/stat", O_RDONLY | O_CLOEXEC);
+        return fd_ >= 0;
+    }
+
+    void collect(std::int64_t, SampleSink& sink) override {
+        // "cpu  user nice system idle iowait irq softirq steal ..."; the
+        // first line is well inside one small read
+        char buf[256];
+        if (read_proc(fd_, buf, sizeof(buf)) <= 3) return;
+        char* p = buf + 3;
+        unsigned long long f[8] = {};
+        for (int k = 0; k < 8; ++k) f[k] = std::strtoull(p, &p, 10);
+        unsigned long long idle = f[3];
+        unsigned long long total = 0;
+        for (unsigned long long v : f) total += v;
+
+        // Jiffies advance every 10 ms: an interval that saw none yields no
+        // reading rather than a spurious 0
+        if (have_prev_ && total <= prev_total_) return;
+        float util = 0.0f;
+        if (have_prev_) {
+            util = 100.0f * (1.0f - float(idle - prev_idle_) / float(total - prev_total_));
+        }
+        prev_total_ = total;
+        prev_idle_ = idle;
+        have_prev_ = true;
+        sink.put(CPU_UTIL, util);
+    }
+};
+
+// Share of physical memory in use, from sysinfo(2)
+class RamCollector : public Collector {
+public:
+    const char* name() const override { return "ram"; }
+    unsigned interval_ms() const override { return RAM_COLLECT_MS; }
+    unsigned cost_us() const override { return RAM_COLLECT_COST_US; }
+    bool open(StreamTable&) override { return true; }
+
+    void collect(std::int64_t, SampleSink& sink) override {
+        struct sysinfo si;
+        if (sysinfo(&si) != 0 || si.totalram == 0) return;
+        unsigned long long total = (unsigned long long)si.totalram * si.mem_unit;
+        unsigned long long used = total - (unsigned long long)si.freeram * si.mem_unit;
+        sink.put(RAM_USED, 100.0f * float(used) / float(total));
+    }
+};
+
+// The host's physical disk I/O in bytes/sec, from /proc/diskstats
+class DiskIoCollector : public Collector {
+    HostDiskBytes disks_;
+    std::uint64_t prev_bytes_ = 0;
+    double prev_s_ = 0.0;
+    bool have_prev_ = false;
+
+public:
+    const char* name() const override { return "disk"; }
+    unsigned interval_ms() const override { return DISK_COLLECT_MS; }
+    unsigned cost_us() const override { return DISK_COLLECT_COST_US; }
+    bool open(StreamTable&) override { return disks_.open(); }
+
+    void collect(std::int64_t, SampleSink& sink) override {
+        std::uint64_t bytes;
+        if (!disks_.read(bytes)) return;
+        double now_s = monotonic_seconds();
+        double dt = now_s - prev_s_;
+        float rate = 0.0f;
+        if (have_prev_ && dt > 0.0 && bytes >= prev_bytes_) {
+            rate = float(double(bytes - prev_bytes_) / dt);
+        }
+        prev_bytes_ = bytes;
+        prev_s_ = now_s;
+        have_prev_ = true;
+        sink.put(DISK_IO_RATE, rate);
+    }
+};
+
+// Free bytes inside this process's allocator, from its own statistics
+// (heap_stats.hpp); dropped where there are none to read
+class HeapCollector : public Collector {
+public:
+    const char* name() const override { return "heap"; }
+    unsigned interval_ms() const override { return HEAP_COLLECT_MS; }
+    unsigned cost_us() const override { return HEAP_COLLECT_COST_US; }
+
+    bool open(StreamTable&) override {
+        HeapStats h;
+        return read_heap_stats(h);
+    }
+
+    void collect(std::int64_t, SampleSink& sink) override {
+        HeapStats h;
+        if (read_heap_stats(h)) sink.put(HEAP_FREE, float(h.free));
+    }
+};
+
+// Monotonic uptime; the exact reading goes along as a counter
+class UptimeCollector : public Collector {
+public:
+    const char* name() const override { return "uptime"; }
+    unsigned interval_ms() const override { return UPTIME_COLLECT_MS; }
+    unsigned cost_us() const override { return UPTIME_COLLECT_COST_US; }
+    bool open(StreamTable&) override { return true; }
+
+    void collect(std::int64_t, SampleSink& sink) override {
+        struct timespec ts;
+        if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) return;
+        std::uint64_t ms = std::uint64_t(ts.tv_sec) * 1000u + std::uint64_t(ts.tv_nsec) / 1000000u;
+        sink.put(UPTIME_MS, float(ms));
+        sink.put_counter(UPTIME_MS, ms);
+    }
+};
+
+static void add_linux_collectors(std::vector<std::unique_ptr<Collector>>& out) {
+    out.emplace_back(new CpuCollector());
+    out.emplace_back(new RamCollector());
+    out.emplace_back(new DiskIoCollector());
+    out.emplace_back(new HeapCollector());
+    out.emplace_back(new UptimeCollector());
+}
+#endif
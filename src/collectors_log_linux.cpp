@@ -0,0 +1,327 @@
+#ifdef __linux__
+#include "collector.hpp"
+#include "log_scan.hpp"
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstring>
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Log volume and error-line rates from tailed files (--log=PATH, with
+// --log-match=NAME=PATTERN):
+//
+//   log.<file>.lines     lines appended per second
+//   log.<file>.<NAME>    appended lines per second containing PATTERN (a
+//                        fixed string, or a regex after "re:")
+//
+// Files are tailed from their end when the collector starts. inotify says
+// which files were written since the last collection, so an idle log costs
+// nothing; a written one is read from where we left off in blocks of
+// LOG_READ_BLOCK_BYTES, and only complete lines are scanned (a partial
+// last line waits for its newline, up to LOG_MAX_LINE_BYTES). Newlines and
+// fixed strings are counted by the vectorized scanners of log_scan.hpp. A
+// regex goes through std::regex, which is far slower, one line at a time:
+// only the lines containing a fixed string its matches must contain, when
+// one can be read off the regex, else every line.
+//
+// Rotation: a watch on each file's directory sees a new file created or
+// moved in under the name, and the file's own watch sees it moved away.
+// Like tail -F, the old file stays open and is read as the writer keeps
+// appending to it (until it reopens the log, e.g. on logrotate's HUP), and
+// is closed once the new file under the name has been written to, or once
+// it is deleted (its link count drops to zero). The new one is read from
+// its start. A file truncated in place (copytruncate) is read again from
+// its start. A file that does not exist yet is picked up when it is
+// created.
+
+class LogCollector : public Collector {
+    // A fixed string, or a regex and a fixed string its matches contain
+    // (empty if none is known)
+    struct LogPattern {
+        std::string name;
+        bool is_regex;
+        LiteralScanner literal;
+        std::regex re;
+    };
+
+    // One open file being read: where we are, and the start of a line
+    // still being written
+    struct Tail {
+        int fd{-1};
+        int wd{-1};                 // watch on it
+        std::uint64_t offset{0};
+        std::string partial;
+    };
+
+    struct File {
+        std::string path;
+        std::string dir;            // containing directory, for its watch
+        std::string base;           // name within it
+        int dir_wd{-1};             // watch on its directory
+        Tail cur;                   // the file under the name
+        Tail old;                   // the one before a rotation, while still written
+        bool dirty{false};          // written since last read
+        bool moved{false};          // cur no longer has the name
+        bool reopen{false};         // a new file has the name now
+        bool unlinked{false};       // cur or old may have been deleted
+        std::uint64_t lines{0};     // since the last collection
+        std::vector<std::uint64_t> matches;
+        std::uint32_t line_stream{StreamTable::NONE};
+        std::vector<std::uint32_t> match_stream;
+    };
+
+    std::vector<std::string> paths_;
+    std::vector<LogPattern> patterns_;
+    std::vector<File> files_;
+    int inotify_fd_ = -1;
+    std::vector<char> buf_;
+    alignas(struct inotify_event) char events_[64 * (sizeof(struct inotify_event) + 256)];
+    double prev_s_ = 0.0;
+
+    static double now_seconds() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return double(ts.tv_sec) + double(ts.tv_nsec) / 1e9;
+    }
+
+    // Open `f.path` and watch it, at its end (`at_end`) or start
+    bool open_file(File& f, bool at_end) {
+        Tail& t = f.cur;
+        t.fd = ::open(f.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (t.fd < 0) return false;
+        struct stat st;
+        t.offset = at_end && fstat(t.fd, &st) == 0 ? std::uint64_t(st.st_size) : 0;
+        t.wd = inotify_add_watch(inotify_fd_, f.path.c_str(), IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF | IN_ATTRIB);
+        t.partial.clear();
+        f.dirty = !at_end;
+        return true;
+    }
+
+    // Done with a file: a last line without its newline still counts
+    void close_tail(File& f, Tail& t) {
+        if (!t.partial.empty()) {
+            scan(f, t.partial.data(), t.partial.size());
+            ++f.lines;
+        }
+        // Watches on a file shared by another entry go with it; harmless
+        if (t.wd >= 0) inotify_rm_watch(inotify_fd_, t.wd);
+        if (t.fd >= 0) close(t.fd);
+        t = Tail();
+    }
+
+    // Read `t` to its end and close it; true if the budget ran out first
+    // (it stays open, to be finished next collection)
+    bool retire(File& f, Tail& t, std::size_t& budget) {
+        if (read_appended(f, t, budget)) return true;
+        close_tail(f, t);
+        return false;
+    }
+
+    static bool deleted(const Tail& t) {
+        struct stat st;
+        return t.fd >= 0 && fstat(t.fd, &st) == 0 && st.st_nlink == 0;
+    }
+
+    // Count the complete lines of [p, p + n)
+    void scan(File& f, const char* p, std::size_t n) {
+        f.lines += count_newlines(p, n);
+        for (std::size_t k = 0; k < patterns_.size(); ++k) {
+            const LogPattern& pat = patterns_[k];
+            if (!pat.is_regex) {
+                f.matches[k] += pat.literal.count_lines(p, n);
+                continue;
+            }
+            std::uint64_t& matches = f.matches[k];
+            if (!pat.literal.needle().empty()) {
+                pat.literal.each_line(p, n, [&](const char* b, const char* e) {
+                    matches += std::regex_search(b, e, pat.re);
+                });
+                continue;
+            }
+            const char* end = p + n;
+            for (const char* line = p; line < end; ) {
+                const char* nl = static_cast<const char*>(std::memchr(line, '\n', std::size_t(end - line)));
+                if (!nl) nl = end;
+                matches += std::regex_search(line, nl, pat.re);
+                line = nl + 1;
+            }
+        }
+    }
+
+    // Everything appended to `t` since the last read, within `budget`
+    // bytes (shared by a file's old and current tail); true if there is more
+    bool read_appended(File& f, Tail& t, std::size_t& budget) {
+        struct stat st;
+        if (fstat(t.fd, &st) == 0 && std::uint64_t(st.st_size) < t.offset) {
+            t.offset = 0;                           // truncated in place
+            t.partial.clear();
+        }
+        for (;;) {
+            // The partial line goes in front of the new data
+            const std::size_t carry = t.partial.size();
+            std::memcpy(buf_.data(), t.partial.data(), carry);
+            ssize_t n = pread(t.fd, buf_.data() + carry, LOG_READ_BLOCK_BYTES, off_t(t.offset));
+            if (n <= 0) return false;
+            t.offset += std::uint64_t(n);
+            const std::size_t have = carry + std::size_t(n);
+            const char* data = buf_.data();
+            const char* last_nl = static_cast<const char*>(memrchr(data, '\n', have));
+            const std::size_t complete = last_nl ? std::size_t(last_nl - data) + 1 : 0;
+            scan(f, data, complete);
+            const std::size_t rest = have - complete;
+            if (rest > LOG_MAX_LINE_BYTES) {
+                // Too long to wait for: counted as a line of its own
+                scan(f, data + complete, rest);
+                ++f.lines;
+                t.partial.clear();
+            } else {
+                t.partial.assign(data + complete, rest);
+            }
+            if (std::size_t(n) < LOG_READ_BLOCK_BYTES) return false;
+            if (budget <= std::size_t(n)) {
+                budget = 0;
+                return true;
+            }
+            budget -= std::size_t(n);
+        }
+    }
+
+    // Mark files from the pending inotify events; false on overflow
+    bool drain_events() {
+        bool ok = true;
+        for (;;) {
+            ssize_t n = read(inotify_fd_, events_, sizeof(events_));
+            if (n <= 0) return ok;
+            for (char* p = events_; p < events_ + n; ) {
+                const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(p);
+                p += sizeof(struct inotify_event) + ev->len;
+                if (ev->mask & IN_Q_OVERFLOW) ok = false;
+                for (File& f : files_) {
+                    if (ev->wd == f.cur.wd) {
+                        f.dirty = true;
+                        if (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF)) f.moved = true;
+                        if (ev->mask & IN_ATTRIB) f.unlinked = true;
+                    } else if (ev->wd == f.old.wd) {
+                        if (ev->mask & IN_ATTRIB) f.unlinked = true;
+                    } else if (ev->wd == f.dir_wd && ev->len > 0 && f.base == ev->name) {
+                        f.reopen = true;
+                    }
+                }
+            }
+        }
+    }
+
+public:
+    LogCollector(std::vector<std::string> paths, const std::vector<std::pair<std::string, std::string>>& patterns)
+        : paths_(std::move(paths)) {
+        for (const auto& np : patterns) {
+            const bool is_regex = np.second.rfind("re:", 0) == 0;
+            const std::string text = is_regex ? np.second.substr(3) : np.second;
+            LogPattern pat{ np.first, is_regex, LiteralScanner(is_regex ? regex_required_literal(text) : text),
+                            std::regex() };
+            if (is_regex) pat.re.assign(text, std::regex::ECMAScript | std::regex::optimize);
+            patterns_.push_back(std::move(pat));
+        }
+    }
+
+    ~LogCollector() override {
+        for (File& f : files_) {
+            if (f.cur.fd >= 0) close(f.cur.fd);
+            if (f.old.fd >= 0) close(f.old.fd);
+        }
+        if (inotify_fd_ >= 0) close(inotify_fd_);
+    }
+
+    const char* name() const override { return "logs"; }
+    unsigned interval_ms() const override { return LOG_COLLECT_MS; }
+    unsigned cost_us() const override { return LOG_COLLECT_COST_US; }
+
+    bool open(StreamTable& streams) override {
+        inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd_ < 0) return false;
+        buf_.resize(LOG_MAX_LINE_BYTES + LOG_READ_BLOCK_BYTES);
+        for (const std::string& path : paths_) {
+            File f;
+            f.path = path;
+            std::size_t slash = path.rfind('/');
+            f.dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+            f.base = slash == std::string::npos ? path : path.substr(slash + 1);
+            // Directories shared by several files get one watch (same wd)
+            f.dir_wd = inotify_add_watch(inotify_fd_, f.dir.c_str(), IN_CREATE | IN_MOVED_TO);
+            if (f.dir_wd < 0) continue;             // no such directory
+            open_file(f, true);
+
+            // Stream names from the file name; a repeated one gets its position
+            std::string label;
+            for (char c : f.base) {
+                bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-';
+                label += plain ? c : '_';
+            }
+            for (const File& other : files_) {
+                if (other.base == f.base) label += "_" + std::to_string(files_.size());
+            }
+            f.line_stream = streams.add("log." + label + ".lines", COUNT_RATE_QUANTUM);
+            for (const LogPattern& pat : patterns_) f.match_stream.push_back(streams.add("log." + label + "." + pat.name));
+            f.matches.assign(patterns_.size(), 0);
+            files_.push_back(std::move(f));
+        }
+        prev_s_ = now_seconds();
+        return !files_.empty();
+    }
+
+    void collect(std::int64_t, SampleSink& sink) override {
+        if (!drain_events()) {
+            for (File& f : files_) f.dirty = true;  // events lost: read everything
+        }
+        for (File& f : files_) {
+            std::size_t budget = LOG_MAX_READ_BYTES;
+            bool more = false;
+            // A rotated-away file is read every time while it is kept
+            if (f.old.fd >= 0) more |= read_appended(f, f.old, budget);
+            const bool rotated = f.moved || f.reopen;
+            if (f.cur.fd >= 0 && (f.dirty || rotated)) more |= read_appended(f, f.cur, budget);
+            if (rotated) {
+                // The file we read is no longer (or no longer alone) under
+                // the name: keep it as the old one, then follow the name.
+                // One rotated away before is done with.
+                f.moved = f.reopen = false;
+                if (f.cur.fd >= 0) {
+                    close_tail(f, f.old);
+                    f.old = std::move(f.cur);
+                    f.cur = Tail();
+                }
+                if (open_file(f, false)) more |= read_appended(f, f.cur, budget);
+            }
+            // A deleted file is read to its end and closed (a new one under
+            // the name is picked up by the directory watch)
+            if (f.unlinked) {
+                f.unlinked = false;
+                if (deleted(f.old)) f.unlinked |= retire(f, f.old, budget);
+                if (deleted(f.cur)) f.unlinked |= retire(f, f.cur, budget);
+            }
+            // So is the old one once the writer has moved on to the new file
+            if (f.old.fd >= 0 && f.cur.fd >= 0 && f.cur.offset > 0) more |= retire(f, f.old, budget);
+            f.dirty = more;
+        }
+
+        const double now_s = now_seconds();
+        const double dt = now_s - prev_s_;
+        if (dt <= 0.0) return;
+        for (File& f : files_) {
+            sink.put(f.line_stream, float(double(f.lines) / dt));
+            f.lines = 0;
+            for (std::size_t k = 0; k < patterns_.size(); ++k) {
+                sink.put(f.match_stream[k], float(double(f.matches[k]) / dt));
+                f.matches[k] = 0;
+            }
+        }
+        prev_s_ = now_s;
+    }
+};
+#endif
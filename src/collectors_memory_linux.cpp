@@ -0,0 +1,202 @@
+#ifdef __linux__
+#include "collector.hpp"
+#include "heap_stats.hpp"
+#include "proc_text.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Memory accounting (--memory[=TARGETS]): what allocators actually hold,
+// rather than resident size alone.
+//
+//   heap.mapped        bytes this process's allocator holds from the OS
+//   heap.in_use        of those, bytes handed out
+//   heap.frag          % of heap.mapped free but not returnable to the OS
+//                      (heap_stats.hpp; HEAP_FREE is the free bytes)
+//
+// and for each target process (a PID, or every process whose comm is a
+// given name), from /proc/[pid]/smaps_rollup, in bytes:
+//
+//   mem.<pid>.<comm>.rss        resident
+//   mem.<pid>.<comm>.anon       resident anonymous: heap, stacks, arenas
+//   mem.<pid>.<comm>.swap       anonymous memory swapped out
+//   mem.<pid>.<comm>.lazyfree   freed with MADV_FREE but not yet reclaimed,
+//                               i.e. allocator caches the kernel may take
+//
+// Anonymous memory climbing while the service's load does not is the usual
+// face of allocator bloat; lazyfree tells it apart from a leak. The rollup
+// is one held fd and one pread per target, parsed in place; the kernel
+// walks the target's mappings to produce it, so the interval is long.
+// Named targets are looked for again every MEMORY_RESCAN_MS, and at once
+// when one of them exits.
+
+namespace {
+
+enum HeapStream { HS_MAPPED, HS_IN_USE, HS_FRAG, HS_STREAMS };
+const char* const HEAP_STREAM_NAMES[HS_STREAMS] = { "heap.mapped", "heap.in_use", "heap.frag" };
+const float HEAP_STREAM_QUANTUM[HS_STREAMS] = { HEAP_QUANTUM, HEAP_QUANTUM, DEFAULT_QUANTUM };
+
+enum RollupField { RF_RSS, RF_ANON, RF_SWAP, RF_LAZYFREE, RF_FIELDS };
+const char* const ROLLUP_KEYS[RF_FIELDS] = { "\nRss:", "\nAnonymous:", "\nSwap:", "\nLazyFree:" };
+const char* const ROLLUP_STREAM_SUFFIX[RF_FIELDS] = { "rss", "anon", "swap", "lazyfree" };
+
+}  // namespace
+
+class MemoryCollector : public Collector {
+    struct Target {
+        int pid{0};
+        int fd{-1};
+        bool named{false};          // found by name, not given as a PID
+        std::uint32_t stream[RF_FIELDS]{StreamTable::NONE, StreamTable::NONE, StreamTable::NONE,
+                                        StreamTable::NONE};
+    };
+
+    std::vector<int> pids_;
+    std::vector<std::string> names_;
+    std::vector<Target> targets_;
+    std::uint32_t heap_stream_[HS_STREAMS]{StreamTable::NONE, StreamTable::NONE, StreamTable::NONE};
+    StreamTable* streams_ = nullptr;
+    std::int64_t next_scan_ms_ = 0;
+    char buf_[2048];
+
+    bool tracked(int pid) const {
+        for (const Target& t : targets_) {
+            if (t.pid == pid) return true;
+        }
+        return false;
+    }
+
+    // comm of `pid` into `comm`; false if gone
+    static bool read_comm(int pid, std::string& comm) {
+        char path[32], text[32];
+        std::snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        ssize_t n = read(fd, text, sizeof(text) - 1);
+        close(fd);
+        if (n <= 0) return false;
+        if (text[n - 1] == '\n') --n;
+        comm.assign(text, std::size_t(n));
+        return true;
+    }
+
+    void track(int pid, bool named) {
+        std::string comm;
+        if (tracked(pid) || !read_comm(pid, comm)) return;
+        char path[40];
+        std::snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", pid);
+        Target t;
+        t.pid = pid;
+        t.named = named;
+        t.fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (t.fd < 0) return;                      // not ours to read, or no rollup (before 4.14)
+        if (pread(t.fd, buf_, sizeof(buf_) - 1, 0) <= 0) {
+            close(t.fd);                           // kernel thread: no memory of its own
+            return;
+        }
+        std::string base = "mem." + std::to_string(pid) + ".";
+        for (std::size_t i = 0; i < comm.size() && i < 16; ++i) {
+            char c = comm[i];
+            bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-';
+            base += plain ? c : '_';
+        }
+        base += '.';
+        for (int f = 0; f < RF_FIELDS; ++f) t.stream[f] = streams_->add(base + ROLLUP_STREAM_SUFFIX[f], MEMORY_QUANTUM);
+        targets_.push_back(t);
+    }
+
+    void untrack(std::size_t k) {
+        Target& t = targets_[k];
+        for (std::uint32_t s : t.stream) streams_->release(s);
+        close(t.fd);
+        targets_[k] = targets_.back();
+        targets_.pop_back();
+    }
+
+    // Processes whose comm is one of names_
+    void scan() {
+        DIR* d = opendir("/proc");
+        if (!d) return;
+        std::string comm;
+        while (struct dirent* de = readdir(d)) {
+            char* end = nullptr;
+            long pid = std::strtol(de->d_name, &end, 10);
+            if (pid <= 0 || *end != '\0' || tracked(int(pid)) || !read_comm(int(pid), comm)) continue;
+            for (const std::string& name : names_) {
+                if (comm == name) {
+                    track(int(pid), true);
+                    break;
+                }
+            }
+        }
+        closedir(d);
+    }
+
+public:
+    explicit MemoryCollector(const std::vector<std::string>& targets) {
+        for (const std::string& t : targets) {
+            char* end = nullptr;
+            long pid = std::strtol(t.c_str(), &end, 10);
+            if (!t.empty() && *end == '\0' && pid > 0) {
+                pids_.push_back(int(pid));
+            } else if (!t.empty()) {
+                names_.push_back(t);
+            }
+        }
+    }
+
+    ~MemoryCollector() override {
+        for (const Target& t : targets_) close(t.fd);
+    }
+
+    const char* name() const override { return "memory"; }
+    unsigned interval_ms() const override { return MEMORY_COLLECT_MS; }
+    unsigned cost_us() const override { return MEMORY_COLLECT_COST_US; }
+
+    bool open(StreamTable& streams) override {
+        streams_ = &streams;
+        HeapStats h;
+        if (read_heap_stats(h)) {
+            for (int s = 0; s < HS_STREAMS; ++s) heap_stream_[s] = streams.add(HEAP_STREAM_NAMES[s], HEAP_STREAM_QUANTUM[s]);
+        }
+        for (int pid : pids_) track(pid, false);
+        if (!names_.empty()) scan();
+        return heap_stream_[0] != StreamTable::NONE || !targets_.empty() || !names_.empty();
+    }
+
+    void collect(std::int64_t now_ms, SampleSink& sink) override {
+        HeapStats h;
+        if (heap_stream_[0] != StreamTable::NONE && read_heap_stats(h)) {
+            sink.put(heap_stream_[HS_MAPPED], float(h.mapped));
+            sink.put(heap_stream_[HS_IN_USE], float(h.in_use));
+            sink.put(heap_stream_[HS_FRAG], heap_fragmentation(h));
+        }
+
+        bool named_gone = false;
+        for (std::size_t k = targets_.size(); k-- > 0; ) {
+            Target& t = targets_[k];
+            ssize_t n = pread(t.fd, buf_, sizeof(buf_) - 1, 0);
+            if (n <= 0) {                          // ESRCH: exited (the fd never reaches a reused PID)
+                named_gone |= t.named;
+                untrack(k);
+                continue;
+            }
+            buf_[n] = '\0';
+            for (int f = 0; f < RF_FIELDS; ++f) {
+                sink.put(t.stream[f], float(field_after(buf_, ROLLUP_KEYS[f]) * 1024));
+            }
+        }
+
+        if (!names_.empty() && (named_gone || now_ms >= next_scan_ms_)) {
+            scan();
+            next_scan_ms_ = now_ms + MEMORY_RESCAN_MS;
+        }
+    }
+};
+#endif
@@ -0,0 +1,179 @@
+#ifdef __linux__
+#include "collector.hpp"
+#include "proc_text.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Per-CPU utilization (--cpus): the aggregate line of /proc/stat turns one
+// core pegged at 100% on a 128-core host into 0.8%, which never alerts.
+// Each online CPU gets four streams, as % of that CPU's time over the
+// interval:
+//
+//   cpu.<n>.util      everything but idle and iowait
+//   cpu.<n>.iowait    idle with I/O outstanding
+//   cpu.<n>.steal     taken by the hypervisor
+//   cpu.<n>.softirq   in softirq handlers
+//
+// One pread of /proc/stat per collection; the "cpuN" lines are parsed in
+// place into structure-of-arrays counters (one array per field, indexed by
+// CPU number), and the deltas and shares are computed by loops over those
+// arrays that use selects rather than branches so they vectorize. CPUs
+// taken offline drop out of /proc/stat and get no value until they are back
+// for two collections.
+
+namespace {
+
+// The /proc/stat fields we keep, in file order (guest time is already
+// included in user and nice)
+enum CpuField { CF_USER, CF_NICE, CF_SYSTEM, CF_IDLE, CF_IOWAIT, CF_IRQ, CF_SOFTIRQ, CF_STEAL, CF_FIELDS };
+
+enum CpuStream { CS_UTIL, CS_IOWAIT, CS_STEAL, CS_SOFTIRQ, CS_STREAMS };
+const char* const CPU_STREAM_SUFFIX[CS_STREAMS] = { "util", "iowait", "steal", "softirq" };
+
+}  // namespace
+
+class PerCpuCollector : public Collector {
+    int fd_ = -1;
+    StreamTable* streams_ = nullptr;
+    std::size_t cpus_ = 0;                  // array length: highest CPU number seen + 1
+    unsigned cur_ = 0;                      // which half of counters_/online_ is this reading
+    std::vector<std::uint64_t> counters_;   // [2][CF_FIELDS][cpus_]
+    std::vector<std::uint8_t> online_;      // [2][cpus_]
+    std::vector<float> delta_;              // [CF_FIELDS][cpus_]
+    std::vector<float> total_;              // [cpus_]
+    std::vector<float> share_;              // [CS_STREAMS][cpus_]
+    std::vector<std::uint32_t> stream_;     // [CS_STREAMS][cpus_]
+    std::vector<char> buf_;
+
+    std::uint64_t* counters(unsigned half, int field) {
+        return counters_.data() + (std::size_t(half) * CF_FIELDS + std::size_t(field)) * cpus_;
+    }
+
+    // Room for CPU numbers below `n`, keeping what was read so far
+    void grow(std::size_t n) {
+        std::vector<std::uint64_t> grown(2 * CF_FIELDS * n, 0);
+        std::vector<std::uint8_t> online(2 * n, 0);
+        std::vector<std::uint32_t> stream(CS_STREAMS * n, StreamTable::NONE);
+        for (unsigned h = 0; h < 2; ++h) {
+            for (int f = 0; f < CF_FIELDS; ++f) {
+                std::memcpy(&grown[(h * CF_FIELDS + f) * n], counters(h, f), cpus_ * sizeof(std::uint64_t));
+            }
+            std::memcpy(&online[h * n], &online_[h * cpus_], cpus_);
+        }
+        for (int s = 0; s < CS_STREAMS; ++s) {
+            std::memcpy(&stream[s * n], &stream_[s * cpus_], cpus_ * sizeof(std::uint32_t));
+        }
+        counters_.swap(grown);
+        online_.swap(online);
+        stream_.swap(stream);
+        delta_.assign(CF_FIELDS * n, 0.0f);
+        total_.assign(n, 0.0f);
+        share_.assign(CS_STREAMS * n, 0.0f);
+        cpus_ = n;
+    }
+
+    // Enough for the aggregate and cpuN lines: ten 20-digit fields each at
+    // most (the rest of the file does not matter), plus the parser's slack
+    std::size_t buffer_bytes() const { return 256 + (cpus_ + 1) * 240 + FIELD_PADDING; }
+
+    // The cpuN lines of one read into `half`; false if unreadable
+    bool parse(unsigned half) {
+        ssize_t n = pread(fd_, buf_.data(), buf_.size() - 1 - FIELD_PADDING, 0);
+        if (n <= 0) return false;
+        std::memset(&buf_[std::size_t(n)], 0, 1 + FIELD_PADDING);
+        std::memset(&online_[half * cpus_], 0, cpus_);
+        const char* p = std::strchr(buf_.data(), '\n');     // past the aggregate line
+        while (p && p[1] == 'c' && p[2] == 'p' && p[3] == 'u' && p[4] >= '0' && p[4] <= '9') {
+            p += 4;
+            std::size_t cpu = std::size_t(next_field(p));
+            if (cpu >= cpus_) grow(cpu + 1);
+            for (int f = 0; f < CF_FIELDS; ++f) counters(half, f)[cpu] = next_field_padded(p);
+            p = std::strchr(p, '\n');
+            if (!p) break;                                   // cut off: buffer too small
+            online_[half * cpus_ + cpu] = 1;
+        }
+        // Hotplugged CPUs past the configured count are read in full next time
+        if (buf_.size() < buffer_bytes()) buf_.resize(buffer_bytes());
+        return true;
+    }
+
+    // Shares of each CPU's time between the two halves' readings; CPUs not
+    // online in both get a zero total and no value
+    void shares() {
+        const std::size_t n = cpus_;
+        const std::uint8_t* on = &online_[cur_ * n];
+        const std::uint8_t* was = &online_[(cur_ ^ 1) * n];
+        float* total = total_.data();
+        for (std::size_t i = 0; i < n; ++i) total[i] = 0.0f;
+        for (int f = 0; f < CF_FIELDS; ++f) {
+            const std::uint64_t* c = counters(cur_, f);
+            const std::uint64_t* p = counters(cur_ ^ 1, f);
+            float* d = delta_.data() + std::size_t(f) * n;
+            for (std::size_t i = 0; i < n; ++i) {
+                // Jiffies per interval fit in 32 bits; a counter going back
+                // (CPU re-added) counts as nothing
+                std::int32_t v = std::int32_t(c[i] - p[i]) & -std::int32_t(on[i] & was[i]);
+                v = v < 0 ? 0 : v;
+                d[i] = float(v);
+                total[i] += d[i];
+            }
+        }
+        // One output per loop keeps the aliasing checks the vectorizer has
+        // to add short. A total of 0 has all-zero parts; adding 1 then only
+        // avoids 0/0 (a compare-and-select would stop the vectorizer).
+        float* scale = total;
+        const float* idle = delta_.data() + CF_IDLE * n;
+        const float* iowait = delta_.data() + CF_IOWAIT * n;
+        float* util = share_.data() + CS_UTIL * n;
+        for (std::size_t i = 0; i < n; ++i) {
+            const float t = total[i];
+            util[i] = (t - idle[i] - iowait[i]) * (100.0f / (t + float(t == 0.0f)));
+        }
+        for (std::size_t i = 0; i < n; ++i) scale[i] = 100.0f / (total[i] + float(total[i] == 0.0f));
+        static const int PART[][2] = { { CS_IOWAIT, CF_IOWAIT }, { CS_STEAL, CF_STEAL }, { CS_SOFTIRQ, CF_SOFTIRQ } };
+        for (const auto& part : PART) {
+            float* out = share_.data() + std::size_t(part[0]) * n;
+            const float* d = delta_.data() + std::size_t(part[1]) * n;
+            for (std::size_t i = 0; i < n; ++i) out[i] = d[i] * scale[i];
+        }
+    }
+
+public:
+    ~PerCpuCollector() override { if (fd_ >= 0) close(fd_); }
+
+    const char* name() const override { return "cpus"; }
+    unsigned interval_ms() const override { return PERCPU_COLLECT_MS; }
+    unsigned cost_us() const override { return PERCPU_COLLECT_COST_US; }
+
+    bool open(StreamTable& streams) override {
+        streams_ = &streams;
+        fd_ = ::open("/proc/stat", O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) return false;
+        long conf = sysconf(_SC_NPROCESSORS_CONF);
+        grow(conf > 0 ? std::size_t(conf) : 1);
+        buf_.resize(buffer_bytes());
+        return parse(cur_);
+    }
+
+    void collect(std::int64_t, SampleSink& sink) override {
+        if (!parse(cur_ ^ 1)) return;
+        cur_ ^= 1;
+        shares();
+        const std::uint8_t* on = &online_[cur_ * cpus_];
+        const std::uint8_t* was = &online_[(cur_ ^ 1) * cpus_];
+        for (std::size_t i = 0; i < cpus_; ++i) {
+            if (!on[i]) continue;
+            if (stream_[i] == StreamTable::NONE) {
+                const std::string base = "cpu." + std::to_string(i) + ".";
+                for (int s = 0; s < CS_STREAMS; ++s) stream_[s * cpus_ + i] = streams_->add(base + CPU_STREAM_SUFFIX[s], CPU_QUANTUM);
+            }
+            if (!was[i]) continue;
+            for (int s = 0; s < CS_STREAMS; ++s) sink.put(stream_[s * cpus_ + i], share_[s * cpus_ + i]);
+        }
+    }
+};
+#endif
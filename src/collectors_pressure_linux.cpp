@@ -0,0 +1,248 @@
+#ifdef __linux__
+#include "collector.hpp"
+#include "diskstats.hpp"
+#include "proc_text.hpp"
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Pressure stall information and the VM counters behind it (--pressure):
+// rather than inferring trouble from memory or CPU percentages, the kernel's
+// own accounting of time tasks spent waiting, from /proc/pressure and
+// /proc/vmstat:
+//
+//   psi.cpu.some              % of the interval some runnable task waited for a CPU
+//   psi.memory.some|full      % some / all non-idle tasks stalled on memory
+//   psi.io.some|full          % some / all non-idle tasks stalled on I/O
+//   vm.pgfault|pgmajfault     page faults/s, all and those that did I/O
+//   vm.pswpin|pswpout         pages swapped in/out per second
+//   vm.pgscan|pgsteal         pages scanned/reclaimed per second (kswapd,
+//                             direct and khugepaged reclaim)
+//   vm.allocstall             allocations/s that stalled in direct reclaim
+//   vm.oom_kill               OOM kills per second
+//
+// Each pressure file also carries a PSI trigger: the kernel signals its fd
+// (POLLPRI) once "some" tasks have stalled PSI_TRIGGER_STALL_PCT % of a
+// window. The fds go into one epoll set, which is this collector's
+// wake_fd(), so a stall runs the collection (and the detector) at the next
+// scheduler tick instead of up to PRESSURE_COLLECT_MS later, and the
+// interval can stay long. The kernel signals a trigger at most once per
+// window. Without trigger support (older kernel, no permission) the files
+// are only polled.
+
+namespace {
+
+enum PsiResource { PSI_CPU, PSI_MEMORY, PSI_IO, PSI_RESOURCES };
+const char* const PSI_RESOURCE_NAMES[PSI_RESOURCES] = { "cpu", "memory", "io" };
+
+enum VmStream { VM_PGFAULT, VM_PGMAJFAULT, VM_PSWPIN, VM_PSWPOUT, VM_PGSCAN, VM_PGSTEAL,
+                VM_ALLOCSTALL, VM_OOM_KILL, VM_STREAMS };
+const char* const VM_STREAM_NAMES[VM_STREAMS] = { "vm.pgfault", "vm.pgmajfault", "vm.pswpin", "vm.pswpout",
+                                                  "vm.pgscan", "vm.pgsteal", "vm.allocstall", "vm.oom_kill" };
+const float VM_STREAM_QUANTUM[VM_STREAMS] = { COUNT_RATE_QUANTUM, DEFAULT_QUANTUM, DEFAULT_QUANTUM, DEFAULT_QUANTUM,
+                                              COUNT_RATE_QUANTUM, COUNT_RATE_QUANTUM, DEFAULT_QUANTUM, DEFAULT_QUANTUM };
+
+// /proc/vmstat lines summed into each stream; a trailing '_' matches every
+// counter with that prefix (allocstall is split by zone). pgscan_anon and
+// pgscan_file split the same pages by type, so the sources are listed.
+struct VmKey {
+    const char* name;
+    VmStream stream;
+};
+const VmKey VM_KEYS[] = {
+    { "pgfault", VM_PGFAULT }, { "pgmajfault", VM_PGMAJFAULT },
+    { "pswpin", VM_PSWPIN }, { "pswpout", VM_PSWPOUT },
+    { "pgscan_kswapd", VM_PGSCAN }, { "pgscan_direct", VM_PGSCAN }, { "pgscan_khugepaged", VM_PGSCAN },
+    { "pgsteal_kswapd", VM_PGSTEAL }, { "pgsteal_direct", VM_PGSTEAL }, { "pgsteal_khugepaged", VM_PGSTEAL },
+    { "allocstall_", VM_ALLOCSTALL }, { "oom_kill", VM_OOM_KILL },
+};
+
+// Stream of the vmstat counter named [name, name + len), VM_STREAMS if none
+VmStream vm_stream_of(const char* name, std::size_t len) {
+    for (const VmKey& k : VM_KEYS) {
+        const std::size_t n = std::strlen(k.name);
+        const bool prefix = k.name[n - 1] == '_';
+        if ((prefix ? len >= n : len == n) && std::memcmp(name, k.name, n) == 0) return k.stream;
+    }
+    return VM_STREAMS;
+}
+
+}  // namespace
+
+class PressureCollector : public Collector {
+    struct Resource {
+        int fd{-1};
+        bool trigger{false};
+        std::uint64_t prev[2]{};                // some, full stall totals (us)
+        std::uint32_t stream[2]{StreamTable::NONE, StreamTable::NONE};
+    };
+
+    Resource psi_[PSI_RESOURCES];
+    int vm_fd_ = -1;
+    int epoll_fd_ = -1;
+    std::uint64_t vm_prev_[VM_STREAMS]{};
+    std::uint32_t vm_stream_[VM_STREAMS];
+    std::vector<char> buf_;
+    double prev_s_ = 0.0;
+
+    // "some" stall of PSI_TRIGGER_STALL_PCT % per window: the configured
+    // window, else the shortest unprivileged processes may use
+    static bool arm_trigger(int fd) {
+        const unsigned windows[] = { PSI_TRIGGER_WINDOW_US, 2000000 };
+        for (unsigned w : windows) {
+            char spec[64];
+            int n = std::snprintf(spec, sizeof(spec), "some %u %u", w / 100 * PSI_TRIGGER_STALL_PCT, w);
+            if (write(fd, spec, std::size_t(n) + 1) > 0) return true;
+        }
+        return false;
+    }
+
+    // Stall totals of one pressure file; false if unreadable
+    bool read_psi(const Resource& r, std::uint64_t total[2]) {
+        char text[256];
+        ssize_t n = pread(r.fd, text, sizeof(text) - 1, 0);
+        if (n <= 0) return false;
+        text[n] = '\0';
+        // "some avg10=.. avg60=.. avg300=.. total=<us>\nfull ..."
+        total[0] = field_after(text, "total=");
+        const char* full = std::strstr(text, "full");
+        total[1] = full ? field_after(full, "total=") : 0;
+        return true;
+    }
+
+    // The counters of VM_KEYS summed per stream, and which streams had any
+    bool read_vmstat(std::uint64_t sum[VM_STREAMS], bool seen[VM_STREAMS]) {
+        if (vm_fd_ < 0 || read_whole(vm_fd_, buf_) < 0) return false;
+        for (int s = 0; s < VM_STREAMS; ++s) {
+            sum[s] = 0;
+            seen[s] = false;
+        }
+        for (const char* p = buf_.data(); *p != '\0'; p = skip_line(p)) {
+            // Every key starts with one of these; skips most lines at once
+            if (*p != 'p' && *p != 'a' && *p != 'o') continue;
+            const char* name = p;
+            while (*p > ' ') ++p;
+            VmStream s = vm_stream_of(name, std::size_t(p - name));
+            if (s == VM_STREAMS) continue;
+            sum[s] += next_field(p);
+            seen[s] = true;
+        }
+        return true;
+    }
+
+public:
+    PressureCollector() {
+        for (std::uint32_t& s : vm_stream_) s = StreamTable::NONE;
+    }
+
+    ~PressureCollector() override {
+        for (const Resource& r : psi_) {
+            if (r.fd >= 0) close(r.fd);
+        }
+        if (vm_fd_ >= 0) close(vm_fd_);
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+    }
+
+    const char* name() const override { return "pressure"; }
+    unsigned interval_ms() const override { return PRESSURE_COLLECT_MS; }
+    unsigned cost_us() const override { return PRESSURE_COLLECT_COST_US; }
+    int wake_fd() const override { return triggers() > 0 ? epoll_fd_ : -1; }
+
+    bool open(StreamTable& streams) override {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        bool any = false;
+        for (int k = 0; k < PSI_RESOURCES; ++k) {
+            Resource& r = psi_[k];
+            const std::string path = std::string("/proc/pressure/") + PSI_RESOURCE_NAMES[k];
+            // Read-write for the trigger; a trigger fd still reads the totals
+            r.fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+            if (r.fd >= 0) {
+                r.trigger = arm_trigger(r.fd);
+            } else {
+                r.fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            }
+            std::uint64_t total[2];
+            if (r.fd < 0 || !read_psi(r, total)) continue;
+            if (r.trigger && epoll_fd_ >= 0) {
+                struct epoll_event ev;
+                std::memset(&ev, 0, sizeof(ev));
+                ev.events = EPOLLPRI;
+                ev.data.u32 = std::uint32_t(k);
+                epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, r.fd, &ev);
+            }
+            // The host-wide cpu "full" line is always zero
+            const std::string base = std::string("psi.") + PSI_RESOURCE_NAMES[k] + ".";
+            r.stream[0] = streams.add(base + "some");
+            if (k != PSI_CPU) r.stream[1] = streams.add(base + "full");
+            r.prev[0] = total[0];
+            r.prev[1] = total[1];
+            any = true;
+        }
+
+        vm_fd_ = ::open("/proc/vmstat", O_RDONLY | O_CLOEXEC);
+        bool seen[VM_STREAMS];
+        if (read_vmstat(vm_prev_, seen)) {
+            for (int s = 0; s < VM_STREAMS; ++s) {
+                if (seen[s]) vm_stream_[s] = streams.add(VM_STREAM_NAMES[s], VM_STREAM_QUANTUM[s]);
+                any |= seen[s];
+            }
+        }
+
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        prev_s_ = double(ts.tv_sec) + double(ts.tv_nsec) / 1e9;
+        return any;
+    }
+
+    void collect(std::int64_t, SampleSink& sink) override {
+        // Clear what woke us; the trigger's event was taken by the poll
+        if (epoll_fd_ >= 0) {
+            struct epoll_event ev[PSI_RESOURCES];
+            while (epoll_wait(epoll_fd_, ev, PSI_RESOURCES, 0) > 0) {}
+        }
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        const double now_s = double(ts.tv_sec) + double(ts.tv_nsec) / 1e9;
+        const double dt = now_s - prev_s_;
+        if (dt <= 0.0) return;
+
+        for (Resource& r : psi_) {
+            std::uint64_t total[2];
+            if (r.stream[0] == StreamTable::NONE || !read_psi(r, total)) continue;
+            for (int h = 0; h < 2; ++h) {
+                // Stall time is in microseconds
+                if (r.stream[h] != StreamTable::NONE && total[h] >= r.prev[h]) {
+                    sink.put(r.stream[h], float(double(total[h] - r.prev[h]) / dt / 1e4));
+                }
+                r.prev[h] = total[h];
+            }
+        }
+
+        std::uint64_t sum[VM_STREAMS];
+        bool seen[VM_STREAMS];
+        if (read_vmstat(sum, seen)) {
+            for (int s = 0; s < VM_STREAMS; ++s) {
+                std::uint64_t d;
+                if (vm_stream_[s] != StreamTable::NONE && seen[s] && counter_delta(vm_prev_[s], sum[s], d)) {
+                    sink.put(vm_stream_[s], float(double(d) / dt));
+                }
+                vm_prev_[s] = sum[s];
+            }
+        }
+        prev_s_ = now_s;
+    }
+
+    // Pressure files with a PSI trigger armed
+    int triggers() const {
+        int n = 0;
+        for (const Resource& r : psi_) n += r.trigger;
+        return n;
+    }
+};
+#endif
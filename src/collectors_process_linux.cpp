@@ -0,0 +1,347 @@
+#ifdef __linux__
+#include "collector.hpp"
+#include "proc_text.hpp"
+#include "fd_budget.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Per-process CPU, resident memory and block I/O for every user-space
+// process (--processes). A scan costs about one syscall per process:
+//
+//  - Each process's files are opened relative to a /proc directory fd held
+//    for the collector's lifetime (openat, no path walk from the root), and
+//    stay open between scans to be re-read with pread at offset 0. When the
+//    fd budget (fd_budget.hpp) runs out, the rest are opened and closed
+//    each scan instead.
+//  - /proc/[pid]/stat comes first: utime + stime of all the process's
+//    threads, and its resident set. A process whose CPU time did not move
+//    since the last scan issued (next to) no I/O, so io is only read for
+//    the ones that ran, which on most hosts is a small minority. (Not
+//    schedstat: it covers the main thread only, which in most servers is
+//    idle while the workers run.)
+//  - PIDs are tracked incrementally. /proc is only listed again when the
+//    last PID allocated (/proc/loadavg) moved, i.e. something was started;
+//    an exited process shows up as ESRCH on its held fd (which also can
+//    never reach a later process reusing the PID), and a changed start
+//    time catches reuse for a process read without a held fd.
+//  - Held files get a slot in the scheduler's BatchReader: the stat of
+//    every process is read in the scheduler's shared batch (prepare()),
+//    then the io of those that ran in a second batch of our own, so the
+//    reads go out in two submissions rather than one by one.
+//  - Parsing works in place in the read buffers: nothing is allocated per
+//    process per scan.
+//
+// Kernel threads are skipped. /proc/[pid]/io is only readable for
+// processes we may ptrace; others get no I/O stream. CPU time comes in
+// clock ticks (USER_HZ), so a scan resolves 1% of a core at 100 Hz.
+
+namespace {
+
+constexpr std::uint32_t PF_KTHREAD = 0x00200000;   // from linux/sched.h
+
+}  // namespace
+
+class ProcessCollector : public Collector {
+    struct Stat {
+        std::uint64_t cpu_ticks;    // utime + stime
+        std::uint64_t start_ticks;  // since boot; identifies this incarnation of the PID
+        std::uint64_t rss_pages;
+        bool kernel_thread;
+        const char* comm;           // into the read buffer, not terminated
+        std::size_t comm_len;
+    };
+
+    // A file of one process: its held fd (-1 if not held), the fd's slot in
+    // the batch reader, and whether the slot was read in this scan's batch
+    struct File {
+        int fd{-1};
+        BatchReader::Slot slot{BatchReader::NONE};
+        bool batched{false};
+    };
+
+    enum class Sched { GONE, IDLE, RAN };
+
+    struct Proc {
+        std::uint64_t start_ticks{0};
+        std::uint64_t prev_cpu_ticks{0};
+        std::uint64_t prev_io_bytes{0};
+        double prev_s{0.0};
+        double prev_io_s{0.0};      // io is not read every scan
+        std::string base;           // "proc.<pid>.<comm>."
+        File stat;
+        File io;
+        std::uint32_t cpu_stream{StreamTable::NONE};
+        std::uint32_t rss_stream{StreamTable::NONE};
+        std::uint32_t io_stream{StreamTable::NONE};
+        std::uint32_t seen{0};
+        bool kernel_thread{false};  // tracked only to skip it
+        bool first_scan{true};      // no previous reading yet
+    };
+
+    int proc_fd_ = -1;
+    int loadavg_fd_ = -1;
+    DIR* dir_ = nullptr;
+    StreamTable* streams_ = nullptr;
+    BatchReader* io_ = nullptr;         // from prepare(); null reads directly
+    std::unordered_map<int, Proc> procs_;
+    std::vector<std::pair<int, Proc*>> ran_;
+    std::uint32_t generation_ = 0;
+    std::uint64_t last_pid_ = 0;
+    bool listed_ = false;
+    std::size_t fds_held_ = 0;
+    std::size_t fd_budget_ = 0;
+    double ticks_per_s_ = 100.0;
+    double page_bytes_ = 4096.0;
+    char path_[32];
+    char buf_[1024];
+
+    // Read a file of process `pid`: the batch's result if its slot was read
+    // in one, else through its held fd if there is one (holding it, with a
+    // slot of `bytes`, if the budget allows). Null once the process is gone.
+    const char* read_file(int pid, const char* file, File& f, std::size_t bytes) {
+        if (f.batched) {
+            f.batched = false;
+            return io_->result(f.slot) > 0 ? io_->data(f.slot) : nullptr;
+        }
+        ssize_t n;
+        if (f.fd >= 0) {
+            n = pread(f.fd, buf_, sizeof(buf_) - 1, 0);
+        } else {
+            std::snprintf(path_, sizeof(path_), "%d/%s", pid, file);
+            int fd = openat(proc_fd_, path_, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return nullptr;
+            n = pread(fd, buf_, sizeof(buf_) - 1, 0);
+            if (n > 0 && fds_held_ < fd_budget_) {
+                f.fd = fd;
+                ++fds_held_;
+                if (io_) f.slot = io_->attach(fd, bytes);
+            } else {
+                close(fd);
+            }
+        }
+        if (n <= 0) return nullptr;
+        buf_[n] = '\0';
+        return buf_;
+    }
+
+    void queue(File& f) {
+        if (f.slot == BatchReader::NONE) return;
+        io_->queue(f.slot);
+        f.batched = true;
+    }
+
+    static bool parse_stat(const char* text, Stat& st) {
+        // "pid (comm) S ppid ..."; comm may itself contain ") "
+        const char* open = std::strchr(text, '(');
+        const char* close = std::strrchr(text, ')');
+        if (!open || !close || close < open) return false;
+        st.comm = open + 1;
+        st.comm_len = std::size_t(close - open - 1);
+        const char* p = close + 2;                 // state (field 3)
+        if (*p == '\0') return false;
+        ++p;
+        std::uint64_t f[22];                       // fields 4..25
+        for (int k = 0; k < 22; ++k) f[k] = next_field(p);
+        st.kernel_thread = (f[9 - 4] & PF_KTHREAD) != 0;
+        st.cpu_ticks = f[14 - 4] + f[15 - 4];
+        st.start_ticks = f[22 - 4];
+        st.rss_pages = f[24 - 4];
+        return true;
+    }
+
+    // Something started since the last listing (or nothing was listed yet)
+    bool pids_allocated() {
+        if (loadavg_fd_ < 0) return true;
+        ssize_t n = pread(loadavg_fd_, buf_, sizeof(buf_) - 1, 0);
+        if (n <= 0) return true;
+        buf_[n] = '\0';
+        const char* p = std::strrchr(buf_, ' ');
+        if (!p) return true;
+        std::uint64_t last = next_field(p);
+        bool moved = !listed_ || last != last_pid_;
+        last_pid_ = last;
+        return moved;
+    }
+
+    void close_fds(Proc& p) {
+        for (File* f : { &p.stat, &p.io }) {
+            if (f->slot != BatchReader::NONE) io_->detach(f->slot);
+            if (f->fd >= 0) {
+                close(f->fd);
+                --fds_held_;
+            }
+            *f = File();
+        }
+    }
+
+    void release(Proc& p) {
+        close_fds(p);
+        streams_->release(p.cpu_stream);
+        streams_->release(p.rss_stream);
+        streams_->release(p.io_stream);
+    }
+
+    void track(int pid, Proc& p, const Stat& st) {
+        p.base = "proc." + std::to_string(pid) + ".";
+        for (std::size_t i = 0; i < st.comm_len && i < 16; ++i) {
+            char c = st.comm[i];
+            bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-';
+            p.base += plain ? c : '_';
+        }
+        p.base += '.';
+        p.start_ticks = st.start_ticks;
+        p.cpu_stream = streams_->add(p.base + "cpu", CPU_QUANTUM);
+        p.rss_stream = streams_->add(p.base + "rss", MEMORY_QUANTUM);
+    }
+
+    // I/O rate since io was last read; the stream appears once io is readable
+    void read_io(int pid, Proc& p, double now_s, SampleSink& sink) {
+        const char* text = read_file(pid, "io", p.io, 512);
+        if (!text) return;                  // not ours to read
+        std::uint64_t bytes = field_after(text, "\nread_bytes:") + field_after(text, "\nwrite_bytes:");
+        const double dt = now_s - p.prev_io_s;
+        if (p.io_stream == StreamTable::NONE) {
+            p.io_stream = streams_->add(p.base + "io", DISK_QUANTUM);
+        } else if (dt > 0.0 && bytes >= p.prev_io_bytes) {
+            sink.put(p.io_stream, float(double(bytes - p.prev_io_bytes) / dt));
+        }
+        p.prev_io_bytes = bytes;
+        p.prev_io_s = now_s;
+    }
+
+    // First look at one process, from stat: CPU and memory are sampled
+    // here, and one that has not run is done; one that ran still needs its
+    // io read
+    Sched check(int pid, Proc& p, double now_s, SampleSink& sink) {
+        if (p.kernel_thread) return Sched::IDLE;   // never re-read (nor its PID reused while it runs)
+        Stat st;
+        const char* text = read_file(pid, "stat", p.stat, 1024);
+        if (!text || !parse_stat(text, st)) return Sched::GONE;
+        if (p.first_scan && st.kernel_thread) {
+            close_fds(p);
+            p.kernel_thread = true;
+            return Sched::IDLE;
+        }
+        if (p.first_scan) {
+            track(pid, p, st);
+        } else if (p.start_ticks != st.start_ticks) {
+            return Sched::GONE;             // PID reused: dropped, listed again as new
+        }
+
+        const double dt = now_s - p.prev_s;
+        if (!p.first_scan && dt > 0.0) {
+            const double cpu_s = double(st.cpu_ticks - p.prev_cpu_ticks) / ticks_per_s_;
+            sink.put(p.cpu_stream, float(100.0 * cpu_s / dt));
+        }
+        sink.put(p.rss_stream, float(double(st.rss_pages) * page_bytes_));
+        const bool ran = p.first_scan || st.cpu_ticks != p.prev_cpu_ticks;
+        p.prev_cpu_ticks = st.cpu_ticks;
+        p.prev_s = now_s;
+        if (ran) return Sched::RAN;
+        // No CPU time since the last scan: no I/O either
+        if (p.io_stream != StreamTable::NONE) sink.put(p.io_stream, 0.0f);
+        return Sched::IDLE;
+    }
+
+    // The io of a process that ran
+    void sample(int pid, Proc& p, double now_s, SampleSink& sink) {
+        read_io(pid, p, now_s, sink);
+        p.first_scan = false;
+    }
+
+public:
+    ~ProcessCollector() override {
+        for (auto& kv : procs_) close_fds(kv.second);
+        if (dir_) closedir(dir_);
+        if (loadavg_fd_ >= 0) close(loadavg_fd_);
+        if (proc_fd_ >= 0) close(proc_fd_);
+    }
+
+    const char* name() const override { return "processes"; }
+    unsigned interval_ms() const override { return PROCESS_COLLECT_MS; }
+    unsigned cost_us() const override { return PROCESS_COLLECT_COST_US; }
+
+    // Every process's stat goes into the scheduler's batch
+    void prepare(BatchReader& io) override {
+        io_ = &io;
+        for (auto& kv : procs_) {
+            if (!kv.second.kernel_thread) queue(kv.second.stat);
+        }
+    }
+
+    bool open(StreamTable& streams) override {
+        streams_ = &streams;
+        proc_fd_ = ::open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (proc_fd_ < 0) return false;
+        // readdir gets its own descriptor; proc_fd_ stays the openat base
+        int dir_fd = dup(proc_fd_);
+        dir_ = dir_fd >= 0 ? fdopendir(dir_fd) : nullptr;
+        if (!dir_) return false;
+        loadavg_fd_ = openat(proc_fd_, "loadavg", O_RDONLY | O_CLOEXEC);
+
+        long hz = sysconf(_SC_CLK_TCK);
+        long page = sysconf(_SC_PAGESIZE);
+        ticks_per_s_ = hz > 0 ? double(hz) : 100.0;
+        page_bytes_ = page > 0 ? double(page) : 4096.0;
+
+        // Two held fds per process, as far as the limit allows
+        fd_budget_ = fd_budget(PROCESS_MAX_HELD_FDS, PROCESS_RESERVED_FDS);
+        return true;
+    }
+
+    void collect(std::int64_t, SampleSink& sink) override {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        const double now_s = double(ts.tv_sec) + double(ts.tv_nsec) / 1e9;
+
+        // List /proc only when there may be new PIDs; a listing also drops
+        // whatever it no longer contains
+        const bool list = pids_allocated();
+        const std::uint32_t gen = ++generation_;
+        if (list) {
+            rewinddir(dir_);
+            while (struct dirent* de = readdir(dir_)) {
+                const char* s = de->d_name;
+                if (*s < '1' || *s > '9') continue;
+                int pid = 0;
+                while (*s >= '0' && *s <= '9') pid = pid * 10 + (*s++ - '0');
+                if (*s != '\0') continue;
+                procs_[pid].seen = gen;
+            }
+            listed_ = true;
+        }
+
+        ran_.clear();
+        for (auto it = procs_.begin(); it != procs_.end(); ) {
+            Proc& p = it->second;
+            Sched s = list && p.seen != gen ? Sched::GONE : check(it->first, p, now_s, sink);
+            if (s == Sched::GONE) {
+                release(p);
+                it = procs_.erase(it);
+                continue;
+            }
+            if (s == Sched::RAN) ran_.emplace_back(it->first, &p);
+            ++it;
+        }
+
+        // io of the ones that ran, in one more batch; one that has exited
+        // since is dropped on the next scan
+        if (io_) {
+            for (auto& r : ran_) queue(r.second->io);
+            io_->submit();
+        }
+        for (auto& r : ran_) sample(r.first, *r.second, now_s, sink);
+    }
+
+    std::size_t tracked() const { return procs_.size(); }
+};
+#endif
@@ -0,0 +1,55 @@
+#include "detector.hpp"
+
+bool parse_scoring_policy(const std::string& name, ScoringPolicy& out) {
+    if (name == "ewma")     { out = ScoringPolicy::EWMA;     return true; }
+    if (name == "robust")   { out = ScoringPolicy::ROBUST;   return true; }
+    if (name == "seasonal") { out = ScoringPolicy::SEASONAL; return true; }
+    if (name == "fixed")    { out = ScoringPolicy::FIXED;    return true; }
+    if (name == "compact")  { out = ScoringPolicy::COMPACT;  return true; }
+    if (name == "cusum")    { out = ScoringPolicy::CUSUM;    return true; }
+    if (name == "page-hinkley") { out = ScoringPolicy::PAGE_HINKLEY; return true; }
+    return false;
+}
+
+bool parse_alerting_policy(const std::string& name, AlertingPolicy& out) {
+    if (name == "hysteresis") { out = AlertingPolicy::HYSTERESIS; return true; }
+    if (name == "quiet")      { out = AlertingPolicy::QUIET_TIME; return true; }
+    if (name == "none")       { out = AlertingPolicy::NONE;       return true; }
+    if (name == "compact")    { out = AlertingPolicy::COMPACT;    return true; }
+    return false;
+}
+
+template <class Scoring>
+static AnyDetector make_with_alerting(AlertingPolicy alerting, std::size_t n) {
+    switch (alerting) {
+        case AlertingPolicy::QUIET_TIME:
+            return AnyDetector::make<Scoring, QuietTimeAlerting>(n);
+        case AlertingPolicy::NONE:
+            return AnyDetector::make<Scoring, ThresholdAlerting>(n);
+        case AlertingPolicy::COMPACT:
+            return AnyDetector::make<Scoring, CompactHysteresisAlerting>(n);
+        case AlertingPolicy::HYSTERESIS:
+        default:
+            return AnyDetector::make<Scoring, HysteresisAlerting>(n);
+    }
+}
+
+AnyDetector make_detector(ScoringPolicy scoring, AlertingPolicy alerting, std::size_t n) {
+    switch (scoring) {
+        case ScoringPolicy::ROBUST:
+            return make_with_alerting<RobustScoring>(alerting, n);
+        case ScoringPolicy::SEASONAL:
+            return make_with_alerting<SeasonalScoring>(alerting, n);
+        case ScoringPolicy::FIXED:
+            return make_with_alerting<FixedPointScoring>(alerting, n);
+        case ScoringPolicy::COMPACT:
+            return make_with_alerting<CompactEWMAScoring>(alerting, n);
+        case ScoringPolicy::CUSUM:
+            return make_with_alerting<CusumScoring>(alerting, n);
+        case ScoringPolicy::PAGE_HINKLEY:
+            return make_with_alerting<PageHinkleyScoring>(alerting, n);
+        case ScoringPolicy::EWMA:
+        default:
+            return make_with_alerting<EWMAScoring>(alerting, n);
+    }
+}
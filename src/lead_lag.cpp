@@ -0,0 +1,118 @@
+#include "lead_lag.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Points a stream needs in the window to be compared at all
+constexpr std::size_t MIN_POINTS = 8;
+
+// Dot product of a[0, n) and b[0, n); eight partial sums so the loop
+// vectorizes without reassociating a single sum
+float dot(const float* a, const float* b, std::size_t n) {
+    float acc[8] = {};
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (int j = 0; j < 8; ++j) acc[j] += a[i + j] * b[i + j];
+    }
+    float r = 0.0f;
+    for (; i < n; ++i) r += a[i] * b[i];
+    for (int j = 0; j < 8; ++j) r += acc[j];
+    return r;
+}
+
+}  // namespace
+
+LeadLagAnalyzer::LeadLagAnalyzer()
+    : target_(CHANGES), candidate_(CHANGES), sum_(BINS), count_(BINS) {}
+
+// Changes between consecutive bins of one stream's level over
+// [from_ms, from_ms + LEAD_WINDOW_MS), scaled to zero mean and unit norm;
+// false if it has too few points there or does not move
+bool LeadLagAnalyzer::changes(const SampleHistory& history, std::size_t stream, std::int64_t from_ms,
+                              float* out) {
+    std::fill(sum_.begin(), sum_.end(), 0.0);
+    std::fill(count_.begin(), count_.end(), 0u);
+    SampleHistory::Cursor cursor = history.read(stream, from_ms);
+    std::int64_t t;
+    float v;
+    std::size_t points = 0;
+    while (cursor.next(t, v)) {
+        const std::int64_t b = (t - from_ms) / LEAD_BIN_MS;
+        if (b >= std::int64_t(BINS)) break;
+        if (b < 0 || !std::isfinite(v)) continue;
+        sum_[std::size_t(b)] += v;
+        ++count_[std::size_t(b)];
+        ++points;
+    }
+    if (points < MIN_POINTS) return false;
+
+    // Bins before the first point take its level, later empty ones hold
+    std::size_t first = 0;
+    while (count_[first] == 0) ++first;
+    double prev = sum_[first] / count_[first];
+    double mean = 0.0;
+    for (std::size_t b = 1; b < BINS; ++b) {
+        const double level = count_[b] ? sum_[b] / count_[b] : prev;
+        out[b - 1] = float(level - prev);
+        mean += level - prev;
+        prev = level;
+    }
+    mean /= double(CHANGES);
+    double norm = 0.0;
+    for (std::size_t k = 0; k < CHANGES; ++k) {
+        const double d = double(out[k]) - mean;
+        norm += d * d;
+    }
+    if (!(norm > 0.0)) return false;
+    const double scale = 1.0 / std::sqrt(norm);
+    for (std::size_t k = 0; k < CHANGES; ++k) out[k] = float((double(out[k]) - mean) * scale);
+    return true;
+}
+
+std::vector<LeadingIndicator> LeadLagAnalyzer::leaders(const SampleHistory& history, std::size_t target,
+                                                       std::int64_t now_ms, std::size_t top) {
+    std::vector<LeadingIndicator> best;
+    // The window's last bin holds now_ms
+    const std::int64_t from_ms = now_ms - std::int64_t(LEAD_WINDOW_MS) + std::int64_t(LEAD_BIN_MS);
+    if (top == 0 || target >= history.size() || !changes(history, target, from_ms, target_.data())) return best;
+    const float* x = target_.data();
+    const float* y = candidate_.data();
+
+    auto consider = [&](std::size_t s) {
+        if (s == target || !changes(history, s, from_ms, candidate_.data())) return;
+        // Lead k: the candidate's change k bins before each of the target's
+        const float same = dot(x, y, CHANGES);
+        float r = 0.0f;
+        std::size_t lag = 0;
+        for (std::size_t k = 1; k <= MAX_LAG && k < CHANGES; ++k) {
+            const float rk = dot(x + k, y, CHANGES - k);
+            if (std::fabs(rk) > std::fabs(r)) {
+                r = rk;
+                lag = k;
+            }
+        }
+        if (std::fabs(r) < LEAD_MIN_R || std::fabs(r) <= std::fabs(same)) return;
+
+        // Keep the strongest `top`, strongest first
+        LeadingIndicator li{ std::uint32_t(s), std::int32_t(lag * LEAD_BIN_MS), r };
+        auto at = std::find_if(best.begin(), best.end(), [&](const LeadingIndicator& o) {
+            return std::fabs(o.r) < std::fabs(r);
+        });
+        if (std::size_t(at - best.begin()) >= top) return;
+        best.insert(at, li);
+        if (best.size() > top) best.pop_back();
+    };
+
+    // Every host metric, then collector streams up to LEAD_MAX_CANDIDATES
+    // in all: past that, each call takes the next slice in turn
+    const std::size_t n = history.size();
+    const std::size_t host = std::min(N_METRICS, n);
+    for (std::size_t s = 0; s < host; ++s) consider(s);
+    const std::size_t others = n - host;
+    const std::size_t scan = std::min(others, LEAD_MAX_CANDIDATES > host ? LEAD_MAX_CANDIDATES - host : 0);
+    if (next_ >= others) next_ = 0;
+    for (std::size_t k = 0; k < scan; ++k) consider(host + (next_ + k) % others);
+    if (others) next_ = (next_ + scan) % others;
+    return best;
+}
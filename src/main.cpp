@@ -2,32 +2,51 @@
 #include "cli_monitor.hpp"
 #include "platform_metrics.hpp"
 #include "config.hpp"
+#include "runtime_config.hpp"
+#include "sample_history.hpp"
+#include "sample_archive.hpp"
+#include "adaptive_sampling.hpp"
+#include "collector.hpp"
+#include "collector_scheduler.hpp"
+#include "realtime.hpp"
+#include "rollup.hpp"
 #include <iostream>
+#include <regex>
+#include <sstream>
 #include <thread>
 #include <chrono>
 #include <csignal>
 #include <memory>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
 
 #ifdef _WIN32
 #include <conio.h>
 #include <windows.h>
 #else
+#include <signal.h>
 #include <termios.h>
 #include <unistd.h>
 #include <fcntl.h>
 #endif
 
-// Global monitor for signal handling
-static CLIMonitor* g_monitor = nullptr;
+// Set by SIGINT/SIGTERM; the main loop sees it, leaves, and shuts down
+// (timeline, archive) on its own thread
+static volatile std::sig_atomic_t g_stop = 0;
 
 // Signal handler for clean exit
-void signal_handler(int signal) {
-    if (g_monitor) {
-        std::cout << "\n\n" << "\033[1m\033[33m" << "Shutting down anomaly detector...\n" << "\033[0m";
-        g_monitor->show_timeline();
-    }
-    exit(0);
+void signal_handler(int) {
+    g_stop = 1;
+}
+
+#ifdef SIGHUP
+// SIGHUP: re-read the config file without restarting
+void reload_signal_handler(int) {
+    request_config_reload();
 }
+#endif
 
 // Check for keyboard input (non-blocking)
 bool check_keyboard_input() {
@@ -57,10 +76,155 @@ bool check_keyboard_input() {
 #endif
 }
 
-int main() {
-    // Setup signal handling
+// Print command-line usage
+void print_usage(const char* prog) {
+    std::cout << "Usage: " << prog << " [--scoring=ewma|robust|seasonal|fixed|compact|cusum|page-hinkley]"
+              << " [--alerting=hysteresis|quiet|none|compact] [--config=PATH]"
+              << " [--journal=DIR|none] [--archive=PATH] [--adaptive] [--multi-rate]"
+              << " [--realtime[=CPU]] [--processes] [--cgroups] [--devices] [--cpus]"
+              << " [--pressure] [--memory[=PID|NAME,...]]"
+              << " [--log=PATH ...] [--log-match=NAME=TEXT|re:REGEX ...]\n";
+}
+
+int main(int argc, char* argv[]) {
+    // Detector policies are chosen once here; the hot loop never dispatches on them
+    ScoringPolicy scoring = ScoringPolicy::EWMA;
+    AlertingPolicy alerting = AlertingPolicy::HYSTERESIS;
+    std::string config_path;
+    std::string journal_dir = JOURNAL_DIR;
+    std::string archive_path;
+    bool adaptive = false;
+    bool multi_rate = false;
+    bool realtime = false;
+    int realtime_cpu = -1;
+    bool processes = false;
+    bool cgroups = false;
+    bool devices = false;
+    bool cpus = false;
+    bool pressure = false;
+    bool memory = false;
+    std::vector<std::string> memory_targets;
+    std::vector<std::string> log_paths;
+    std::vector<std::pair<std::string, std::string>> log_patterns;
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        bool ok = false;
+        if (arg.rfind("--scoring=", 0) == 0) {
+            ok = parse_scoring_policy(arg.substr(std::strlen("--scoring=")), scoring);
+        } else if (arg.rfind("--alerting=", 0) == 0) {
+            ok = parse_alerting_policy(arg.substr(std::strlen("--alerting=")), alerting);
+        } else if (arg.rfind("--config=", 0) == 0) {
+            config_path = arg.substr(std::strlen("--config="));
+            ok = !config_path.empty();
+        } else if (arg.rfind("--journal=", 0) == 0) {
+            journal_dir = arg.substr(std::strlen("--journal="));
+            if (journal_dir == "none") journal_dir.clear();
+            ok = true;
+        } else if (arg.rfind("--archive=", 0) == 0) {
+            archive_path = arg.substr(std::strlen("--archive="));
+            ok = !archive_path.empty();
+        } else if (arg == "--adaptive") {
+            adaptive = true;
+            ok = true;
+        } else if (arg == "--multi-rate") {
+            multi_rate = true;
+            ok = true;
+        } else if (arg == "--realtime") {
+            realtime = true;
+            ok = true;
+        } else if (arg.rfind("--realtime=", 0) == 0) {
+            realtime = true;
+            char* end = nullptr;
+            std::string cpu = arg.substr(std::strlen("--realtime="));
+            realtime_cpu = int(std::strtol(cpu.c_str(), &end, 10));
+            ok = !cpu.empty() && *end == '\0' && realtime_cpu >= 0;
+        } else if (arg == "--processes") {
+            processes = true;
+            ok = true;
+        } else if (arg == "--cgroups") {
+            cgroups = true;
+            ok = true;
+        } else if (arg == "--devices") {
+            devices = true;
+            ok = true;
+        } else if (arg == "--cpus") {
+            cpus = true;
+            ok = true;
+        } else if (arg == "--pressure") {
+            pressure = true;
+            ok = true;
+        } else if (arg == "--memory") {
+            memory = true;
+            ok = true;
+        } else if (arg.rfind("--memory=", 0) == 0) {
+            memory = true;
+            std::stringstream targets(arg.substr(std::strlen("--memory=")));
+            for (std::string t; std::getline(targets, t, ','); ) {
+                if (!t.empty()) memory_targets.push_back(t);
+            }
+            ok = !memory_targets.empty();
+        } else if (arg.rfind("--log=", 0) == 0) {
+            log_paths.push_back(arg.substr(std::strlen("--log=")));
+            ok = !log_paths.back().empty();
+        } else if (arg.rfind("--log-match=", 0) == 0) {
+            std::string spec = arg.substr(std::strlen("--log-match="));
+            std::size_t eq = spec.find('=');
+            ok = eq != std::string::npos && eq > 0 && eq + 1 < spec.size();
+            if (ok && spec.compare(eq + 1, 3, "re:") == 0) {
+                try {
+                    std::regex check(spec.substr(eq + 4));
+                } catch (const std::regex_error&) {
+                    ok = false;
+                }
+            }
+            if (ok) log_patterns.emplace_back(spec.substr(0, eq), spec.substr(eq + 1));
+        }
+        if (!ok) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Runtime tunables: compiled-in defaults and command-line switches,
+    // overridden by the config file
+    RuntimeConfig defaults;
+    defaults.adaptive_sampling = adaptive;
+    // Process, cgroup, device, per-CPU, pressure, memory and log streams
+    // come at their own rate too, whichever host collectors run
+    const bool logs = !log_paths.empty();
+    const bool mixed_rates = multi_rate || processes || cgroups || devices || cpus || pressure || memory || logs;
+    defaults.multi_rate = mixed_rates;
+    RuntimeConfig initial = defaults;
+    if (!config_path.empty()) {
+        std::string error;
+        if (!load_runtime_config(config_path, initial, error)) {
+            std::cerr << "Failed to load config: " << error << "\n";
+            return 1;
+        }
+    }
+    ConfigStore config_store(initial);
+    std::size_t config_reader = config_store.register_reader();
+    ConfigWatcher config_watcher(config_path, config_store);
+    config_watcher.set_defaults(defaults);
+    if (!config_path.empty()) {
+        config_watcher.start();
+    }
+
+    // Setup signal handling. Without SA_RESTART, so Ctrl+C also ends a
+    // blocking read in the interactive menu.
+#ifndef _WIN32
+    struct sigaction stop_action{};
+    stop_action.sa_handler = signal_handler;
+    sigemptyset(&stop_action.sa_mask);
+    sigaction(SIGINT, &stop_action, nullptr);
+    sigaction(SIGTERM, &stop_action, nullptr);
+#else
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+#endif
+#ifdef SIGHUP
+    signal(SIGHUP, reload_signal_handler);
+#endif
     
     // Create platform-specific metrics
     std::unique_ptr<PlatformMetrics> platform = std::unique_ptr<PlatformMetrics>(create_platform_metrics());
@@ -71,57 +235,234 @@ int main() {
     
     std::cout << "Platform: " << platform->get_platform_name() << "\n";
     
-    float vals[N_METRICS], zscores[N_METRICS];
-    AnomalyDetector det;
+    // Collectors: the platform's metrics all at once every sample_ms, or
+    // with --multi-rate one collector per metric at its own interval
+    StreamTable streams;
+    SampleSink sink(streams.size());
+    CollectorScheduler scheduler(steady_now_ms());
+    PlatformCollector* platform_collector = nullptr;
+    if (multi_rate) {
+        for (auto& c : create_platform_collectors(*platform, initial.sample_ms)) {
+            const char* name = c->name();
+            if (!scheduler.add(std::move(c), streams)) {
+                std::cerr << "Collector " << name << " unavailable\n";
+            }
+        }
+    } else {
+        platform_collector = new PlatformCollector(*platform, initial.sample_ms);
+        scheduler.add(std::unique_ptr<Collector>(platform_collector), streams);
+    }
+    // cgroups first: both hold fds, and the process collector takes what is left
+    if (cgroups) {
+        std::unique_ptr<Collector> c = create_cgroup_collector();
+        if (!c || !scheduler.add(std::move(c), streams)) {
+            std::cerr << "cgroup v2 metrics unavailable (no cgroup2 mount)\n";
+        }
+    }
+    if (processes) {
+        std::unique_ptr<Collector> c = create_process_collector();
+        if (!c || !scheduler.add(std::move(c), streams)) {
+            std::cerr << "Per-process metrics unavailable on this platform\n";
+        }
+    }
+    if (devices) {
+        std::unique_ptr<Collector> c = create_device_collector();
+        if (!c || !scheduler.add(std::move(c), streams)) {
+            std::cerr << "Disk and network device metrics unavailable on this platform\n";
+        }
+    }
+    if (cpus) {
+        std::unique_ptr<Collector> c = create_percpu_collector();
+        if (!c || !scheduler.add(std::move(c), streams)) {
+            std::cerr << "Per-CPU metrics unavailable on this platform\n";
+        }
+    }
+    if (pressure) {
+        std::unique_ptr<Collector> c = create_pressure_collector();
+        if (!c || !scheduler.add(std::move(c), streams)) {
+            std::cerr << "Pressure stall metrics unavailable on this platform\n";
+        }
+    }
+    if (memory) {
+        std::unique_ptr<Collector> c = create_memory_collector(memory_targets);
+        if (!c || !scheduler.add(std::move(c), streams)) {
+            std::cerr << "Memory accounting metrics unavailable on this platform\n";
+        }
+    }
+    if (logs) {
+        std::unique_ptr<Collector> c = create_log_collector(log_paths, log_patterns);
+        if (!c || !scheduler.add(std::move(c), streams)) {
+            std::cerr << "Log rates unavailable (no readable log directory, or not supported on this platform)\n";
+        }
+    }
+    std::vector<std::uint32_t> changed_streams;
+    std::vector<std::uint8_t> woken;
+    
+    std::vector<float> zscores(streams.size(), 0.0f);
+    AnyDetector det = make_detector(scoring, alerting, streams.size());
+    det.attach_config(&config_store);
     CLIMonitor monitor;
-    g_monitor = &monitor;
+    monitor.set_config(&config_store);
+    monitor.set_streams(&streams);
+    {
+        std::string error;
+        if (!monitor.open_journal(journal_dir, error)) {
+            std::cerr << "Anomaly journal unavailable (" << error << "), keeping events in memory\n";
+        }
+    }
+    // Collector streams, possibly thousands, keep only a short history and
+    // no rollups (~200 KB a stream); `l` shows the host metrics
+    SampleHistory history(streams.size());
+    history.cap_from(N_METRICS);
+    monitor.set_history(&history);
+    RollupStore rollups(N_METRICS);
+    monitor.set_rollups(&rollups);
+    ArchiveWriter archive;
+    if (!archive_path.empty()) {
+        std::string error;
+        if (!archive.open(archive_path, N_METRICS, error)) {
+            std::cerr << "Sample archive unavailable (" << error << ")\n";
+        }
+    }
     
     unsigned sample_count = 0;
+    AdaptiveSampler sampler;
+    std::int64_t next_adapt_ms = 0;
+    std::int64_t last_display_ms = 0;
+    std::int64_t last_archive_ms = 0;
+    
+    // Low-jitter sampling: this thread collects, so it is the one pinned
+    RealtimeSampler rt;
+    if (realtime) {
+        rt.enter(realtime_cpu);
+        monitor.set_realtime(&rt);
+    }
     
     // Setup the display
     monitor.setup_display();
+    if (realtime && !rt.status().notes.empty()) {
+        std::cerr << "Real-time mode partly unavailable: " << rt.status().notes << "\n";
+    }
     
     std::cout << "\033[1m\033[32m" << "Starting System Anomaly Detector...\n" << "\033[0m";
     std::cout << "Press Ctrl+C to exit and view timeline\n";
     std::cout << "Press 'i' for interactive menu\n\n";
     std::this_thread::sleep_for(std::chrono::seconds(2));
+    const std::int64_t start_ms = steady_now_ms();
     
-    while (true) {
-        platform->sample_system_metrics(vals);
-        bool has_anomaly = det.feed(vals, zscores);
-        
-        ++sample_count;
-        bool ready = (sample_count > WARMUP_SAMPLES);
+    while (!g_stop) {
+        const RuntimeConfig* cfg = config_store.current();
+        std::int64_t now_ms = steady_now_ms();
+        sink.begin_round();
+        scheduler.run_due(now_ms, sink);
         
-        // Update the real-time display
-        monitor.update_display(vals, zscores, sample_count, !ready);
-        
-        // Handle anomalies after warm-up (using hysteresis-aware detection)
-        if (ready && has_anomaly) {
-            for (std::size_t i = 0; i < N_METRICS; ++i) {
-                if (det.is_anomaly_active(i)) {
-                    monitor.handle_anomaly(i, vals[i], zscores[i]);
-                }
+        // Streams that came or went this round start from a fresh baseline,
+        // with the integer step their collector gave them, and an empty
+        // history (a reused id drops the old stream's). History grows with
+        // the table so new streams are leading-indicator candidates.
+        if (streams.take_changed(changed_streams)) {
+            if (streams.size() > det.size()) {
+                det.resize(streams.size());
+                zscores.resize(streams.size(), 0.0f);
+                sink.resize(streams.size());
+            }
+            if (streams.size() > history.size()) history.resize(streams.size());
+            for (std::uint32_t id : changed_streams) {
+                det.reset_stream(id);
+                if (streams.live(id)) det.set_quantum(id, streams.quantum(id));
+                zscores[id] = 0.0f;
+                monitor.reset_stream(id);
+                history.reset(id);
+                if (id < rollups.size()) rollups.reset(id);
             }
         }
         
-        // Check for keyboard input
-        if (check_keyboard_input()) {
-            monitor.set_interactive_mode(true);
-        }
-        
-        // Check for interactive mode toggle
-        if (monitor.is_interactive_mode()) {
-            monitor.show_interactive_menu();
-            monitor.handle_user_input();
+        if (sink.any()) {
+            // Only the streams collected this round move their baselines
+            const float* vals = sink.values();
+            const std::uint8_t* fresh = sink.fresh();
+            for (const auto& c : sink.counters()) det.stage_counter(c.first, c.second);
+            bool has_anomaly = det.feed(vals, zscores.data(), now_ms, fresh);
+            std::int64_t wall_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            if (mixed_rates) {
+                for (std::size_t i = 0; i < history.size(); ++i) {
+                    if (!fresh[i]) continue;
+                    history.append(i, wall_ms, vals[i]);
+                    if (i < rollups.size()) rollups.add(i, wall_ms, vals[i]);
+                }
+            } else {
+                history.append(wall_ms, vals, N_METRICS);
+                rollups.add_row(wall_ms, vals, N_METRICS);
+            }
+            // The archive keeps rows of the latest values, at most one per
+            // sample_ms when streams arrive at different rates
+            if (archive.is_open() && (!mixed_rates || wall_ms - last_archive_ms >= cfg->sample_ms)) {
+                archive.append(wall_ms, vals);
+                last_archive_ms = wall_ms;
+            }
+            
+            // Multi-rate rounds are not samples: count nominal sample_ms
+            // intervals instead
+            sample_count = mixed_rates ? unsigned((now_ms - start_ms) / cfg->sample_ms) : sample_count + 1;
+            bool ready = (sample_count > cfg->warmup_samples);
+            
+            // Redraw and poll the keyboard every sample, or every
+            // DISPLAY_REFRESH_MS when fast collectors drive the loop
+            bool refresh = !mixed_rates || now_ms - last_display_ms >= DISPLAY_REFRESH_MS;
+            if (refresh) {
+                last_display_ms = now_ms;
+                monitor.update_display(vals, zscores.data(), sample_count, !ready);
+            }
+            
+            // Handle anomalies after warm-up (using hysteresis-aware detection).
+            // Streams firing together fold into one incident, reported once.
+            if (ready && has_anomaly) {
+                for (std::size_t i = 0; i < sink.size(); ++i) {
+                    if (fresh[i] && det.is_anomaly_active(i)) {
+                        monitor.handle_anomaly(i, vals[i], zscores[i], now_ms, det.change_onset_ms(i));
+                    }
+                }
+            }
+            monitor.expire_incidents(now_ms);
+            
+            // Adaptive sampling follows the z-scores of every stream, host
+            // and collector, once the baseline is learned, stretching or
+            // shrinking every collector's interval
+            if (cfg->adaptive_sampling) sampler.observe(zscores.data(), sink.size(), *cfg, fresh);
+            if (cfg->adaptive_sampling && now_ms >= next_adapt_ms) {
+                unsigned interval = ready ? sampler.next(*cfg) : sampler.reset(*cfg);
+                scheduler.set_rate_scale(double(interval) / double(cfg->sample_ms));
+                next_adapt_ms = now_ms + interval - SCHEDULER_TICK_MS;
+                monitor.set_sample_interval(interval);
+            } else if (!cfg->adaptive_sampling) {
+                scheduler.set_rate_scale(1.0);
+                monitor.set_sample_interval(0);
+            }
+            
+            if (refresh) {
+                // Check for keyboard input
+                if (check_keyboard_input()) {
+                    monitor.set_interactive_mode(true);
+                }
+                
+                // Check for interactive mode toggle
+                if (monitor.is_interactive_mode() && !g_stop) {
+                    monitor.show_interactive_menu();
+                    monitor.handle_user_input();
+                }
+            }
         }
         
-        // Sleep between samples
-        std::this_thread::sleep_for(
-            std::chrono::milliseconds(SAMPLE_MS)
-        );
+        // Sleep until the next collector is due, or one asks to run early
+        if (platform_collector) platform_collector->set_interval_ms(cfg->sample_ms);
+        config_store.quiescent(config_reader);
+        if (rt.sleep_until(scheduler.next_due_ms(), scheduler.wake_fds(), woken)) scheduler.wake(woken);
     }
     
+    std::cout << "\n\n" << "\033[1m\033[33m" << "Shutting down anomaly detector...\n" << "\033[0m";
+    monitor.show_timeline();
+    archive.close();
     platform->cleanup();
     return 0;
 }
\ No newline at end of file
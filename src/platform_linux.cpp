@@ -1,11 +1,12 @@
 #ifdef __linux__
 #include "platform_metrics.hpp"
 #include "metrics.hpp"
+#include "diskstats.hpp"
+#include "heap_stats.hpp"
 
 // Linux headers
 #include <sys/sysinfo.h>
 #include <sys/statvfs.h>
-#include <sys/resource.h>
 #include <time.h>
 #include <cstring>
 #include <fstream>
@@ -20,9 +21,10 @@ private:
     unsigned long long prev_idle_ = 0;
     bool have_prev_cpu_ = false;
 
-    // For Disk I/O rate
-    struct rusage prev_rusage_;
-    bool have_prev_rusage_ = false;
+    // For Disk I/O rate: the host's physical disks
+    HostDiskBytes disks_;
+    std::uint64_t prev_disk_bytes_ = 0;
+    bool have_prev_disk_ = false;
 
     // For rate timing
     struct timespec prev_ts_;
@@ -34,7 +36,8 @@ public:
     bool initialize() override {
         have_prev_ts_ = false;
         have_prev_cpu_ = false;
-        have_prev_rusage_ = false;
+        have_prev_disk_ = false;
+        disks_.open();
         return true;
     }
     
@@ -42,7 +45,8 @@ public:
         // ----- 1) UPTIME_MS -----
         struct timespec ts;
         if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
-            out[UPTIME_MS] = ts.tv_sec * 1000.0f + ts.tv_nsec / 1e6f;
+            uptime_ms_ = std::uint64_t(ts.tv_sec) * 1000u + std::uint64_t(ts.tv_nsec) / 1000000u;
+            out[UPTIME_MS] = float(uptime_ms_);
         } else {
             out[UPTIME_MS] = 0.0f;
         }
@@ -115,44 +119,22 @@ public:
 
         // ----- 4) DISK_IO_RATE (bytes/sec) -----
         {
-            struct rusage usage;
-            if (getrusage(RUSAGE_SELF, &usage) != 0 || dt <= 0.0f || !have_prev_rusage_) {
+            std::uint64_t bytes = 0;
+            bool ok = disks_.read(bytes);
+            if (!ok || dt <= 0.0f || !have_prev_disk_ || bytes < prev_disk_bytes_) {
                 out[DISK_IO_RATE] = 0.0f;
             } else {
-                long d_in    = usage.ru_inblock  - prev_rusage_.ru_inblock;
-                long d_out   = usage.ru_oublock  - prev_rusage_.ru_oublock;
-                long d_blocks= (d_in < 0 || d_out < 0) ? 0 : (d_in + d_out);
-
-                constexpr float BLOCK_SZ = 512.0f;  // bytes per block
-                out[DISK_IO_RATE] = (d_blocks * BLOCK_SZ) / dt;
+                out[DISK_IO_RATE] = float(double(bytes - prev_disk_bytes_) / dt);
             }
-            prev_rusage_      = usage;
-            have_prev_rusage_ = true;
+            prev_disk_bytes_ = bytes;
+            have_prev_disk_  = ok;
         }
 
         // ----- 5) HEAP_FREE (bytes) -----
         {
-            // For Linux, we'll use process memory info from /proc/self/status
-            std::ifstream file("/proc/self/status");
-            if (file.is_open()) {
-                std::string line;
-                unsigned long vm_rss = 0;  // Resident Set Size in KB
-                
-                while (std::getline(file, line)) {
-                    if (line.substr(0, 6) == "VmRSS:") {
-                        std::istringstream iss(line.substr(6));
-                        iss >> vm_rss;
-                        break;
-                    }
-                }
-                
-                // Convert KB to bytes and estimate heap free
-                // This is a rough estimate since Linux doesn't have a direct heap free metric
-                unsigned long total_heap = vm_rss * 1024;  // Convert KB to bytes
-                out[HEAP_FREE] = float(total_heap * 0.3f);  // Estimate 30% as free
-            } else {
-                out[HEAP_FREE] = 0.0f;
-            }
+            // Free bytes held by this process's allocator
+            HeapStats h;
+            out[HEAP_FREE] = read_heap_stats(h) ? float(h.free) : 0.0f;
         }
     }
     
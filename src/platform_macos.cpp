@@ -39,7 +39,8 @@ public:
         // ----- 1) UPTIME_MS -----
         struct timespec ts;
         if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
-            out[UPTIME_MS] = ts.tv_sec * 1000.0f + ts.tv_nsec / 1e6f;
+            uptime_ms_ = std::uint64_t(ts.tv_sec) * 1000u + std::uint64_t(ts.tv_nsec) / 1000000u;
+            out[UPTIME_MS] = float(uptime_ms_);
         } else {
             out[UPTIME_MS] = 0.0f;
         }
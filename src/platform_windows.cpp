@@ -56,6 +56,7 @@ public:
         LARGE_INTEGER freq, ts;
         QueryPerformanceFrequency(&freq);
         QueryPerformanceCounter(&ts);
+        uptime_ms_ = GetTickCount64();
         
         if (have_prev_ts_) {
             LONGLONG delta = ts.QuadPart - prev_ts_.QuadPart;
@@ -0,0 +1,219 @@
+#include "realtime.hpp"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <cerrno>
+#include <fstream>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#endif
+
+void RealtimeSampler::record(double late_us) {
+    p50_.add(late_us);
+    p99_.add(late_us);
+    max_us_ = late_us > max_us_ ? late_us : max_us_;
+}
+
+#ifdef __linux__
+namespace {
+
+cpu_set_t g_original_affinity;
+bool g_have_original_affinity = false;
+
+void note(std::string& notes, const std::string& what) {
+    if (!notes.empty()) notes += "; ";
+    notes += what;
+}
+
+// Touch the stack the sampler may grow into, so the first deep call during
+// a spike does not fault; with `lock`, also lock it (true if that worked)
+bool prefault_stack(bool lock) {
+    volatile unsigned char stack[REALTIME_STACK_PREFAULT];
+    for (std::size_t i = 0; i < sizeof(stack); i += 4096) stack[i] = 0;
+    return lock && mlock(const_cast<unsigned char*>(stack), sizeof(stack)) == 0;
+}
+
+// Whether locked memory is unbounded for us: no RLIMIT_MEMLOCK, or
+// CAP_IPC_LOCK in the effective set (/proc/self/status CapEff, bit 14)
+bool memlock_unlimited(std::uint64_t& limit_bytes) {
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_MEMLOCK, &lim) != 0) return false;
+    limit_bytes = std::uint64_t(lim.rlim_cur);
+    if (lim.rlim_cur == RLIM_INFINITY) return true;
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 7, "CapEff:") == 0) {
+            return (std::stoull(line.substr(7), nullptr, 16) >> 14) & 1;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+bool RealtimeSampler::enter(int cpu) {
+    status_ = Status();
+
+    // Pin: the chosen core, else the highest one currently allowed
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        g_original_affinity = allowed;
+        g_have_original_affinity = true;
+        if (cpu < 0) {
+            for (int c = CPU_SETSIZE - 1; c >= 0; --c) {
+                if (CPU_ISSET(c, &allowed)) {
+                    cpu = c;
+                    break;
+                }
+            }
+        }
+    }
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        if (sched_setaffinity(0, sizeof(one), &one) == 0) {
+            status_.cpu = cpu;
+        } else {
+            note(status_.notes, "CPU " + std::to_string(cpu) + " not pinned (" + std::strerror(errno) + ")");
+        }
+    } else {
+        note(status_.notes, "no CPU to pin to");
+    }
+
+    // SCHED_FIFO where permitted (capped by RLIMIT_RTPRIO when unprivileged)
+    struct sched_param sp;
+    std::memset(&sp, 0, sizeof(sp));
+    int max_prio = sched_get_priority_max(SCHED_FIFO);
+    sp.sched_priority = REALTIME_PRIORITY < max_prio ? REALTIME_PRIORITY : max_prio;
+    if (sched_setscheduler(0, SCHED_FIFO, &sp) == 0) {
+        status_.priority = sp.sched_priority;
+    } else {
+        note(status_.notes, std::string("SCHED_FIFO not permitted (") + std::strerror(errno) + ")");
+    }
+
+    // Lock what is mapped now, and whatever is mapped later only if locked
+    // memory is unbounded: under a finite RLIMIT_MEMLOCK, MCL_FUTURE makes
+    // later growth (journal segments, history blocks, new streams) fail
+    // with ENOMEM. Failing the current pages, lock the sampler's stack.
+    // Freed heap is kept mapped so it never has to be faulted back in.
+    std::uint64_t limit = 0;
+    const bool unlimited = memlock_unlimited(limit);
+    if (mlockall(unlimited ? MCL_CURRENT | MCL_FUTURE : MCL_CURRENT) == 0) {
+        status_.memory_locked = true;
+        if (!unlimited) {
+            note(status_.notes, "pages mapped later not locked (RLIMIT_MEMLOCK " +
+                                std::to_string(limit / 1024) + " KiB)");
+        }
+#ifdef __GLIBC__
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+#endif
+        prefault_stack(false);
+    } else {
+        std::string why = std::strerror(errno);
+        if (!unlimited) why += ", RLIMIT_MEMLOCK " + std::to_string(limit / 1024) + " KiB";
+        note(status_.notes, "memory not locked (" + why + ")" +
+                            (prefault_stack(true) ? ", sampler stack locked" : ""));
+    }
+
+    active_ = true;
+    return status_.notes.empty();
+}
+
+void RealtimeSampler::sleep_until(std::int64_t due_ms) {
+    if (!active_) {
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::milliseconds(due_ms)));
+        return;
+    }
+    // steady_clock is CLOCK_MONOTONIC here. A deadline already behind us is
+    // an overrun of the loop, not scheduling latency: not recorded.
+    struct timespec due, now;
+    due.tv_sec = time_t(due_ms / 1000);
+    due.tv_nsec = long(due_ms % 1000) * 1000000L;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec > due.tv_sec || (now.tv_sec == due.tv_sec && now.tv_nsec >= due.tv_nsec)) return;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, nullptr) == EINTR) {}
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    record(double(now.tv_sec - due.tv_sec) * 1e6 + double(now.tv_nsec - due.tv_nsec) / 1e3);
+}
+
+bool RealtimeSampler::sleep_until(std::int64_t due_ms, const std::vector<int>& wake,
+                                  std::vector<std::uint8_t>& woken) {
+    woken.assign(wake.size(), 0);
+    if (wake.empty()) {
+        sleep_until(due_ms);
+        return false;
+    }
+    polls_.resize(wake.size());
+    for (std::size_t k = 0; k < wake.size(); ++k) polls_[k] = { wake[k], POLLIN | POLLPRI, 0 };
+
+    // ppoll's timeout is relative: recomputed from the absolute deadline
+    // after every interruption
+    const std::int64_t due_ns = due_ms * 1000000;
+    struct timespec now;
+    std::int64_t left_ns;
+    for (;;) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        left_ns = due_ns - (std::int64_t(now.tv_sec) * 1000000000 + now.tv_nsec);
+        if (left_ns <= 0) return false;
+        struct timespec left;
+        left.tv_sec = time_t(left_ns / 1000000000);
+        left.tv_nsec = long(left_ns % 1000000000);
+        int n = ppoll(polls_.data(), nfds_t(polls_.size()), &left, nullptr);
+        if (n > 0) {
+            for (std::size_t k = 0; k < polls_.size(); ++k) woken[k] = polls_[k].revents != 0;
+            return true;
+        }
+        if (n == 0) break;
+        if (errno != EINTR) {
+            sleep_until(due_ms);
+            return false;
+        }
+    }
+    if (active_) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        record(double(std::int64_t(now.tv_sec) * 1000000000 + now.tv_nsec - due_ns) / 1e3);
+    }
+    return false;
+}
+
+void leave_realtime() {
+    struct sched_param sp;
+    std::memset(&sp, 0, sizeof(sp));
+    sched_setscheduler(0, SCHED_OTHER, &sp);
+    if (g_have_original_affinity) sched_setaffinity(0, sizeof(g_original_affinity), &g_original_affinity);
+}
+
+#else
+
+bool RealtimeSampler::enter(int) {
+    status_ = Status();
+    status_.notes = "real-time mode is only available on Linux";
+    return false;
+}
+
+void RealtimeSampler::sleep_until(std::int64_t due_ms) {
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::milliseconds(due_ms)));
+}
+
+bool RealtimeSampler::sleep_until(std::int64_t due_ms, const std::vector<int>& wake,
+                                  std::vector<std::uint8_t>& woken) {
+    woken.assign(wake.size(), 0);
+    sleep_until(due_ms);
+    return false;
+}
+
+void leave_realtime() {}
+
+#endif
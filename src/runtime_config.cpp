@@ -0,0 +1,332 @@
+#include "runtime_config.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <climits>
+#endif
+
+// ---------------------------------------------------------------------------
+// Config file parsing
+// ---------------------------------------------------------------------------
+
+static std::string trim(const std::string& s) {
+    const char* ws = " \t\r\n";
+    std::size_t b = s.find_first_not_of(ws);
+    if (b == std::string::npos) return "";
+    std::size_t e = s.find_last_not_of(ws);
+    return s.substr(b, e - b + 1);
+}
+
+static bool parse_float(const std::string& text, float& out) {
+    char* end = nullptr;
+    errno = 0;
+    float v = std::strtof(text.c_str(), &end);
+    if (errno != 0 || end == text.c_str() || *end != '\0') return false;
+    out = v;
+    return true;
+}
+
+static bool parse_unsigned(const std::string& text, unsigned& out) {
+    char* end = nullptr;
+    errno = 0;
+    unsigned long v = std::strtoul(text.c_str(), &end, 10);
+    if (errno != 0 || end == text.c_str() || *end != '\0' || text[0] == '-') return false;
+    out = static_cast<unsigned>(v);
+    return true;
+}
+
+// Map "cpu_threshold" / "cpu_hysteresis" etc. to a metric index
+static int metric_key_index(const std::string& prefix) {
+    static const char* prefixes[N_METRICS] = { "cpu", "ram", "disk", "heap", "uptime" };
+    for (std::size_t i = 0; i < N_METRICS; ++i) {
+        if (prefix == prefixes[i]) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool load_runtime_config(const std::string& path, RuntimeConfig& out, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    RuntimeConfig cfg = out;
+    std::string line;
+    unsigned line_no = 0;
+    while (std::getline(file, line)) {
+        ++line_no;
+        std::size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        std::size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            error = path + ":" + std::to_string(line_no) + ": expected key = value";
+            return false;
+        }
+        std::string key = trim(line.substr(0, eq));
+        std::string value = trim(line.substr(eq + 1));
+
+        bool ok = false;
+        if (key == "ewma_alpha") {
+            ok = parse_float(value, cfg.ewma_alpha) && cfg.ewma_alpha > 0.0f && cfg.ewma_alpha < 1.0f;
+        } else if (key == "z_threshold") {
+            ok = parse_float(value, cfg.z_threshold) && cfg.z_threshold > 0.0f;
+        } else if (key == "hysteresis_threshold") {
+            ok = parse_float(value, cfg.hysteresis_threshold) && cfg.hysteresis_threshold > 0.0f;
+        } else if (key == "min_quiet_time_ms") {
+            ok = parse_unsigned(value, cfg.min_quiet_time_ms);
+        } else if (key == "hysteresis_samples") {
+            ok = parse_unsigned(value, cfg.hysteresis_samples) && cfg.hysteresis_samples > 0;
+        } else if (key == "warmup_samples") {
+            ok = parse_unsigned(value, cfg.warmup_samples);
+        } else if (key == "sample_ms") {
+            ok = parse_unsigned(value, cfg.sample_ms) && cfg.sample_ms > 0;
+        } else if (key == "adaptive_sampling") {
+            unsigned on = 0;
+            ok = parse_unsigned(value, on) && on <= 1;
+            cfg.adaptive_sampling = on != 0;
+        } else if (key == "adaptive_min_ms") {
+            ok = parse_unsigned(value, cfg.adaptive_min_ms) && cfg.adaptive_min_ms > 0;
+        } else if (key == "adaptive_max_ms") {
+            ok = parse_unsigned(value, cfg.adaptive_max_ms) && cfg.adaptive_max_ms > 0;
+        } else {
+            std::size_t us = key.rfind('_');
+            int idx = (us == std::string::npos) ? -1 : metric_key_index(key.substr(0, us));
+            std::string kind = (us == std::string::npos) ? "" : key.substr(us + 1);
+            if (idx >= 0 && kind == "threshold") {
+                ok = parse_float(value, cfg.thresholds[idx]) && cfg.thresholds[idx] > 0.0f;
+            } else if (idx >= 0 && kind == "hysteresis") {
+                ok = parse_float(value, cfg.hysteresis[idx]) && cfg.hysteresis[idx] > 0.0f;
+            } else {
+                error = path + ":" + std::to_string(line_no) + ": unknown key '" + key + "'";
+                return false;
+            }
+        }
+        if (!ok) {
+            error = path + ":" + std::to_string(line_no) + ": bad value for '" + key + "'";
+            return false;
+        }
+    }
+
+    if (cfg.hysteresis_threshold > cfg.z_threshold) {
+        // Alerts would clear above where they fire, i.e. never
+        error = path + ": hysteresis_threshold above z_threshold";
+        return false;
+    }
+    if (cfg.adaptive_min_ms > cfg.adaptive_max_ms) {
+        error = path + ": adaptive_min_ms above adaptive_max_ms";
+        return false;
+    }
+    for (std::size_t i = 0; i < N_METRICS; ++i) {
+        if (cfg.hysteresis[i] > cfg.thresholds[i]) {
+            error = path + ": hysteresis above threshold for metric " + std::to_string(i);
+            return false;
+        }
+    }
+
+    out = cfg;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// ConfigStore
+// ---------------------------------------------------------------------------
+
+ConfigStore::ConfigStore(const RuntimeConfig& initial) {
+    RuntimeConfig* first = new RuntimeConfig(initial);
+    first->generation = next_generation_++;
+    current_.store(first, std::memory_order_release);
+    for (auto& r : readers_) r.store(0, std::memory_order_relaxed);
+}
+
+ConfigStore::~ConfigStore() {
+    for (const RuntimeConfig* cfg : retired_) delete cfg;
+    delete current_.load(std::memory_order_acquire);
+}
+
+std::size_t ConfigStore::register_reader() {
+    std::size_t id = n_readers_.load(std::memory_order_relaxed);
+    if (id >= MAX_READERS) {
+        std::cerr << "ConfigStore: too many readers\n";
+        std::abort();
+    }
+    readers_[id].store(current()->generation, std::memory_order_release);
+    n_readers_.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+std::uint64_t ConfigStore::publish(const RuntimeConfig& next) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    RuntimeConfig* snapshot = new RuntimeConfig(next);
+    snapshot->generation = next_generation_++;
+    const RuntimeConfig* old = current_.exchange(snapshot, std::memory_order_acq_rel);
+    retired_.push_back(old);
+    reclaim();
+    return snapshot->generation;
+}
+
+void ConfigStore::reclaim() {
+    // Oldest generation any reader may still hold
+    std::uint64_t min_seen = current()->generation;
+    std::size_t n = n_readers_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < n; ++i) {
+        min_seen = std::min(min_seen, readers_[i].load(std::memory_order_acquire));
+    }
+
+    auto keep = std::remove_if(retired_.begin(), retired_.end(),
+        [min_seen](const RuntimeConfig* cfg) {
+            if (cfg->generation < min_seen) {
+                delete cfg;
+                return true;
+            }
+            return false;
+        });
+    retired_.erase(keep, retired_.end());
+    n_retired_.store(retired_.size(), std::memory_order_release);
+}
+
+void ConfigStore::try_reclaim() {
+    std::unique_lock<std::mutex> lock(writer_mutex_, std::try_to_lock);
+    if (lock.owns_lock()) reclaim();
+}
+
+// ---------------------------------------------------------------------------
+// ConfigWatcher
+// ---------------------------------------------------------------------------
+
+// Self-pipe written by request_config_reload (from a signal handler)
+static std::atomic<int> g_reload_fd{-1};
+static int g_reload_pipe[2] = {-1, -1};
+
+void request_config_reload() {
+#ifndef _WIN32
+    int fd = g_reload_fd.load(std::memory_order_relaxed);
+    if (fd >= 0) {
+        char c = 1;
+        ssize_t r = write(fd, &c, 1);
+        (void)r;
+    }
+#endif
+}
+
+ConfigWatcher::ConfigWatcher(std::string path, ConfigStore& store)
+    : path_(std::move(path)), store_(store) {}
+
+ConfigWatcher::~ConfigWatcher() {
+    stop();
+}
+
+bool ConfigWatcher::start() {
+#ifdef _WIN32
+    return false;
+#else
+    if (thread_.joinable()) return true;
+    if (pipe(stop_pipe_) != 0) return false;
+    if (g_reload_pipe[0] < 0) {
+        if (pipe(g_reload_pipe) != 0) return false;
+        fcntl(g_reload_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(g_reload_pipe[1], F_SETFL, O_NONBLOCK);
+        g_reload_fd.store(g_reload_pipe[1], std::memory_order_relaxed);
+    }
+
+#ifdef __linux__
+    // Watch the directory so editors that write a temp file and rename it
+    // over the config are seen too
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ >= 0) {
+        std::size_t slash = path_.rfind('/');
+        std::string dir = (slash == std::string::npos) ? "." : path_.substr(0, slash);
+        if (inotify_add_watch(inotify_fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            close(inotify_fd_);
+            inotify_fd_ = -1;
+        }
+    }
+#endif
+
+    thread_ = std::thread(&ConfigWatcher::run, this);
+    return true;
+#endif
+}
+
+void ConfigWatcher::stop() {
+#ifndef _WIN32
+    if (!thread_.joinable()) return;
+    char c = 1;
+    ssize_t r = write(stop_pipe_[1], &c, 1);
+    (void)r;
+    thread_.join();
+    close(stop_pipe_[0]);
+    close(stop_pipe_[1]);
+    stop_pipe_[0] = stop_pipe_[1] = -1;
+    if (inotify_fd_ >= 0) {
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+    }
+#endif
+}
+
+void ConfigWatcher::reload() {
+    // Start from the defaults so keys removed from the file revert
+    RuntimeConfig next = defaults_;
+    std::string error;
+    if (!load_runtime_config(path_, next, error)) {
+        std::cerr << "Config reload failed, keeping current settings: " << error << "\n";
+        return;
+    }
+    store_.publish(next);
+}
+
+void ConfigWatcher::run() {
+#ifndef _WIN32
+    std::string name = path_.substr(path_.rfind('/') == std::string::npos ? 0 : path_.rfind('/') + 1);
+
+    while (true) {
+        struct pollfd fds[3];
+        nfds_t n = 0;
+        fds[n++] = { stop_pipe_[0], POLLIN, 0 };
+        fds[n++] = { g_reload_pipe[0], POLLIN, 0 };
+        if (inotify_fd_ >= 0) fds[n++] = { inotify_fd_, POLLIN, 0 };
+
+        if (poll(fds, n, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[0].revents) return;
+
+        bool changed = false;
+        if (fds[1].revents & POLLIN) {
+            char buf[64];
+            while (read(g_reload_pipe[0], buf, sizeof(buf)) == sizeof(buf)) {}
+            changed = true;
+        }
+#ifdef __linux__
+        if (n > 2 && (fds[2].revents & POLLIN)) {
+            alignas(struct inotify_event) char buf[4096];
+            ssize_t len;
+            while ((len = read(inotify_fd_, buf, sizeof(buf))) > 0) {
+                for (char* p = buf; p < buf + len; ) {
+                    auto* ev = reinterpret_cast<struct inotify_event*>(p);
+                    if (ev->len > 0 && name == ev->name) changed = true;
+                    p += sizeof(struct inotify_event) + ev->len;
+                }
+            }
+        }
+#endif
+        if (changed) reload();
+    }
+#endif
+}
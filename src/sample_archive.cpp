@@ -0,0 +1,449 @@
+#include "sample_archive.hpp"
+#include "bf16.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char FILE_MAGIC[8] = { 'A', 'N', 'O', 'M', 'A', 'R', 'C', '1' };
+
+// Payloads are padded to 8 bytes with at least 4 to spare, so the value
+// decoder can always load a whole word
+constexpr std::size_t LOAD_SLACK = 4;
+
+std::size_t padded(std::size_t n) {
+    return (n + LOAD_SLACK + 7) / 8 * 8;
+}
+
+void put_varint(std::vector<unsigned char>& out, std::uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<unsigned char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(v));
+}
+
+std::uint64_t get_varint(const unsigned char*& p) {
+    std::uint64_t v = 0;
+    unsigned shift = 0;
+    for (;;) {
+        unsigned char b = *p++;
+        v |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+        shift += 7;
+    }
+}
+
+std::uint64_t zigzag(std::int64_t v) {
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+std::int64_t unzigzag(std::uint64_t v) {
+    return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+}
+
+// Significant low bytes of an XOR (0 when the value repeats)
+unsigned xor_bytes(std::uint32_t x) {
+    return (x > 0xFFFFFFu) + (x > 0xFFFFu) + (x > 0xFFu) + (x != 0);
+}
+
+void pad_to(std::vector<unsigned char>& out, std::size_t start, std::size_t payload) {
+    out.resize(start + padded(payload), 0);
+}
+
+// Value column: control nibbles (byte count per value, two per byte), then
+// the XOR bytes, little-endian
+void encode_xor(const float* v, std::size_t rows, std::vector<unsigned char>& out) {
+    std::size_t control = out.size();
+    out.resize(control + (rows + 1) / 2, 0);
+    std::uint32_t prev = 0;
+    for (std::size_t i = 0; i < rows; ++i) {
+        std::uint32_t bits = float_bits(v[i]);
+        std::uint32_t x = bits ^ prev;
+        prev = bits;
+        unsigned n = xor_bytes(x);
+        out[control + i / 2] |= static_cast<unsigned char>(n << ((i & 1) * 4));
+        for (unsigned k = 0; k < n; ++k) out.push_back(static_cast<unsigned char>(x >> (8 * k)));
+    }
+}
+
+void decode_xor(const unsigned char* p, std::size_t rows, float* out) {
+    const unsigned char* control = p;
+    const unsigned char* data = p + (rows + 1) / 2;
+    std::uint32_t prev = 0;
+    for (std::size_t i = 0; i < rows; ++i) {
+        unsigned n = (control[i / 2] >> ((i & 1) * 4)) & 0xF;
+        std::uint32_t word;
+        std::memcpy(&word, data, sizeof(word));
+        // n == 4 must keep the whole word; shift in two steps to stay defined
+        std::uint32_t mask = ~((0xFFFFFFFFu << (4 * n)) << (4 * n));
+        prev ^= word & mask;
+        data += n;
+        out[i] = bits_float(prev);
+    }
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Writer
+// ---------------------------------------------------------------------------
+
+ArchiveWriter::~ArchiveWriter() {
+    close();
+}
+
+bool ArchiveWriter::open(const std::string& path, std::size_t columns, std::string& error) {
+    close();
+#ifdef _WIN32
+    (void)path;
+    (void)columns;
+    error = "sample archive is not supported on this platform";
+    return false;
+#else
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        error = path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    off_t end = sizeof(ArchiveFileHeader);
+    ArchiveFileHeader fh;
+    if (st.st_size == 0) {
+        std::memcpy(fh.magic, FILE_MAGIC, sizeof(fh.magic));
+        fh.columns = static_cast<std::uint32_t>(columns);
+        fh.block_rows = ARCHIVE_BLOCK_ROWS;
+        if (pwrite(fd, &fh, sizeof(fh), 0) != static_cast<ssize_t>(sizeof(fh))) {
+            error = path + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+    } else {
+        if (pread(fd, &fh, sizeof(fh), 0) != static_cast<ssize_t>(sizeof(fh)) ||
+            std::memcmp(fh.magic, FILE_MAGIC, sizeof(fh.magic)) != 0) {
+            error = path + ": not a sample archive";
+            ::close(fd);
+            return false;
+        }
+        if (fh.columns != columns || fh.block_rows > ARCHIVE_BLOCK_ROWS) {
+            error = path + ": archive has " + std::to_string(fh.columns) + " columns, expected " +
+                    std::to_string(columns);
+            ::close(fd);
+            return false;
+        }
+        // Walk the blocks and drop a torn one at the end
+        ArchiveBlockHeader bh;
+        while (pread(fd, &bh, sizeof(bh), end) == static_cast<ssize_t>(sizeof(bh)) &&
+               bh.magic == ARCHIVE_BLOCK_MAGIC && bh.rows <= fh.block_rows &&
+               bh.bytes >= sizeof(bh) && end + static_cast<off_t>(bh.bytes) <= st.st_size) {
+            end += bh.bytes;
+        }
+        if (end != st.st_size && ftruncate(fd, end) != 0) {
+            error = path + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+    }
+    if (lseek(fd, end, SEEK_SET) < 0) {
+        error = path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    fd_ = fd;
+    columns_ = columns;
+    times_.clear();
+    times_.reserve(ARCHIVE_BLOCK_ROWS);
+    values_.assign(columns, std::vector<float>());
+    for (std::vector<float>& v : values_) v.reserve(ARCHIVE_BLOCK_ROWS);
+    return true;
+#endif
+}
+
+void ArchiveWriter::close() {
+    if (fd_ < 0) return;
+    flush();
+#ifndef _WIN32
+    ::close(fd_);
+#endif
+    fd_ = -1;
+}
+
+bool ArchiveWriter::append(std::int64_t t_ms, const float* values) {
+    if (fd_ < 0) return false;
+    if (!times_.empty() && t_ms < times_.back()) t_ms = times_.back();
+    times_.push_back(t_ms);
+    for (std::size_t c = 0; c < columns_; ++c) values_[c].push_back(values[c]);
+    if (times_.size() >= ARCHIVE_BLOCK_ROWS || t_ms - times_.front() >= ARCHIVE_FLUSH_MS) {
+        return flush();
+    }
+    return true;
+}
+
+bool ArchiveWriter::flush() {
+    if (fd_ < 0 || times_.empty()) return true;
+    const std::size_t rows = times_.size();
+
+    block_.assign(sizeof(ArchiveBlockHeader), 0);
+    ArchiveBlockHeader bh;
+    bh.magic = ARCHIVE_BLOCK_MAGIC;
+    bh.rows = static_cast<std::uint32_t>(rows);
+    bh.first_ms = times_.front();
+    bh.last_ms = times_.back();
+
+    // Timestamps after the first: zigzag delta-of-delta
+    std::size_t start = block_.size();
+    std::int64_t prev = times_[0], prev_delta = 0;
+    for (std::size_t i = 1; i < rows; ++i) {
+        std::int64_t delta = times_[i] - prev;
+        put_varint(block_, zigzag(delta - prev_delta));
+        prev = times_[i];
+        prev_delta = delta;
+    }
+    bh.time_bytes = static_cast<std::uint32_t>(block_.size() - start);
+    pad_to(block_, start, bh.time_bytes);
+
+    for (std::size_t c = 0; c < columns_; ++c) {
+        const float* v = values_[c].data();
+        ArchiveColumnHeader ch;
+        ch.min = v[0];
+        ch.max = v[0];
+        bool constant = true;
+        for (std::size_t i = 1; i < rows; ++i) {
+            ch.min = v[i] < ch.min ? v[i] : ch.min;
+            ch.max = v[i] > ch.max ? v[i] : ch.max;
+            constant = constant && float_bits(v[i]) == float_bits(v[0]);
+        }
+
+        std::size_t header_at = block_.size();
+        block_.resize(header_at + sizeof(ch));
+        start = block_.size();
+        if (constant) {
+            ch.encoding = ArchiveEncoding::CONST;
+            // The value itself; min alone would lose -0.0 and NaN payloads
+            block_.resize(start + sizeof(float));
+            std::memcpy(block_.data() + start, v, sizeof(float));
+            ch.bytes = sizeof(float);
+        } else {
+            ch.encoding = ArchiveEncoding::XOR;
+            encode_xor(v, rows, block_);
+            ch.bytes = static_cast<std::uint32_t>(block_.size() - start);
+            if (ch.bytes >= rows * sizeof(float)) {
+                ch.encoding = ArchiveEncoding::RAW;
+                ch.bytes = static_cast<std::uint32_t>(rows * sizeof(float));
+                block_.resize(start + ch.bytes);
+                std::memcpy(block_.data() + start, v, ch.bytes);
+            }
+        }
+        std::memcpy(block_.data() + header_at, &ch, sizeof(ch));
+        pad_to(block_, start, ch.bytes);
+    }
+
+    bh.bytes = static_cast<std::uint32_t>(block_.size());
+    std::memcpy(block_.data(), &bh, sizeof(bh));
+
+    times_.clear();
+    for (std::vector<float>& v : values_) v.clear();
+
+#ifndef _WIN32
+    // One write per block; a crash leaves at most one torn block at the end
+    const unsigned char* p = block_.data();
+    std::size_t left = block_.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd_, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        left -= static_cast<std::size_t>(n);
+    }
+#endif
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+// ---------------------------------------------------------------------------
+
+ArchiveReader::~ArchiveReader() {
+    close();
+}
+
+bool ArchiveReader::open(const std::string& path, std::string& error) {
+    close();
+#ifdef _WIN32
+    (void)path;
+    error = "sample archive is not supported on this platform";
+    return false;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ArchiveFileHeader))) {
+        error = path + ": not a sample archive";
+        ::close(fd);
+        return false;
+    }
+    ArchiveFileHeader fh;
+    if (pread(fd, &fh, sizeof(fh), 0) != static_cast<ssize_t>(sizeof(fh)) ||
+        std::memcmp(fh.magic, FILE_MAGIC, sizeof(fh.magic)) != 0 || fh.columns == 0 ||
+        fh.block_rows == 0) {
+        error = path + ": not a sample archive";
+        ::close(fd);
+        return false;
+    }
+
+    // Index the block headers with pread, so skipping a block never touches
+    // its pages; a torn block ends the archive
+    std::size_t bytes = static_cast<std::size_t>(st.st_size);
+    std::size_t at = sizeof(ArchiveFileHeader);
+    IndexEntry entry;
+    while (at + sizeof(ArchiveBlockHeader) <= bytes &&
+           pread(fd, &entry.header, sizeof(entry.header), static_cast<off_t>(at)) ==
+               static_cast<ssize_t>(sizeof(entry.header))) {
+        const ArchiveBlockHeader& bh = entry.header;
+        if (bh.magic != ARCHIVE_BLOCK_MAGIC || bh.rows == 0 || bh.rows > fh.block_rows ||
+            bh.bytes < sizeof(ArchiveBlockHeader) || bh.bytes > bytes - at) {
+            break;
+        }
+        entry.offset = at;
+        blocks_.push_back(entry);
+        rows_ += bh.rows;
+        at += bh.bytes;
+    }
+
+    void* map = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        error = path + ": " + std::strerror(errno);
+        blocks_.clear();
+        rows_ = 0;
+        return false;
+    }
+    madvise(map, bytes, MADV_SEQUENTIAL);
+    map_ = static_cast<const unsigned char*>(map);
+    bytes_ = bytes;
+    columns_ = fh.columns;
+    block_rows_ = fh.block_rows;
+
+    // Decode buffers for one block, cache-line aligned for the kernels
+    std::size_t scratch_bytes = (columns_ + 1) * block_rows_ * sizeof(std::int64_t);
+    scratch_ = static_cast<unsigned char*>(std::aligned_alloc(64, (scratch_bytes + 63) / 64 * 64));
+    times_ = reinterpret_cast<std::int64_t*>(scratch_);
+    column_ready_.assign(columns_, 0);
+    column_ptr_.assign(columns_, nullptr);
+    current_.reader_ = this;
+    current_.columns_.assign(columns_, nullptr);
+    return true;
+#endif
+}
+
+void ArchiveReader::close() {
+#ifndef _WIN32
+    if (map_) munmap(const_cast<unsigned char*>(map_), bytes_);
+#endif
+    std::free(scratch_);
+    map_ = nullptr;
+    scratch_ = nullptr;
+    times_ = nullptr;
+    bytes_ = 0;
+    columns_ = 0;
+    block_rows_ = 0;
+    rows_ = 0;
+    blocks_.clear();
+    current_index_ = SIZE_MAX;
+    released_ = 0;
+}
+
+const ArchiveReader::Block& ArchiveReader::block(std::size_t b) const {
+    if (b == current_index_) return current_;
+    const ArchiveBlockHeader* bh = &blocks_[b].header;
+    const std::size_t offset = blocks_[b].offset;
+    current_.header_ = bh;
+    current_.time_data_ = map_ + offset + sizeof(ArchiveBlockHeader);
+    const unsigned char* p = current_.time_data_ + padded(bh->time_bytes);
+    for (std::size_t c = 0; c < columns_; ++c) {
+        const ArchiveColumnHeader* ch = reinterpret_cast<const ArchiveColumnHeader*>(p);
+        current_.columns_[c] = ch;
+        p += sizeof(ArchiveColumnHeader) + padded(ch->bytes);
+    }
+    current_index_ = b;
+    times_ready_ = false;
+#ifndef _WIN32
+    std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::size_t until = offset / page * page;
+    if (until > released_) {
+        madvise(const_cast<unsigned char*>(map_) + released_, until - released_, MADV_DONTNEED);
+    }
+    released_ = until;
+#endif
+    std::fill(column_ready_.begin(), column_ready_.end(), 0);
+    return current_;
+}
+
+void ArchiveReader::decode_times(const Block& b) const {
+    const std::size_t rows = b.rows();
+    const unsigned char* p = b.time_data_;
+    std::int64_t t = b.first_ms(), delta = 0;
+    times_[0] = t;
+    for (std::size_t i = 1; i < rows; ++i) {
+        delta += unzigzag(get_varint(p));
+        t += delta;
+        times_[i] = t;
+    }
+    times_ready_ = true;
+}
+
+void ArchiveReader::decode_column(const Block& b, std::size_t c) const {
+    const ArchiveColumnHeader* ch = b.columns_[c];
+    const unsigned char* payload = reinterpret_cast<const unsigned char*>(ch + 1);
+    const std::size_t rows = b.rows();
+    float* out = reinterpret_cast<float*>(scratch_ + (c + 1) * block_rows_ * sizeof(std::int64_t));
+    switch (ch->encoding) {
+    case ArchiveEncoding::RAW:
+        // Already a float array in the map
+        column_ptr_[c] = reinterpret_cast<const float*>(payload);
+        break;
+    case ArchiveEncoding::CONST: {
+        float v;
+        std::memcpy(&v, payload, sizeof(v));
+        std::fill(out, out + rows, v);
+        column_ptr_[c] = out;
+        break;
+    }
+    case ArchiveEncoding::XOR:
+        decode_xor(payload, rows, out);
+        column_ptr_[c] = out;
+        break;
+    }
+    column_ready_[c] = 1;
+}
+
+const std::int64_t* ArchiveReader::Block::timestamps() const {
+    if (!reader_->times_ready_) reader_->decode_times(*this);
+    return reader_->times_;
+}
+
+const float* ArchiveReader::Block::column(std::size_t c) const {
+    if (!reader_->column_ready_[c]) reader_->decode_column(*this, c);
+    return reader_->column_ptr_[c];
+}
@@ -0,0 +1,245 @@
+#include "sample_history.hpp"
+#include "bf16.hpp"
+#include <cstring>
+
+namespace {
+
+// Worst case for one point: '1111' + 32-bit delta-of-delta, '11' + 5 + 5 +
+// 32-bit value; a block's first point is a raw 64-bit time and 32-bit value
+constexpr std::size_t MAX_POINT_BITS = 4 + 32 + 2 + 5 + 5 + 32;
+constexpr std::size_t FIRST_POINT_BITS = 64 + 32;
+
+// Sentinel leading-zero count: no XOR window established yet in this block
+constexpr unsigned NO_WINDOW = 33;
+
+unsigned leading_zeros32(std::uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_clz(x));
+#else
+    unsigned n = 0;
+    while (!(x & 0x80000000u)) { x <<= 1; ++n; }
+    return n;
+#endif
+}
+
+unsigned trailing_zeros32(std::uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctz(x));
+#else
+    unsigned n = 0;
+    while (!(x & 1u)) { x >>= 1; ++n; }
+    return n;
+#endif
+}
+
+// MSB-first bit append; the block is zeroed when (re)started
+void put_bits(std::uint64_t* words, std::size_t& pos, std::uint64_t v, unsigned n) {
+    if (n == 0) return;
+    std::size_t w = pos >> 6;
+    unsigned used = static_cast<unsigned>(pos & 63);
+    unsigned space = 64 - used;
+    if (n <= space) {
+        words[w] |= v << (space - n);
+    } else {
+        words[w] |= v >> (n - space);
+        words[w + 1] |= v << (64 - (n - space));
+    }
+    pos += n;
+}
+
+} // namespace
+
+void SampleHistory::start_block(Stream& s, std::int64_t t_ms, std::uint32_t bits, std::size_t max_blocks) {
+    Block* b;
+    if (s.used < max_blocks) {
+        if (s.ring.size() == s.used) {
+            s.ring.emplace_back();
+            s.ring.back().words.reset(new std::uint64_t[BLOCK_WORDS + 1]);
+        }
+        b = &s.ring[(s.head + s.used) % s.ring.size()];
+        ++s.used;
+    } else {
+        // Full: the oldest block becomes the newest
+        b = &s.ring[s.head];
+        s.head = (s.head + 1) % s.ring.size();
+    }
+    std::memset(b->words.get(), 0, (BLOCK_WORDS + 1) * sizeof(std::uint64_t));
+    b->bits = 0;
+    put_bits(b->words.get(), b->bits, static_cast<std::uint64_t>(t_ms), 64);
+    put_bits(b->words.get(), b->bits, bits, 32);
+    b->count = 1;
+    b->first_ms = t_ms;
+    b->last_ms = t_ms;
+
+    s.prev_ms = t_ms;
+    s.prev_delta = 0;
+    s.prev_bits = bits;
+    s.prev_leading = NO_WINDOW;
+    s.prev_trailing = 0;
+}
+
+void SampleHistory::append(std::size_t stream, std::int64_t t_ms, float value) {
+    Stream& s = streams_[stream];
+    std::uint32_t bits = float_bits(value);
+    const std::size_t max_blocks = stream < capped_from_ ? HISTORY_MAX_BLOCKS : HISTORY_COLLECTOR_BLOCKS;
+    if (s.used == 0) {
+        start_block(s, t_ms, bits, max_blocks);
+        return;
+    }
+    if (t_ms < s.prev_ms) t_ms = s.prev_ms;
+
+    Block& b = s.ring[(s.head + s.used - 1) % s.ring.size()];
+    std::int64_t delta = t_ms - s.prev_ms;
+    std::int64_t dod = delta - s.prev_delta;
+    if (b.bits + MAX_POINT_BITS > BLOCK_WORDS * 64 || dod > INT32_MAX || dod < INT32_MIN) {
+        start_block(s, t_ms, bits, max_blocks);
+        return;
+    }
+
+    std::uint64_t* w = b.words.get();
+    std::size_t& pos = b.bits;
+
+    // Timestamp: delta-of-delta in the smallest bucket that holds it
+    if (dod == 0) {
+        put_bits(w, pos, 0x0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        put_bits(w, pos, 0x2, 2);
+        put_bits(w, pos, static_cast<std::uint64_t>(dod + 63), 7);
+    } else if (dod >= -255 && dod <= 256) {
+        put_bits(w, pos, 0x6, 3);
+        put_bits(w, pos, static_cast<std::uint64_t>(dod + 255), 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        put_bits(w, pos, 0xE, 4);
+        put_bits(w, pos, static_cast<std::uint64_t>(dod + 2047), 12);
+    } else {
+        put_bits(w, pos, 0xF, 4);
+        put_bits(w, pos, static_cast<std::uint32_t>(static_cast<std::int32_t>(dod)), 32);
+    }
+
+    // Value: XOR with the previous one; reuse the previous window of
+    // meaningful bits when the new XOR fits inside it
+    std::uint32_t x = bits ^ s.prev_bits;
+    if (x == 0) {
+        put_bits(w, pos, 0x0, 1);
+    } else {
+        unsigned leading = leading_zeros32(x);
+        unsigned trailing = trailing_zeros32(x);
+        if (s.prev_leading != NO_WINDOW && leading >= s.prev_leading && trailing >= s.prev_trailing) {
+            put_bits(w, pos, 0x2, 2);
+            put_bits(w, pos, x >> s.prev_trailing, 32 - s.prev_leading - s.prev_trailing);
+        } else {
+            unsigned len = 32 - leading - trailing;
+            put_bits(w, pos, 0x3, 2);
+            put_bits(w, pos, leading, 5);
+            put_bits(w, pos, len - 1, 5);
+            put_bits(w, pos, x >> trailing, len);
+            s.prev_leading = leading;
+            s.prev_trailing = trailing;
+        }
+    }
+
+    s.prev_delta = delta;
+    s.prev_ms = t_ms;
+    s.prev_bits = bits;
+    ++b.count;
+    b.last_ms = t_ms;
+}
+
+SampleHistory::Cursor SampleHistory::read(std::size_t stream, std::int64_t from_ms) const {
+    const Stream& s = streams_[stream];
+    // First block that reaches from_ms
+    std::size_t lo = 0, hi = s.used;
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (block_at(s, mid).last_ms < from_ms) lo = mid + 1; else hi = mid;
+    }
+    return Cursor(&s, lo, from_ms);
+}
+
+std::size_t SampleHistory::points(std::size_t stream) const {
+    const Stream& s = streams_[stream];
+    std::size_t n = 0;
+    for (std::size_t k = 0; k < s.used; ++k) n += block_at(s, k).count;
+    return n;
+}
+
+std::size_t SampleHistory::encoded_bytes(std::size_t stream) const {
+    const Stream& s = streams_[stream];
+    std::size_t n = 0;
+    for (std::size_t k = 0; k < s.used; ++k) n += (block_at(s, k).bits + 7) / 8;
+    return n;
+}
+
+std::size_t SampleHistory::allocated_bytes(std::size_t stream) const {
+    return streams_[stream].ring.size() * (BLOCK_WORDS + 1) * sizeof(std::uint64_t);
+}
+
+std::int64_t SampleHistory::oldest_ms(std::size_t stream) const {
+    const Stream& s = streams_[stream];
+    return s.used ? block_at(s, 0).first_ms : INT64_MAX;
+}
+
+// ---------------------------------------------------------------------------
+// Decoding
+// ---------------------------------------------------------------------------
+
+SampleHistory::Cursor::Cursor(const Stream* s, std::size_t block, std::int64_t from_ms)
+    : stream_(s), block_(block), from_ms_(from_ms) {}
+
+bool SampleHistory::Cursor::open_block() {
+    if (block_ >= stream_->used) return false;
+    const Block& b = block_at(*stream_, block_++);
+    words_ = b.words.get();
+    pos_ = 0;
+    left_ = b.count;
+    first_ = true;
+    return left_ > 0;
+}
+
+// MSB-first read of n <= 64 bits; blocks carry one spare word for lookahead
+std::uint64_t SampleHistory::Cursor::read(unsigned n) {
+    if (n == 0) return 0;
+    std::size_t w = pos_ >> 6;
+    unsigned used = static_cast<unsigned>(pos_ & 63);
+    unsigned space = 64 - used;
+    std::uint64_t r = (words_[w] << used) >> (64 - n);
+    if (n > space) r |= words_[w + 1] >> (64 - (n - space));
+    pos_ += n;
+    return r;
+}
+
+bool SampleHistory::Cursor::next(std::int64_t& t_ms, float& value) {
+    for (;;) {
+        if (left_ == 0 && !open_block()) return false;
+        --left_;
+        if (first_) {
+            t_ = static_cast<std::int64_t>(read(64));
+            bits_ = static_cast<std::uint32_t>(read(32));
+            delta_ = 0;
+            first_ = false;
+        } else {
+            std::int64_t dod;
+            if (read(1) == 0)      dod = 0;
+            else if (read(1) == 0) dod = static_cast<std::int64_t>(read(7)) - 63;
+            else if (read(1) == 0) dod = static_cast<std::int64_t>(read(9)) - 255;
+            else if (read(1) == 0) dod = static_cast<std::int64_t>(read(12)) - 2047;
+            else                   dod = static_cast<std::int32_t>(static_cast<std::uint32_t>(read(32)));
+            delta_ += dod;
+            t_ += delta_;
+
+            if (read(1) != 0) {
+                if (read(1) != 0) {
+                    leading_ = static_cast<unsigned>(read(5));
+                    unsigned len = static_cast<unsigned>(read(5)) + 1;
+                    trailing_ = 32 - leading_ - len;
+                }
+                unsigned len = 32 - leading_ - trailing_;
+                bits_ ^= static_cast<std::uint32_t>(read(len) << trailing_);
+            }
+        }
+        if (t_ < from_ms_) continue;
+        t_ms = t_;
+        value = bits_float(bits_);
+        return true;
+    }
+}
@@ -0,0 +1,366 @@
+#include "timeline_export.hpp"
+#include "realtime.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::size_t BLOCK_BYTES = 1 << 20;   // one write() per block
+constexpr std::size_t BLOCK_ALIGN = 4096;      // O_DIRECT buffer/offset alignment
+constexpr std::size_t MAX_LINE_BYTES = 512;    // slack past a block for one encoded record
+constexpr std::size_t CHUNK_RECORDS = 4096;    // records pulled from the source at a time
+
+bool ends_with(const std::string& s, const char* suffix) {
+    std::size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+// Append-only output file written in whole aligned blocks
+class BlockWriter {
+public:
+    BlockWriter()
+        : buf_(static_cast<char*>(::operator new(BLOCK_BYTES + MAX_LINE_BYTES,
+                                                 std::align_val_t(BLOCK_ALIGN)))) {}
+
+    ~BlockWriter() {
+        close_file();
+        ::operator delete(buf_, std::align_val_t(BLOCK_ALIGN));
+    }
+
+    bool open(const std::string& path, std::string& error) {
+#ifndef _WIN32
+        int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+        fd_ = ::open(path.c_str(), flags | O_DIRECT, 0644);
+        direct_ = fd_ >= 0;
+#endif
+        if (fd_ < 0) fd_ = ::open(path.c_str(), flags, 0644);
+        if (fd_ < 0) {
+            error = path + ": " + std::strerror(errno);
+            return false;
+        }
+#else
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) {
+            error = path + ": " + std::strerror(errno);
+            return false;
+        }
+        std::setvbuf(file_, nullptr, _IONBF, 0);
+#endif
+        return true;
+    }
+
+    // Room for at least MAX_LINE_BYTES past the returned pointer
+    char* cursor() { return buf_ + used_; }
+    void advance(std::size_t n) { used_ += n; }
+
+    // Write out the full block once one has accumulated
+    bool maybe_flush(std::string& error) {
+        if (used_ < BLOCK_BYTES) return true;
+        if (!write_all(buf_, BLOCK_BYTES, error)) return false;
+        used_ -= BLOCK_BYTES;
+        std::memmove(buf_, buf_ + BLOCK_BYTES, used_);
+        return true;
+    }
+
+    // Write the partial last block and close
+    bool finish(std::string& error) {
+        drop_direct();
+        bool ok = write_all(buf_, used_, error);
+        used_ = 0;
+        return close_file() && ok;
+    }
+
+    std::uint64_t bytes() const { return written_ + used_; }
+
+private:
+    // Unaligned tails cannot go through O_DIRECT
+    void drop_direct() {
+#if !defined(_WIN32) && defined(O_DIRECT)
+        if (direct_) {
+            fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+            direct_ = false;
+        }
+#endif
+    }
+
+    bool write_all(const char* p, std::size_t n, std::string& error) {
+#ifndef _WIN32
+        while (n > 0) {
+            ssize_t r = ::write(fd_, p, n);
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0 && errno == EINVAL && direct_) {
+                // Filesystem accepted O_DIRECT at open but not for writes
+                drop_direct();
+                continue;
+            }
+            if (r <= 0) {
+                error = std::strerror(r < 0 ? errno : EIO);
+                return false;
+            }
+            p += r;
+            n -= static_cast<std::size_t>(r);
+            written_ += static_cast<std::uint64_t>(r);
+        }
+        return true;
+#else
+        if (std::fwrite(p, 1, n, file_) != n) {
+            error = std::strerror(errno);
+            return false;
+        }
+        written_ += n;
+        return true;
+#endif
+    }
+
+    bool close_file() {
+#ifndef _WIN32
+        if (fd_ < 0) return true;
+        int r = ::close(fd_);
+        fd_ = -1;
+        return r == 0;
+#else
+        if (!file_) return true;
+        int r = std::fclose(file_);
+        file_ = nullptr;
+        return r == 0;
+#endif
+    }
+
+    char* buf_;
+    std::size_t used_{0};
+    std::uint64_t written_{0};
+#ifndef _WIN32
+    int fd_{-1};
+    bool direct_{false};
+#else
+    std::FILE* file_{nullptr};
+#endif
+};
+
+// "2026-01-31T12:34:56" for a unix second, cached across records
+class IsoSeconds {
+public:
+    const char* format(std::int64_t sec) {
+        if (sec == last_ && text_[0] != '\0') return text_;
+        std::time_t t = static_cast<std::time_t>(sec);
+        std::tm tm{};
+#ifndef _WIN32
+        gmtime_r(&t, &tm);
+#else
+        gmtime_s(&tm, &t);
+#endif
+        std::strftime(text_, sizeof(text_), "%Y-%m-%dT%H:%M:%S", &tm);
+        last_ = sec;
+        return text_;
+    }
+
+private:
+    std::int64_t last_{0};
+    char text_[32]{};
+};
+
+std::string csv_field(const std::string& s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char esc[8];
+            std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+            out += esc;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out + "\"";
+}
+
+// JSON has no NaN or infinity
+const char* json_number(char* buf, std::size_t size, const char* fmt, double v) {
+    if (!std::isfinite(v)) return "null";
+    std::snprintf(buf, size, fmt, v);
+    return buf;
+}
+
+} // namespace
+
+ExportFormat export_format_for(const std::string& filename) {
+    if (ends_with(filename, ".jsonl") || ends_with(filename, ".json")) return ExportFormat::JSONL;
+    if (ends_with(filename, ".bin") || ends_with(filename, ".anom")) return ExportFormat::BINARY;
+    return ExportFormat::CSV;
+}
+
+TimelineExporter::~TimelineExporter() {
+    cancel();
+}
+
+bool TimelineExporter::start(const std::string& filename, ExportFormat format, std::size_t count,
+                             Source source, NameFn name) {
+    if (state() == State::RUNNING) return false;
+    if (thread_.joinable()) thread_.join();
+
+    filename_ = filename;
+    total_ = count;
+    written_.store(0, std::memory_order_relaxed);
+    bytes_.store(0, std::memory_order_relaxed);
+    cancel_.store(false, std::memory_order_relaxed);
+    state_.store(State::RUNNING, std::memory_order_release);
+    thread_ = std::thread(&TimelineExporter::run, this, format, std::move(source), std::move(name));
+    return true;
+}
+
+void TimelineExporter::cancel() {
+    cancel_.store(true, std::memory_order_relaxed);
+    if (thread_.joinable()) thread_.join();
+}
+
+std::string TimelineExporter::error() const {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    return error_;
+}
+
+void TimelineExporter::fail(const std::string& message) {
+    {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        error_ = message;
+    }
+    state_.store(State::FAILED, std::memory_order_release);
+}
+
+void TimelineExporter::run(ExportFormat format, Source source, NameFn name) {
+    // Not on the sampler's core or priority, if it runs real-time
+    leave_realtime();
+    // Written beside the target and renamed over it once complete, so a
+    // failed or cancelled export never leaves a truncated file behind
+    const std::string tmp = filename_ + ".tmp";
+    BlockWriter out;
+    std::string error;
+    if (!out.open(tmp, error)) {
+        fail(error);
+        return;
+    }
+    auto abandon = [&](const std::string& message) {
+        std::string ignored;
+        out.finish(ignored);
+        std::remove(tmp.c_str());
+        fail(message);
+    };
+
+    if (format == ExportFormat::BINARY) {
+        TimelineFileHeader header{};
+        std::memcpy(header.magic, "ANOMTL1", 8);
+        header.record_size = sizeof(TimelineRecord);
+        header.count = total_;
+        std::memcpy(out.cursor(), &header, sizeof(header));
+        out.advance(sizeof(header));
+    } else if (format == ExportFormat::CSV) {
+        static const char head[] = "timestamp_ms,time,metric_index,metric,value,z_score,incident\n";
+        std::memcpy(out.cursor(), head, sizeof(head) - 1);
+        out.advance(sizeof(head) - 1);
+    }
+
+    std::vector<TimelineRecord> chunk(CHUNK_RECORDS);
+    std::vector<std::string> names;   // encoded metric names by index
+    IsoSeconds iso;
+    std::size_t done = 0;
+
+    while (done < total_) {
+        if (cancel_.load(std::memory_order_relaxed)) {
+            abandon("cancelled");
+            return;
+        }
+        std::size_t want = std::min(CHUNK_RECORDS, total_ - done);
+        std::size_t got = source(done, chunk.data(), want);
+        if (got == 0) {
+            abandon("timeline changed during export");
+            return;
+        }
+
+        for (std::size_t k = 0; k < got; ++k) {
+            const TimelineRecord& r = chunk[k];
+            if (format == ExportFormat::BINARY) {
+                std::memcpy(out.cursor(), &r, sizeof(r));
+                out.advance(sizeof(r));
+            } else {
+                if (r.metric_index >= names.size()) names.resize(r.metric_index + 1);
+                std::string& metric = names[r.metric_index];
+                if (metric.empty()) {
+                    std::string raw = name(r.metric_index);
+                    metric = (format == ExportFormat::CSV) ? csv_field(raw) : json_string(raw);
+                }
+                std::int64_t sec = r.unix_ms >= 0 ? r.unix_ms / 1000 : (r.unix_ms - 999) / 1000;
+                int ms = static_cast<int>(r.unix_ms - sec * 1000);
+                int n;
+                if (format == ExportFormat::CSV) {
+                    n = std::snprintf(out.cursor(), MAX_LINE_BYTES, "%lld,%s.%03dZ,%u,%s,%.9g,%.6g,%u\n",
+                                      static_cast<long long>(r.unix_ms), iso.format(sec), ms,
+                                      r.metric_index, metric.c_str(),
+                                      static_cast<double>(r.value), static_cast<double>(r.z_score), r.incident);
+                } else {
+                    char value[32], z_score[32];
+                    n = std::snprintf(out.cursor(), MAX_LINE_BYTES,
+                                      "{\"timestamp_ms\":%lld,\"time\":\"%s.%03dZ\",\"metric_index\":%u,"
+                                      "\"metric\":%s,\"value\":%s,\"z_score\":%s,\"incident\":%u}\n",
+                                      static_cast<long long>(r.unix_ms), iso.format(sec), ms,
+                                      r.metric_index, metric.c_str(),
+                                      json_number(value, sizeof(value), "%.9g", static_cast<double>(r.value)),
+                                      json_number(z_score, sizeof(z_score), "%.6g", static_cast<double>(r.z_score)),
+                                      r.incident);
+                }
+                if (n < 0 || static_cast<std::size_t>(n) >= MAX_LINE_BYTES) {
+                    abandon("record too long to encode");
+                    return;
+                }
+                out.advance(static_cast<std::size_t>(n));
+            }
+            if (!out.maybe_flush(error)) {
+                abandon(filename_ + ": " + error);
+                return;
+            }
+        }
+        done += got;
+        written_.store(done, std::memory_order_relaxed);
+        bytes_.store(out.bytes(), std::memory_order_relaxed);
+    }
+
+    if (!out.finish(error)) {
+        std::remove(tmp.c_str());
+        fail(filename_ + ": " + (error.empty() ? "close failed" : error));
+        return;
+    }
+#ifdef _WIN32
+    // rename() does not replace an existing file here
+    std::remove(filename_.c_str());
+#endif
+    if (std::rename(tmp.c_str(), filename_.c_str()) != 0) {
+        error = std::strerror(errno);
+        std::remove(tmp.c_str());
+        fail(filename_ + ": " + error);
+        return;
+    }
+    bytes_.store(out.bytes(), std::memory_order_relaxed);
+    state_.store(State::DONE, std::memory_order_release);
+}
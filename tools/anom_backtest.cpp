@@ -0,0 +1,476 @@
+// Sweep detector tunables over a recorded sample archive, one configuration
+// per job across all cores, and rank them by how they would have alerted.
+//
+//   anom_backtest FILE [--alpha=LO:HI[:STEPS]] [--threshold=LO:HI[:STEPS]]
+//                      [--thresholdN=LO:HI[:STEPS]] [--hysteresis-samples=LO:HI[:STEPS]]
+//                      [--quiet-ms=LO:HI[:STEPS]] [--random=COUNT] [--seed=N]
+//                      [--labels=FILE] [--inject=COUNT] [--threads=N]
+//                      [--scoring=...] [--alerting=...] [--from=MS] [--to=MS]
+//                      [--top=K] [--csv=FILE]
+//
+// The trace is decoded once and shared read-only; each job owns its
+// detector, so workers never write to shared state except their own result
+// slot.
+//
+// Ground truth for detection delay comes from --labels (lines of
+// "START_MS END_MS [METRIC]") and/or --inject, which adds COUNT step
+// anomalies of INJECT_SIGMA standard deviations to a private copy of the
+// trace. Without either, only alert count and flap rate are reported.
+#include "detector.hpp"
+#include "runtime_config.hpp"
+#include "sample_archive.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// An onset this soon after the same metric cleared counts as a flap
+constexpr std::int64_t FLAP_WINDOW_MS = 60000;
+
+// Injected anomalies: size in column standard deviations, length in rows
+constexpr float INJECT_SIGMA = 6.0f;
+constexpr std::size_t INJECT_ROWS = 60;
+
+constexpr std::size_t ANY_METRIC = SIZE_MAX;
+
+// Whole trace in memory, row-major so a row feeds the detector directly
+struct Trace {
+    std::size_t columns{0};
+    std::vector<std::int64_t> t;
+    std::vector<float> values;            // rows * columns
+    std::size_t rows() const { return t.size(); }
+    const float* row(std::size_t r) const { return values.data() + r * columns; }
+};
+
+struct Label {
+    std::int64_t start_ms;
+    std::int64_t end_ms;
+    std::size_t metric;                   // ANY_METRIC matches any
+};
+
+// One tunable being swept
+struct Dimension {
+    std::string name;
+    double lo{0.0};
+    double hi{0.0};
+    unsigned steps{1};
+    bool integer{false};
+    bool logarithmic{false};
+
+    double at(unsigned step) const {
+        if (steps <= 1) return lo;
+        double f = double(step) / double(steps - 1);
+        double v = logarithmic ? lo * std::pow(hi / lo, f) : lo + (hi - lo) * f;
+        return integer ? std::round(v) : v;
+    }
+    double sample(std::mt19937_64& rng) const {
+        double f = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double v = logarithmic ? lo * std::pow(hi / lo, f) : lo + (hi - lo) * f;
+        return integer ? std::round(v) : v;
+    }
+};
+
+struct Result {
+    std::vector<double> params;           // one per dimension
+    std::uint64_t alerts{0};
+    std::uint64_t flaps{0};
+    std::uint64_t detected{0};            // labels with an alert inside them
+    std::uint64_t false_alerts{0};        // onsets outside every label
+    double mean_delay_ms{0.0};
+};
+
+void print_usage(const char* prog) {
+    std::cout << "Usage: " << prog << " FILE [--alpha=LO:HI[:STEPS]] [--threshold=LO:HI[:STEPS]]"
+              << " [--thresholdN=LO:HI[:STEPS]] [--hysteresis-samples=LO:HI[:STEPS]]"
+              << " [--quiet-ms=LO:HI[:STEPS]] [--random=COUNT] [--seed=N] [--labels=FILE]"
+              << " [--inject=COUNT] [--threads=N]"
+              << " [--scoring=ewma|robust|seasonal|fixed|compact|cusum|page-hinkley]"
+              << " [--alerting=hysteresis|quiet|none|compact] [--from=UNIX_MS] [--to=UNIX_MS]"
+              << " [--top=K] [--csv=FILE]\n";
+}
+
+bool parse_range(const std::string& text, Dimension& d) {
+    std::istringstream in(text);
+    char colon = 0;
+    if (!(in >> d.lo >> colon) || colon != ':' || !(in >> d.hi)) return false;
+    d.steps = 1;
+    if (in >> colon) {
+        if (colon != ':' || !(in >> d.steps) || d.steps == 0) return false;
+    } else if (d.lo != d.hi) {
+        d.steps = 5;
+    }
+    if (d.logarithmic && (d.lo <= 0.0 || d.hi <= 0.0)) return false;
+    return d.hi >= d.lo;
+}
+
+// Set dimension `d` to `v` on top of the defaults
+void apply(const Dimension& d, double v, RuntimeConfig& cfg) {
+    if (d.name == "alpha") {
+        cfg.ewma_alpha = float(v);
+    } else if (d.name == "hysteresis-samples") {
+        cfg.hysteresis_samples = unsigned(v);
+    } else if (d.name == "quiet-ms") {
+        cfg.min_quiet_time_ms = unsigned(v);
+    } else if (d.name.rfind("threshold", 0) == 0) {
+        // Clearing thresholds keep their default ratio to the trigger
+        std::size_t first = 0, last = N_METRICS;
+        if (d.name.size() > std::strlen("threshold")) {
+            first = std::strtoul(d.name.c_str() + std::strlen("threshold"), nullptr, 10);
+            last = first + 1;
+        }
+        RuntimeConfig defaults;
+        for (std::size_t i = first; i < last && i < N_METRICS; ++i) {
+            cfg.thresholds[i] = float(v);
+            cfg.hysteresis[i] = float(v) * defaults.hysteresis[i] / defaults.thresholds[i];
+        }
+        if (last - first > 1) {
+            cfg.z_threshold = float(v);
+            cfg.hysteresis_threshold = float(v) * defaults.hysteresis_threshold / defaults.z_threshold;
+        }
+    }
+}
+
+bool load_trace(const std::string& path, std::int64_t from_ms, std::int64_t to_ms,
+                Trace& trace, std::string& error) {
+    ArchiveReader archive;
+    if (!archive.open(path, error)) return false;
+    const std::size_t n = archive.columns();
+    trace.columns = n;
+    archive.for_each_block(from_ms, to_ms, [&](const ArchiveReader::Block& b) {
+        const std::int64_t* t = b.timestamps();
+        std::vector<const float*> cols(n);
+        for (std::size_t c = 0; c < n; ++c) cols[c] = b.column(c);
+        for (std::size_t i = 0; i < b.rows(); ++i) {
+            if (t[i] < from_ms || t[i] > to_ms) continue;
+            trace.t.push_back(t[i]);
+            for (std::size_t c = 0; c < n; ++c) trace.values.push_back(cols[c][i]);
+        }
+        return true;
+    });
+    if (trace.rows() == 0) {
+        error = path + ": no samples in range";
+        return false;
+    }
+    return true;
+}
+
+bool load_labels(const std::string& path, std::vector<Label>& labels, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    std::string line;
+    unsigned line_no = 0;
+    while (std::getline(in, line)) {
+        ++line_no;
+        std::size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        std::istringstream fields(line);
+        Label l{0, 0, ANY_METRIC};
+        if (!(fields >> l.start_ms)) continue;
+        long long metric;
+        if (!(fields >> l.end_ms) || l.end_ms < l.start_ms) {
+            error = path + ":" + std::to_string(line_no) + ": expected START_MS END_MS [METRIC]";
+            return false;
+        }
+        if (fields >> metric) l.metric = metric < 0 ? ANY_METRIC : std::size_t(metric);
+        labels.push_back(l);
+    }
+    return true;
+}
+
+// Add `count` step anomalies to the trace at evenly spread, jittered rows
+// after the warm-up, and label them
+void inject(Trace& trace, std::size_t count, std::uint64_t seed, std::vector<Label>& labels) {
+    const std::size_t n = trace.columns;
+    std::vector<double> sigma(n, 0.0);
+    for (std::size_t c = 0; c < n; ++c) {
+        double sum = 0.0, sumsq = 0.0;
+        for (std::size_t r = 0; r < trace.rows(); ++r) {
+            double v = trace.row(r)[c];
+            sum += v;
+            sumsq += v * v;
+        }
+        double mean = sum / double(trace.rows());
+        double var = sumsq / double(trace.rows()) - mean * mean;
+        sigma[c] = var > 0.0 ? std::sqrt(var) : 0.0;
+    }
+    std::vector<std::size_t> candidates;
+    for (std::size_t c = 0; c < n; ++c) {
+        if (sigma[c] > 0.0) candidates.push_back(c);
+    }
+    const std::size_t first = WARMUP_SAMPLES * 2;
+    if (candidates.empty() || count == 0 || trace.rows() < first + INJECT_ROWS) return;
+
+    std::mt19937_64 rng(seed);
+    const std::size_t span = (trace.rows() - first) / count;
+    if (span < INJECT_ROWS) return;
+    for (std::size_t k = 0; k < count; ++k) {
+        std::size_t start = first + k * span +
+            std::uniform_int_distribution<std::size_t>(0, span - INJECT_ROWS)(rng);
+        std::size_t c = candidates[rng() % candidates.size()];
+        float step = float(INJECT_SIGMA * sigma[c]) * ((rng() & 1) ? 1.0f : -1.0f);
+        for (std::size_t r = start; r < start + INJECT_ROWS; ++r) {
+            trace.values[r * n + c] += step;
+        }
+        labels.push_back({trace.t[start], trace.t[start + INJECT_ROWS - 1], c});
+    }
+}
+
+struct Onset {
+    std::int64_t t;
+    std::size_t metric;
+};
+
+// Run one configuration over the trace; everything mutable is local
+Result run(const Trace& trace, const std::vector<Label>& labels, ScoringPolicy scoring,
+           AlertingPolicy alerting, const RuntimeConfig& cfg) {
+    const std::size_t n = trace.columns;
+    ConfigStore store(cfg);
+    AnyDetector det = make_detector(scoring, alerting, n);
+    det.attach_config(&store);
+
+    std::vector<float> z(n);
+    std::vector<std::uint8_t> was_active(n, 0);
+    std::vector<std::int64_t> cleared_ms(n, INT64_MIN);
+    std::vector<Onset> onsets;
+    Result result;
+
+    const std::int64_t base = steady_now_ms();
+    const std::int64_t origin = trace.t[0];
+    for (std::size_t r = 0; r < trace.rows(); ++r) {
+        const std::int64_t t = trace.t[r];
+        bool any = det.feed(trace.row(r), z.data(), base + (t - origin));
+        bool ready = r >= cfg.warmup_samples;
+        for (std::size_t c = 0; c < n; ++c) {
+            bool active = ready && any && det.is_anomaly_active(c);
+            if (active && !was_active[c]) {
+                ++result.alerts;
+                if (cleared_ms[c] != INT64_MIN && t - cleared_ms[c] < FLAP_WINDOW_MS) ++result.flaps;
+                onsets.push_back({t, c});
+            } else if (!active && was_active[c]) {
+                cleared_ms[c] = t;
+            }
+            was_active[c] = active;
+        }
+    }
+
+    // Match onsets against labels: delay is to the first alert inside each
+    double delay_sum = 0.0;
+    std::vector<std::uint8_t> explained(onsets.size(), 0);
+    for (const Label& l : labels) {
+        auto it = std::lower_bound(onsets.begin(), onsets.end(), l.start_ms,
+                                   [](const Onset& o, std::int64_t t) { return o.t < t; });
+        bool found = false;
+        for (; it != onsets.end() && it->t <= l.end_ms; ++it) {
+            if (l.metric != ANY_METRIC && it->metric != l.metric) continue;
+            explained[std::size_t(it - onsets.begin())] = 1;
+            if (!found) {
+                delay_sum += double(it->t - l.start_ms);
+                found = true;
+            }
+        }
+        result.detected += found;
+    }
+    for (std::uint8_t e : explained) result.false_alerts += !e;
+    result.mean_delay_ms = result.detected ? delay_sum / double(result.detected) : 0.0;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argv[1][0] == '-') {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const std::string path = argv[1];
+    ScoringPolicy scoring = ScoringPolicy::EWMA;
+    AlertingPolicy alerting = AlertingPolicy::HYSTERESIS;
+    std::int64_t from_ms = INT64_MIN, to_ms = INT64_MAX;
+    std::vector<Dimension> dims;
+    std::size_t random_count = 0, inject_count = 0, top = 20;
+    std::uint64_t seed = 1;
+    unsigned threads = std::thread::hardware_concurrency();
+    std::string labels_path, csv_path;
+
+    for (int a = 2; a < argc; ++a) {
+        std::string arg = argv[a];
+        std::size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+        bool ok = true;
+        if (eq == std::string::npos) {
+            ok = false;
+        } else if (key == "--alpha" || key == "--hysteresis-samples" || key == "--quiet-ms" ||
+                   key.rfind("--threshold", 0) == 0) {
+            Dimension d;
+            d.name = key.substr(2);
+            d.logarithmic = key == "--alpha";
+            d.integer = key == "--hysteresis-samples" || key == "--quiet-ms";
+            ok = parse_range(value, d);
+            if (d.name.size() > std::strlen("threshold") && d.name.rfind("threshold", 0) == 0) {
+                char* end = nullptr;
+                unsigned long metric = std::strtoul(d.name.c_str() + std::strlen("threshold"), &end, 10);
+                ok = ok && *end == '\0' && metric < N_METRICS;
+            }
+            dims.push_back(d);
+        } else if (key == "--random") {
+            random_count = std::strtoull(value.c_str(), nullptr, 10);
+            ok = random_count > 0;
+        } else if (key == "--seed") {
+            seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (key == "--labels") {
+            labels_path = value;
+        } else if (key == "--inject") {
+            inject_count = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (key == "--threads") {
+            threads = unsigned(std::strtoul(value.c_str(), nullptr, 10));
+            ok = threads > 0;
+        } else if (key == "--scoring") {
+            ok = parse_scoring_policy(value, scoring);
+        } else if (key == "--alerting") {
+            ok = parse_alerting_policy(value, alerting);
+        } else if (key == "--from") {
+            from_ms = std::strtoll(value.c_str(), nullptr, 10);
+        } else if (key == "--to") {
+            to_ms = std::strtoll(value.c_str(), nullptr, 10);
+        } else if (key == "--top") {
+            top = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (key == "--csv") {
+            csv_path = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (threads == 0) threads = 1;
+
+    Trace trace;
+    std::vector<Label> labels;
+    std::string error;
+    if (!load_trace(path, from_ms, to_ms, trace, error) ||
+        (!labels_path.empty() && !load_labels(labels_path, labels, error))) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    inject(trace, inject_count, seed, labels);
+    std::sort(labels.begin(), labels.end(),
+              [](const Label& x, const Label& y) { return x.start_ms < y.start_ms; });
+
+    // Every configuration up front: the grid, or random draws from the ranges
+    std::vector<std::vector<double>> configs;
+    if (random_count) {
+        std::mt19937_64 rng(seed);
+        for (std::size_t k = 0; k < random_count; ++k) {
+            std::vector<double> p;
+            for (const Dimension& d : dims) p.push_back(d.sample(rng));
+            configs.push_back(p);
+        }
+    } else {
+        std::vector<unsigned> step(dims.size(), 0);
+        for (;;) {
+            std::vector<double> p;
+            for (std::size_t d = 0; d < dims.size(); ++d) p.push_back(dims[d].at(step[d]));
+            configs.push_back(p);
+            std::size_t d = 0;
+            while (d < dims.size() && ++step[d] == dims[d].steps) step[d++] = 0;
+            if (d == dims.size()) break;
+        }
+    }
+
+    std::cout << "trace: " << trace.rows() << " rows x " << trace.columns << " metrics, "
+              << labels.size() << " labels; " << configs.size() << " configurations on "
+              << threads << " threads\n";
+
+    // Workers pull configuration indices; results land in their own slots
+    std::vector<Result> results(configs.size());
+    std::atomic<std::size_t> next{0};
+    auto start = std::chrono::steady_clock::now();
+    auto worker = [&]() {
+        for (std::size_t k = next.fetch_add(1); k < configs.size(); k = next.fetch_add(1)) {
+            RuntimeConfig cfg;
+            for (std::size_t d = 0; d < dims.size(); ++d) apply(dims[d], configs[k][d], cfg);
+            results[k] = run(trace, labels, scoring, alerting, cfg);
+            results[k].params = configs[k];
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) pool.emplace_back(worker);
+    worker();
+    for (std::thread& t : pool) t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Best first: most labels caught, then fewest false alerts, then fastest
+    std::vector<std::size_t> order(results.size());
+    for (std::size_t k = 0; k < order.size(); ++k) order[k] = k;
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t x, std::size_t y) {
+        const Result& a = results[x];
+        const Result& b = results[y];
+        if (a.detected != b.detected) return a.detected > b.detected;
+        if (a.false_alerts != b.false_alerts) return a.false_alerts < b.false_alerts;
+        return a.mean_delay_ms < b.mean_delay_ms;
+    });
+
+    const double hours = double(trace.t.back() - trace.t.front()) / 3600000.0;
+    auto flap_rate = [](const Result& r) {
+        return r.alerts ? 100.0 * double(r.flaps) / double(r.alerts) : 0.0;
+    };
+
+    std::cout << "swept in " << std::fixed << std::setprecision(2) << seconds << " s ("
+              << double(configs.size() * trace.rows()) / seconds / 1e6 << " M rows/s)\n\n";
+    for (const Dimension& d : dims) std::cout << std::setw(12) << d.name << " ";
+    std::cout << std::setw(8) << "alerts" << std::setw(10) << "per hour" << std::setw(8) << "flap%";
+    if (!labels.empty()) std::cout << std::setw(10) << "detected" << std::setw(8) << "false" << std::setw(11) << "delay s";
+    std::cout << "\n";
+    for (std::size_t k = 0; k < order.size() && k < top; ++k) {
+        const Result& r = results[order[k]];
+        for (std::size_t d = 0; d < dims.size(); ++d) {
+            std::cout << std::setw(12) << std::setprecision(dims[d].integer ? 0 : 4) << r.params[d] << " ";
+        }
+        std::cout << std::setw(8) << r.alerts << std::setw(10) << std::setprecision(2)
+                  << (hours > 0.0 ? double(r.alerts) / hours : 0.0) << std::setw(8) << std::setprecision(1)
+                  << flap_rate(r);
+        if (!labels.empty()) {
+            std::cout << std::setw(6) << r.detected << "/" << std::left << std::setw(3) << labels.size()
+                      << std::right << std::setw(8) << r.false_alerts << std::setw(11)
+                      << std::setprecision(1) << r.mean_delay_ms / 1000.0;
+        }
+        std::cout << "\n";
+    }
+
+    if (!csv_path.empty()) {
+        std::ofstream csv(csv_path);
+        if (!csv) {
+            std::cerr << csv_path << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+        for (const Dimension& d : dims) csv << d.name << ",";
+        csv << "alerts,flaps,detected,false_alerts,mean_delay_ms\n";
+        for (std::size_t k : order) {
+            const Result& r = results[k];
+            for (double p : r.params) csv << p << ",";
+            csv << r.alerts << "," << r.flaps << "," << r.detected << "," << r.false_alerts << ","
+                << r.mean_delay_ms << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,239 @@
+// Time the ways a collector tick can read its proc and cgroup files, over
+// the processes (and cgroups) on this host right now.
+//
+//   anom_iobench [--files=schedstat,stat,io] [--ticks=N] [--cgroups]
+//
+// Per file set, each method reads every file once per tick for N ticks
+// and reports reads, syscalls and microseconds per tick:
+//
+//   open-read-close  path lookup and a fresh fd per file, every tick
+//   held-pread       fds held across ticks, one pread each (the collectors'
+//                    direct path)
+//   batch-uring      BatchReader's io_uring engine
+//   batch-pread      BatchReader's pread engine
+//
+// --cgroups adds a set of the cgroup v2 interface files the cgroup
+// collector reads. Files that vanish mid-run (exited processes) still count
+// as reads.
+#include "batch_reader.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--files=schedstat,stat,io] [--ticks=N] [--cgroups]\n";
+}
+
+#ifdef __linux__
+struct FileSet {
+    std::string name;
+    std::vector<std::string> paths;
+    std::size_t bytes;              // buffer per read
+};
+
+struct Result {
+    double us_per_tick;
+    double syscalls_per_tick;
+};
+
+std::vector<int> list_pids() {
+    std::vector<int> pids;
+    DIR* d = opendir("/proc");
+    if (!d) return pids;
+    while (struct dirent* de = readdir(d)) {
+        char* end = nullptr;
+        long pid = std::strtol(de->d_name, &end, 10);
+        if (pid > 0 && *end == '\0') pids.push_back(int(pid));
+    }
+    closedir(d);
+    return pids;
+}
+
+std::string cgroup_mount() {
+    std::FILE* f = std::fopen("/proc/self/mountinfo", "re");
+    if (!f) return std::string();
+    std::string found;
+    char line[1024], mount[512];
+    while (std::fgets(line, sizeof(line), f)) {
+        if (std::strstr(line, " - cgroup2 ") && std::sscanf(line, "%*s %*s %*s %*s %511s", mount) == 1) {
+            found = mount;
+            break;
+        }
+    }
+    std::fclose(f);
+    return found;
+}
+
+void walk_cgroups(const std::string& dir, std::vector<std::string>& out) {
+    static const char* const FILES[] = { "cpu.stat", "memory.current", "memory.pressure", "io.stat" };
+    for (const char* file : FILES) {
+        std::string path = dir + "/" + file;
+        if (access(path.c_str(), R_OK) == 0) out.push_back(path);
+    }
+    DIR* d = opendir(dir.c_str());
+    if (!d) return;
+    while (struct dirent* de = readdir(d)) {
+        if (de->d_type == DT_DIR && de->d_name[0] != '.') walk_cgroups(dir + "/" + de->d_name, out);
+    }
+    closedir(d);
+}
+
+double elapsed_us(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - since).count();
+}
+
+Result bench_open(const FileSet& set, unsigned ticks) {
+    std::vector<char> buf(set.bytes);
+    std::uint64_t syscalls = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < ticks; ++t) {
+        for (const std::string& path : set.paths) {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            ++syscalls;
+            if (fd < 0) continue;
+            ssize_t n = read(fd, buf.data(), buf.size());
+            (void)n;
+            close(fd);
+            syscalls += 2;
+        }
+    }
+    return { elapsed_us(t0) / ticks, double(syscalls) / ticks };
+}
+
+Result bench_held(const std::vector<int>& fds, const FileSet& set, unsigned ticks) {
+    std::vector<char> buf(set.bytes);
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < ticks; ++t) {
+        for (int fd : fds) {
+            ssize_t n = pread(fd, buf.data(), buf.size(), 0);
+            (void)n;
+        }
+    }
+    return { elapsed_us(t0) / ticks, double(fds.size()) };
+}
+
+// One untimed batch first: slot setup and buffer registration are not per tick
+bool bench_batch(const std::vector<int>& fds, const FileSet& set, unsigned ticks,
+                 BatchReader::Engine engine, Result& result) {
+    BatchReader reader(engine);
+    std::vector<BatchReader::Slot> slots;
+    for (int fd : fds) {
+        BatchReader::Slot s = reader.attach(fd, set.bytes);
+        if (s != BatchReader::NONE) slots.push_back(s);
+    }
+    for (BatchReader::Slot s : slots) reader.queue(s);
+    reader.submit();
+    if (engine == BatchReader::Engine::URING && std::strcmp(reader.engine_name(), "io_uring") != 0) {
+        return false;
+    }
+    const std::uint64_t syscalls0 = reader.syscalls();
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < ticks; ++t) {
+        for (BatchReader::Slot s : slots) reader.queue(s);
+        reader.submit();
+    }
+    result = { elapsed_us(t0) / ticks, double(reader.syscalls() - syscalls0) / ticks };
+    for (BatchReader::Slot s : slots) reader.detach(s);
+    return true;
+}
+
+void print_row(const char* method, std::size_t reads, const Result& r) {
+    std::cout << "  " << std::left << std::setw(18) << method << std::right
+              << std::setw(8) << reads
+              << std::setw(12) << std::fixed << std::setprecision(1) << r.syscalls_per_tick
+              << std::setw(14) << std::setprecision(0) << r.us_per_tick
+              << std::setw(12) << std::setprecision(2) << (reads ? r.us_per_tick / reads : 0.0) << "\n";
+}
+
+void run(const FileSet& set, unsigned ticks) {
+    std::vector<int> fds;
+    for (const std::string& path : set.paths) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) fds.push_back(fd);
+    }
+    std::cout << set.name << ": " << fds.size() << " files, " << ticks << " ticks\n"
+              << "  method                reads  syscalls/t   us/tick     us/read\n";
+
+    print_row("open-read-close", set.paths.size(), bench_open(set, ticks));
+    print_row("held-pread", fds.size(), bench_held(fds, set, ticks));
+    Result r;
+    if (bench_batch(fds, set, ticks, BatchReader::Engine::URING, r)) {
+        print_row("batch-uring", fds.size(), r);
+    } else {
+        std::cout << "  batch-uring       unavailable\n";
+    }
+    bench_batch(fds, set, ticks, BatchReader::Engine::PREAD, r);
+    print_row("batch-pread", fds.size(), r);
+
+    for (int fd : fds) close(fd);
+}
+#endif
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+#ifdef __linux__
+    std::vector<std::string> files = { "schedstat", "stat", "io" };
+    unsigned ticks = 20;
+    bool cgroups = false;
+
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (arg.rfind("--files=", 0) == 0) {
+            files.clear();
+            std::stringstream ss(arg.substr(8));
+            for (std::string f; std::getline(ss, f, ','); ) {
+                if (!f.empty()) files.push_back(f);
+            }
+        } else if (arg.rfind("--ticks=", 0) == 0) {
+            ticks = unsigned(std::strtoul(arg.c_str() + 8, nullptr, 10));
+        } else if (arg == "--cgroups") {
+            cgroups = true;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (ticks == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<int> pids = list_pids();
+    for (const std::string& file : files) {
+        FileSet set{ "/proc/[pid]/" + file, {}, file == "stat" ? 1024u : 512u };
+        for (int pid : pids) set.paths.push_back("/proc/" + std::to_string(pid) + "/" + file);
+        run(set, ticks);
+    }
+    if (cgroups) {
+        std::string mount = cgroup_mount();
+        FileSet set{ "cgroup files", {}, 4096 };
+        if (!mount.empty()) walk_cgroups(mount, set.paths);
+        if (set.paths.empty()) {
+            std::cout << "cgroup files: no cgroup v2 hierarchy\n";
+        } else {
+            run(set, ticks);
+        }
+    }
+    return 0;
+#else
+    (void)argc;
+    print_usage(argv[0]);
+    std::cerr << "Linux only\n";
+    return 1;
+#endif
+}